@@ -30,8 +30,8 @@ flash       [p][t][o] dev [offset]      file   Write file to flash
 read        [p][t][o] dev [offset] size file   Read flash and write to file      
 erase       [p][t][o] dev [offset] size        Erase area or whole flash       
 verify      [p][t][o] dev [offset]      file   Byte-by-byte compare
-verify_hash [p][t][o] dev [offset]      file   Quick compare using checksums
-hash        [p][t][o] dev [offset] size        Compute SHA1
+verify_hash [p][t][o] dev [offset]      file   Quick compare using a hash tree
+hash        [p][t][o] dev [offset] size        Compute SHA1 or CRC32 (netX 90)
 info        [p][t][o]                          Show busses/units/chip selects
 detect      [p][t][o] dev                      Check if flash is recognized
 test        [p][t][o] dev                      Test flasher      
@@ -854,8 +854,8 @@ end
 -- info               x
 -- detect                     x       x       x        x      x       x         x
 -- load data file                     x       x                                 x
--- eraseArea                          x                x
--- flashArea                          x
+-- eraseArea                                           x
+-- flashArea (erase, flash, verify)   x
 -- verifyArea                                 x
 -- readArea                                                   x
 -- SHA over data file                                                           x
@@ -979,16 +979,15 @@ function exec(aArgs)
 			end
 		end
 		
-		-- flash/erase: erase the area
-		--if fOk and (iMode == MODE_FLASH or iMode == MODE_ERASE) then
-		-- Explicit erase is not necessary when flashing SDIO
-		if fOk and (iMode == MODE_ERASE or (iMode == MODE_FLASH and iBus ~= flasher.BUS_SDIO))then
+		-- erase: erase the area
+		if fOk and iMode == MODE_ERASE then
 			fOk, strMsg = flasher.eraseArea(tPlugin, aAttr, ulStartOffset, ulLen)
 		end
 		
-		-- flash: flash the data
+		-- flash: erase the area if necessary and flash the data
+		-- Explicit erase is not necessary when flashing SDIO
 		if fOk and iMode == MODE_FLASH then
-			fOk, strMsg = flasher.flashArea(tPlugin, aAttr, ulStartOffset, strData)
+			fOk, strMsg = flasher.flashArea(tPlugin, aAttr, ulStartOffset, strData, nil, nil, iBus ~= flasher.BUS_SDIO)
 		end
 		
 		-- verify
@@ -1027,13 +1026,13 @@ function exec(aArgs)
 		end
 		
 		
-		-- hash, verify_hash: compute the SHA1 of the data in the flash
-		if fOk and (iMode == MODE_HASH or iMode == MODE_VERIFY_HASH) then
+		-- hash: compute the checksum of the data in the flash
+		if fOk and iMode == MODE_HASH then
 			strFlashHashBin, strMsg = flasher.hashArea(tPlugin, aAttr, ulStartOffset, ulLen)
 			if strFlashHashBin then
 				fOk = true
 				strFlashHash = getHexString(strFlashHashBin)
-				print("Flash SHA1: " .. strFlashHash)
+				print("Flash " .. flasher.getHashName(flasher.getHashAlgorithm(aAttr)) .. ": " .. strFlashHash)
 			else
 				fOk = false
 				strMsg = strMsg or "Could not compute the hash sum of the flash contents"
@@ -1041,23 +1040,35 @@ function exec(aArgs)
 		end
 		
 		
-		-- verify_hash: compute the hash of the input file and compare
+		-- verify_hash: compare the hash trees of the flash and the input file
 		if fOk and iMode == MODE_VERIFY_HASH then
-			local mh = mhash.mhash_state()
-			mh:init(mhash.MHASH_SHA1)
-			mh:hash(strData)
-			strFileHashBin = mh:hash_end()
-			strFileHash = getHexString(strFileHashBin)
-			print("File SHA1: " .. strFileHash)
-
-			if strFileHashBin == strFlashHashBin then
-				print("Checksums are equal!")
-				fOk = true
-				strMsg = "The data in the flash and the file have the same checksum"
+			local ulLeafSize, astrFlashNodeBin
+			strFlashHashBin, ulLeafSize, astrFlashNodeBin = flasher.hashTreeArea(tPlugin, aAttr, ulStartOffset, ulLen)
+			if strFlashHashBin then
+				strFlashHash = getHexString(strFlashHashBin)
+				print("Flash " .. flasher.getHashName(flasher.getHashAlgorithm(aAttr)) .. " tree: " .. strFlashHash)
+
+				local astrFileNodeBin
+				strFileHashBin, astrFileNodeBin = flasher.hashTreeData(strData, ulLeafSize, flasher.getHashAlgorithm(aAttr))
+				strFileHash = getHexString(strFileHashBin)
+				print("File " .. flasher.getHashName(flasher.getHashAlgorithm(aAttr)) .. " tree:  " .. strFileHash)
+
+				if strFileHashBin == strFlashHashBin then
+					print("Checksums are equal!")
+					fOk = true
+					strMsg = "The data in the flash and the file have the same checksum"
+				else
+					print("Checksums are not equal!")
+					local atRanges = flasher.compareTreeLeaves(astrFlashNodeBin, astrFileNodeBin, ulStartOffset, ulLen, ulLeafSize)
+					for _, tRange in ipairs(atRanges) do
+						print(string.format("Different: 0x%08x-0x%08x", tRange[1], tRange[2]))
+					end
+					fOk = true
+					strMsg = "The data in the flash and the file do not have the same checksum"
+				end
 			else
-				print("Checksums are not equal!")
-				fOk = true
-				strMsg = "The data in the flash and the file do not have the same checksum"
+				fOk = false
+				strMsg = ulLeafSize or "Could not compute the hash sum of the flash contents"
 			end
 		end
 	
@@ -22,31 +22,20 @@ if not ulEraseStart then
 end
 print(string.format("The first erase area is: 0x%08x-0x%08x", ulEraseStart, ulEraseEnd))
 
--- Check if the erase area is already clear.
-local fIsErased
-print(string.format("Is area 0x%08x-0x%08x already erased?", ulEraseStart, ulEraseEnd))
-fIsErased = flasher.isErased(tPlugin, aAttr, ulEraseStart, ulEraseEnd)
-if fIsErased==nil then
-	error("failed to check the area!")
+-- Erase the area if it is not clear yet and check the result. Both
+-- operations run in one call of the flasher.
+print(string.format("Erasing area 0x%08x-0x%08x if necessary...", ulEraseStart, ulEraseEnd))
+local tBatch = flasher.batch_create()
+flasher.batch_add(tBatch, { flasher.OPERATION_MODE_EasyErase, aAttr.ulDeviceDesc, ulEraseStart, ulEraseEnd })
+flasher.batch_add(tBatch, { flasher.OPERATION_MODE_IsErased, aAttr.ulDeviceDesc, ulEraseStart, ulEraseEnd })
+local fIsOk, atResults = flasher.batch_run(tPlugin, aAttr, tBatch, false)
+if not fIsOk then
+	error("Failed to erase the area!")
 end
-
-
-if fIsErased==true then
-	print("The area is already erased.")
-else
-	print("The area is not erased. Erasing it now...")
-	local fIsOk = flasher.erase(tPlugin, aAttr, ulEraseStart, ulEraseEnd)
-	if not fIsOk then
-		error("Failed to erase the area!")
-	end
-	print("Erase finished!")
-
-	fIsErased = flasher.isErased(tPlugin, aAttr, ulEraseStart, ulEraseEnd)
-	if not fIsErased then
-		error("No error reported, but the area is not erased!")
-	end
-	print("The first erase area is clear now!")
+if atResults[2].ulReturnMessage~=0xff then
+	error("No error reported, but the area is not erased!")
 end
+print("The first erase area is clear now!")
 
 print("")
 print(" #######  ##    ## ")
@@ -298,7 +298,11 @@ function copy_page0_to_redundancy(tPlugin, aAttr, uiUnit)
 			-- Write two copies of page 0 into the redundancy pages.
 			-- Todo: is it better to write the same data into both pages, or
 			-- to write the data into one page and zero the other?
-			fOk, strMsg = flasher.flashArea(tPlugin, aAttr, 0x1000, strData..strData)
+			-- The flasher copies the page, the data is not sent again.
+			fOk, strMsg = flasher.copyArea(tPlugin, aAttr, 0x0000, 0x1000, 0x1000)
+			if fOk == true then
+				fOk, strMsg = flasher.copyArea(tPlugin, aAttr, 0x0000, 0x2000, 0x1000)
+			end
 			print(strMsg)
 			if fOk ~= true then
 				fOk, strMsg = false, strMsg or "Error while writing redundancy pages"
@@ -947,18 +947,11 @@ elseif tArgs.fCommandFlashSelected == true or tArgs.fCommandVerifySelected then
                                                     else
                                                         tLog.debug('Flashing %d bytes...', sizData)
 
-                                                        fOk, strMsg = tFlasher.eraseArea(tPlugin, aAttr, ulOffset, sizData)
+                                                        fOk, strMsg = tFlasher.flashArea(tPlugin, aAttr, ulOffset, strData, nil, nil, true)
                                                         if fOk ~= true then
-                                                            tLog.error('Failed to erase the area: %s', strMsg)
+                                                            tLog.error('Failed to flash the area: %s', strMsg)
                                                             fOk = false
                                                             break
-                                                        else
-                                                            fOk, strMsg = tFlasher.flashArea(tPlugin, aAttr, ulOffset, strData)
-                                                            if fOk ~= true then
-                                                                tLog.error('Failed to flash the area: %s', strMsg)
-                                                                fOk = false
-                                                                break
-                                                            end
                                                         end
                                                     end
                                                 end
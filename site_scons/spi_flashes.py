@@ -78,10 +78,15 @@ aTemplateLines = [
 	('Write@pageProgramCommand',         '                       .ucPageProgOpcode = 0x%02x,',    '/* pageProgOpcode             */'),
 	('Write@bufferFillCommand',          '                           .ucBufferFill = 0x%02x,',    '/* buffer fill opcode         */'),
 	('Write@bufferWriteCommand',         '                    .ucBufferWriteOpcode = 0x%02x,',    '/* buffer write opcode        */'),
+	('Write@buffer2FillCommand',         '                          .ucBuffer2Fill = 0x%02x,',    '/* buffer 2 fill opcode       */'),
+	('Write@buffer2WriteCommand',        '                   .ucBuffer2WriteOpcode = 0x%02x,',    '/* buffer 2 write opcode      */'),
 	('Write@eraseAndPageProgramCommand', '               .ucEraseAndPageProgOpcode = 0x%02x,',    '/* eraseAndPageProgOpcode     */'),
 	('Status@readStatusCommand',         '                     .ucReadStatusOpcode = 0x%02x,',    '/* readStatusOpcode           */'),
 	('Status@statusReadyMask',           '                      .ucStatusReadyMask = 0x%02x,',    '/* statusReadyMask            */'),
 	('Status@statusReadyValue',          '                     .ucStatusReadyValue = 0x%02x,',    '/* statusReadyValue           */'),
+	('Status@errorStatusCommand',        '                    .ucErrorStatusOpcode = 0x%02x,',    '/* errorStatusOpcode          */'),
+	('Status@errorStatusMask',           '                      .ucErrorStatusMask = 0x%02x,',    '/* errorStatusMask            */'),
+	('Status@clearErrorCommand',         '                     .ucClearErrorOpcode = 0x%02x,',    '/* clearErrorOpcode           */'),
 	('Init0@commandLen',                 '                      .ucInitCmd0_length = %d,',        '/* initCmd0_length            */'),
 	('Init0@commandHex',                 '                            .aucInitCmd0 = {%s},',      '/* initCmd0                   */'),
 	('Init1@commandLen',                 '                      .ucInitCmd1_length = %d,',        '/* initCmd1_length            */'),
@@ -161,10 +166,15 @@ typedef struct SPIFLASH_ATTRIBUTES_Ttag
 	unsigned char   ucPageProgOpcode;                               /* opcode for 'page program (without buildin erase)'            */
 	unsigned char   ucBufferFill;                                   /* opcode for 'fill buffer with data'                           */
 	unsigned char   ucBufferWriteOpcode;                            /* opcode for 'write buffer to flash'                           */
+	unsigned char   ucBuffer2Fill;                                  /* opcode for 'fill buffer 2 with data', 0 means no buffer 2   */
+	unsigned char   ucBuffer2WriteOpcode;                           /* opcode for 'write buffer 2 to flash'                        */
 	unsigned char   ucEraseAndPageProgOpcode;                       /* opcode for 'page program with buildin erase'                 */
 	unsigned char   ucReadStatusOpcode;                             /* opcode for 'read status register'                            */
 	unsigned char   ucStatusReadyMask;                              /* the bitmask indicating device busy                           */
 	unsigned char   ucStatusReadyValue;                             /* eor bitmask for device busy                                  */
+	unsigned char   ucErrorStatusOpcode;                            /* opcode to read the register with the erase/program error bits, 0x00 means not available */
+	unsigned char   ucErrorStatusMask;                              /* the bitmask indicating a failed erase or program operation   */
+	unsigned char   ucClearErrorOpcode;                             /* opcode to clear the error bits, 0x00 means not necessary     */
 	unsigned char   ucInitCmd0_length;                              /* length of the first init command in bytes                    */
 	unsigned char   aucInitCmd0[SPIFLASH_INIT0_SIZE];               /* first command string to init the device                      */
 	unsigned char   ucInitCmd1_length;                              /* length of the second init command in bytes                   */
@@ -286,6 +296,8 @@ def spiflashes_action(target, source, env):
 			'Write@pageProgramCommand':            DATATYPE_NUMBER_ARRAY,
 			'Write@bufferFillCommand':             DATATYPE_NUMBER_ARRAY,
 			'Write@bufferWriteCommand':            DATATYPE_NUMBER_ARRAY,
+			'Write@buffer2FillCommand':            DATATYPE_NUMBER_ARRAY,
+			'Write@buffer2WriteCommand':           DATATYPE_NUMBER_ARRAY,
 			'Write@eraseAndPageProgramCommand':    DATATYPE_NUMBER_ARRAY,
 			
 			'Erase@erasePageCommand':              DATATYPE_NUMBER_ARRAY,
@@ -295,6 +307,9 @@ def spiflashes_action(target, source, env):
 			'Status@readStatusCommand':            DATATYPE_NUMBER_ARRAY,
 			'Status@statusReadyMask':              DATATYPE_NUMBER,
 			'Status@statusReadyValue':             DATATYPE_NUMBER,
+			'Status@errorStatusCommand':           DATATYPE_NUMBER_ARRAY,
+			'Status@errorStatusMask':              DATATYPE_NUMBER,
+			'Status@clearErrorCommand':            DATATYPE_NUMBER_ARRAY,
 			
 			'Init0@command':                       DATATYPE_NUMBER_ARRAY,
 			'Init1@command':                       DATATYPE_NUMBER_ARRAY,
@@ -327,10 +342,14 @@ def spiflashes_action(target, source, env):
 			'Write@pageProgramCommand',
 			'Write@bufferFillCommand',
 			'Write@bufferWriteCommand',
+			'Write@buffer2FillCommand',
+			'Write@buffer2WriteCommand',
 			'Write@eraseAndPageProgramCommand',
 			'Erase@erasePageCommand',
 			'Erase@eraseSectorCommand',
 			'Erase@eraseChipCommand',
+			'Status@errorStatusCommand',
+			'Status@clearErrorCommand',
 			'Init0@command',
 			'Init1@command'
 		]
@@ -352,10 +371,14 @@ def spiflashes_action(target, source, env):
 			'Write@pageProgramCommand',
 			'Write@bufferFillCommand',
 			'Write@bufferWriteCommand',
+			'Write@buffer2FillCommand',
+			'Write@buffer2WriteCommand',
 			'Write@eraseAndPageProgramCommand',
 			'Erase@erasePageCommand',
 			'Erase@eraseSectorCommand',
-			'Status@readStatusCommand'
+			'Status@readStatusCommand',
+			'Status@errorStatusCommand',
+			'Status@clearErrorCommand'
 		]
 		# Loop over all optional commands.
 		for strPath in aSingleByteCommands:
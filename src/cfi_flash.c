@@ -428,6 +428,7 @@ static int read_geometry(FLASH_DEVICE_T *ptFlashDevice, CFI_QUERY_INFORMATION *p
 	unsigned long ulBlockByteSize;
 	unsigned long ulCurSector;
 	unsigned long ulCurOffset;
+	ERASE_REGION_T *ptRegion;
 
 
 	DEBUGMSG(ZONE_FUNCTION, ("+read_geometry(): ptFlashDevice=0x%08x, ptQueryInformation=0x%08x\n", ptFlashDevice, ptQueryInformation));
@@ -447,7 +448,7 @@ static int read_geometry(FLASH_DEVICE_T *ptFlashDevice, CFI_QUERY_INFORMATION *p
 
 	/* Get the number of erase blocks. */
 	uiEraseBlockRegions = ptQueryInformation->bEraseBlockRegions;
-	if( uiEraseBlockRegions>MAX_SECTORS )
+	if( uiEraseBlockRegions>MAX_ERASE_REGIONS )
 	{
 		iResult = FALSE;
 	}
@@ -473,38 +474,30 @@ static int read_geometry(FLASH_DEVICE_T *ptFlashDevice, CFI_QUERY_INFORMATION *p
 			ulBlockSize <<= uiPairedShift;
 			DEBUGMSG(ZONE_VERBOSE, (".read_geometry(): packed: 0x%08x, blocks: 0x%04x, pages: 0x%08x\n", ulBlockInfo, ulBlocks, ulBlockSize));
 
-			/* Loop over all blocks. NOTE: ulBlocks can not be 0 here. */
-			do
+			/* Get the size of the erase block in bytes. */
+			if( ulBlockSize==0 )
 			{
-				/* Is still enough space in the sector table? */
-				if( ulCurSector>MAX_SECTORS )
-				{
-					/* No -> do not process more sectors. */
-					iResult = FALSE;
-					break;
-				}
-
-				/* Get the size of the erase block in bytes. */
-				if( ulBlockSize==0 )
-				{
-					ulBlockByteSize = 0x80;
-				}
-				else
-				{
-					ulBlockByteSize = ulBlockSize * 0x100U;
-				}
-
-				ptFlashDevice->atSectors[ulCurSector].ulOffset = ulCurOffset;
-				ptFlashDevice->atSectors[ulCurSector].ulSize   = ulBlockByteSize;
+				ulBlockByteSize = 0x80;
+			}
+			else
+			{
+				ulBlockByteSize = ulBlockSize * 0x100U;
+			}
 
-				DEBUGMSG(ZONE_VERBOSE, (".read_geometry(): sector %d, offset: 0x%08x, size: 0x%08x\n", ulCurSector, ulCurOffset, ulBlockByteSize));
+			/* Store the region. NOTE: ulBlocks can not be 0 here. */
+			ptRegion = ptFlashDevice->atRegions + uiEraseBlockRegionsCnt - 1U;
+			ptRegion->ulOffset      = ulCurOffset;
+			ptRegion->ulFirstSector = ulCurSector;
+			ptRegion->ulSectorCnt   = ulBlocks;
+			ptRegion->ulSectorSize  = ulBlockByteSize;
 
-				++ulCurSector;
+			DEBUGMSG(ZONE_VERBOSE, (".read_geometry(): sectors %d-%d, offset: 0x%08x, size: 0x%08x\n", ulCurSector, ulCurSector+ulBlocks-1U, ulCurOffset, ulBlockByteSize));
 
-				ulCurOffset += ulBlockByteSize;
-			} while( --ulBlocks>0 );
+			ulCurSector += ulBlocks;
+			ulCurOffset += ulBlocks * ulBlockByteSize;
 		}
 
+		ptFlashDevice->ulRegionCnt = uiEraseBlockRegions;
 		ptFlashDevice->ulSectorCnt = ulCurSector;
 	}
 
@@ -540,6 +533,7 @@ static int query_flash_layout(FLASH_DEVICE_T *ptFlashDevice, const PARFLASH_CONF
 	CFI_SETUP_T tSetup;
 	unsigned char* pucEraseInfo;
 	size_t sizEraseInfoSize;
+	size_t sizExtQuerySize;
 
 	DEBUGMSG(ZONE_FUNCTION, ("+query_flash_layout(): ptFlashDevice=0x%08x\n", ptFlashDevice));
 	
@@ -596,29 +590,39 @@ static int query_flash_layout(FLASH_DEVICE_T *ptFlashDevice, const PARFLASH_CONF
 			
 			ptFlashDevice->fPriExtQueryValid = 0;
 
+			/* If there is an extended query entry, copy the base part.
+			   For Spansion flashes this is the version-independent part,
+			   Intel flashes only need the version. */
+			sizExtQuerySize = 0;
+			if( tQueryInformation.usVendorCommandSet == CFI_FLASH_100_AMD_STD ||
+				tQueryInformation.usVendorCommandSet == CFI_FLASH_100_AMD_EXT )
+			{
+				sizExtQuerySize = CFI_SPANSION_EXTQUERY_BASE_SIZE;
+			}
+			else if( tQueryInformation.usVendorCommandSet == CFI_FLASH_100_INTEL_STD ||
+				tQueryInformation.usVendorCommandSet == CFI_FLASH_100_INTEL_EXT )
+			{
+				sizExtQuerySize = sizeof(CFI_EXTQUERY_HEADER_T);
+			}
+
 			if( iResult==TRUE && 
 				tQueryInformation.usPrimaryAlgorithmExt != 0 &&
-				(tQueryInformation.usVendorCommandSet == CFI_FLASH_100_AMD_STD ||
-					tQueryInformation.usVendorCommandSet == CFI_FLASH_100_AMD_EXT)
+				sizExtQuerySize != 0
 				)
 			{
-			/* If there is an extended query entry, copy the base part 
-			   (the version-independent part, but Spansion-specific);
-			   We currently only use the extquery data for Spansion flashes, and
-			   We don't need the remainder at the moment. */
 				iResult = CFI_memcpy(ptFlashDevice, 
 					(unsigned char*) &ptFlashDevice->tPriExtQuery, 
 					tQueryInformation.usPrimaryAlgorithmExt, 
-					CFI_SPANSION_EXTQUERY_BASE_SIZE);
+					sizExtQuerySize);
 				
 				if( iResult==TRUE &&
-					ptFlashDevice->tPriExtQuery.tSpansion.abExtQueryIdent[0] == 'P' &&
-					ptFlashDevice->tPriExtQuery.tSpansion.abExtQueryIdent[1] == 'R' &&
-					ptFlashDevice->tPriExtQuery.tSpansion.abExtQueryIdent[2] == 'I')
+					ptFlashDevice->tPriExtQuery.tHeader.abExtQueryIdent[0] == 'P' &&
+					ptFlashDevice->tPriExtQuery.tHeader.abExtQueryIdent[1] == 'R' &&
+					ptFlashDevice->tPriExtQuery.tHeader.abExtQueryIdent[2] == 'I')
 				{
-					uprintf("CFI_QueryFlashLayout(): found extended query structure AMD V%c.%c\n",
-						ptFlashDevice->tPriExtQuery.tSpansion.bMajorVer, 
-						ptFlashDevice->tPriExtQuery.tSpansion.bMinorVer);
+					uprintf("CFI_QueryFlashLayout(): found extended query structure V%c.%c\n",
+						ptFlashDevice->tPriExtQuery.tHeader.bMajorVer, 
+						ptFlashDevice->tPriExtQuery.tHeader.bMinorVer);
 					ptFlashDevice->fPriExtQueryValid = 1;
 				}
 				else
@@ -696,7 +700,7 @@ int CFI_IdentifyFlash(FLASH_DEVICE_T* ptFlashDevice, PARFLASH_CONFIGURATION_T *p
 				case CFI_FLASH_100_INTEL_STD:
 				case CFI_FLASH_100_INTEL_EXT:
 					uprintf(".CFI_IdentifyFlash(): Intel command set detected.\n");
-					iResult = IntelIdentifyFlash(ptFlashDevice);
+					iResult = IntelIdentifyFlash(ptFlashDevice, ptCfg);
 					break;
 
 				case CFI_FLASH_100_AMD_STD:
@@ -718,33 +722,154 @@ int CFI_IdentifyFlash(FLASH_DEVICE_T* ptFlashDevice, PARFLASH_CONFIGURATION_T *p
 	return iResult;
 }
 
-const SECTOR_INFO_T *cfi_find_matching_sector(const FLASH_DEVICE_T *ptFlashDescription, unsigned long ulAddress)
+/* Get the region with the sector sizIndex. This is NULL for an invalid index. */
+static const ERASE_REGION_T *cfi_find_region_by_index(const FLASH_DEVICE_T *ptFlashDescription, size_t sizIndex)
 {
-	size_t sizIndex = cfi_find_matching_sector_index(ptFlashDescription, ulAddress);
-	if (sizIndex != 0xffffffffU)
+	const ERASE_REGION_T *ptRegion;
+	const ERASE_REGION_T *ptRegionEnd;
+
+
+	ptRegion = ptFlashDescription->atRegions;
+	ptRegionEnd = ptRegion + ptFlashDescription->ulRegionCnt;
+	while( ptRegion<ptRegionEnd )
 	{
-		return &ptFlashDescription->atSectors[sizIndex];
+		if( sizIndex<ptRegion->ulFirstSector + ptRegion->ulSectorCnt )
+		{
+			return ptRegion;
+		}
+		++ptRegion;
 	}
-	else
+
+	return NULL;
+}
+
+
+/* Get the region with the offset ulAddress. This is NULL for an offset after the end of the flash. */
+static const ERASE_REGION_T *cfi_find_region_by_address(const FLASH_DEVICE_T *ptFlashDescription, unsigned long ulAddress)
+{
+	const ERASE_REGION_T *ptRegion;
+	const ERASE_REGION_T *ptRegionEnd;
+
+
+	ptRegion = ptFlashDescription->atRegions;
+	ptRegionEnd = ptRegion + ptFlashDescription->ulRegionCnt;
+	while( ptRegion<ptRegionEnd )
 	{
-		return NULL;
+		if( ulAddress-ptRegion->ulOffset < ptRegion->ulSectorCnt*ptRegion->ulSectorSize )
+		{
+			return ptRegion;
+		}
+		++ptRegion;
 	}
+
+	return NULL;
 }
 
+
+/*! Find the sector with an offset.
+ *
+ * The regions are searched first. Inside a region the sector is calculated.
+ *
+ * \param ptFlashDescription  The flash device.
+ * \param ulAddress           The offset in the flash.
+ * \param ptSector            Receives the offset and size of the sector. Both are 0 if the offset is not in the flash.
+ * \return The index of the sector or 0xffffffff if the offset is not in the flash.
+ */
+size_t cfi_find_matching_sector(const FLASH_DEVICE_T *ptFlashDescription, unsigned long ulAddress, SECTOR_INFO_T *ptSector)
+{
+	const ERASE_REGION_T *ptRegion;
+	unsigned long ulSectorInRegion;
+
+
+	ptRegion = cfi_find_region_by_address(ptFlashDescription, ulAddress);
+	if( ptRegion==NULL )
+	{
+		ptSector->ulOffset = 0;
+		ptSector->ulSize = 0;
+		return 0xffffffffU;
+	}
+
+	ulSectorInRegion = (ulAddress - ptRegion->ulOffset) / ptRegion->ulSectorSize;
+	ptSector->ulOffset = ptRegion->ulOffset + ulSectorInRegion * ptRegion->ulSectorSize;
+	ptSector->ulSize = ptRegion->ulSectorSize;
+
+	return ptRegion->ulFirstSector + ulSectorInRegion;
+}
+
+
+/*! Find the index of the sector with an offset.
+ *
+ * \param ptFlashDescription  The flash device.
+ * \param ulAddress           The offset in the flash.
+ * \return The index of the sector or 0xffffffff if the offset is not in the flash.
+ */
 size_t cfi_find_matching_sector_index(const FLASH_DEVICE_T *ptFlashDescription, unsigned long ulAddress)
 {
-	const SECTOR_INFO_T *ptSec = ptFlashDescription->atSectors;
-	size_t sizIndex = 0;
-	
-	while(sizIndex < ptFlashDescription->ulSectorCnt)
+	SECTOR_INFO_T tSector;
+
+
+	return cfi_find_matching_sector(ptFlashDescription, ulAddress, &tSector);
+}
+
+
+/*! Get the offset and size of a sector.
+ *
+ * \param ptFlashDescription  The flash device.
+ * \param sizIndex            The index of the sector.
+ * \param ptSector            Receives the offset and size of the sector. Both are 0 for an invalid index.
+ * \return TRUE if the index is valid, FALSE if not.
+ */
+int cfi_get_sector(const FLASH_DEVICE_T *ptFlashDescription, size_t sizIndex, SECTOR_INFO_T *ptSector)
+{
+	const ERASE_REGION_T *ptRegion;
+	int iResult;
+
+
+	ptRegion = cfi_find_region_by_index(ptFlashDescription, sizIndex);
+	if( ptRegion==NULL )
 	{
-		if (ptSec->ulOffset <= ulAddress && ulAddress < (ptSec->ulOffset + ptSec->ulSize))
-		{
-			return sizIndex;
-		}
-		++ptSec, ++sizIndex;
+		ptSector->ulOffset = 0;
+		ptSector->ulSize = 0;
+		iResult = FALSE;
 	}
-	
-	return 0xffffffffU;
+	else
+	{
+		ptSector->ulOffset = ptRegion->ulOffset + (sizIndex - ptRegion->ulFirstSector) * ptRegion->ulSectorSize;
+		ptSector->ulSize = ptRegion->ulSectorSize;
+		iResult = TRUE;
+	}
+
+	return iResult;
+}
+
+
+/*! Get the offset of a sector.
+ *
+ * \param ptFlashDescription  The flash device.
+ * \param sizIndex            The index of the sector.
+ * \return The offset of the sector in the flash or 0 for an invalid index.
+ */
+unsigned long cfi_get_sector_offset(const FLASH_DEVICE_T *ptFlashDescription, size_t sizIndex)
+{
+	SECTOR_INFO_T tSector;
+
+
+	cfi_get_sector(ptFlashDescription, sizIndex, &tSector);
+	return tSector.ulOffset;
 }
 
+
+/*! Get the size of a sector.
+ *
+ * \param ptFlashDescription  The flash device.
+ * \param sizIndex            The index of the sector.
+ * \return The size of the sector in bytes or 0 for an invalid index.
+ */
+unsigned long cfi_get_sector_size(const FLASH_DEVICE_T *ptFlashDescription, size_t sizIndex)
+{
+	SECTOR_INFO_T tSector;
+
+
+	cfi_get_sector(ptFlashDescription, sizIndex, &tSector);
+	return tSector.ulSize;
+}
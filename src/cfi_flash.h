@@ -53,11 +53,10 @@ typedef unsigned short USHORT;
 #define CFI_FLASH_100_INTEL_EXT 0x0003
 #define CFI_FLASH_100_AMD_EXT   0x0004
 
-#if ASIC_TYP==ASIC_TYP_NETX4000
-#define MAX_SECTORS             512
-#else
-#define MAX_SECTORS             256
-#endif
+/* CFI devices have up to 4 erase block regions. Paired devices and some
+ * Intel parts report a few more, so leave some room.
+ */
+#define MAX_ERASE_REGIONS       8
 
 #define DEFAULT_POSTPAUSE       0x03
 #define DEFAULT_PREPAUSE        0x03
@@ -105,6 +104,19 @@ typedef struct SECTOR_INFO_STRUCT
 } SECTOR_INFO_T;
 
 
+/* This structure describes one erase block region of a flash device.
+ * All sectors in a region have the same size, so the sector of an offset
+ * can be calculated.
+ */
+typedef struct ERASE_REGION_STRUCT
+{
+	unsigned long ulOffset;                      /* Offset of the first sector in the region. */
+	unsigned long ulFirstSector;                 /* Index of the first sector in the region. */
+	unsigned long ulSectorCnt;                   /* Number of sectors in the region. */
+	unsigned long ulSectorSize;                  /* Size of each sector in bytes. */
+} ERASE_REGION_T;
+
+
 /* The errorcodes. */
 typedef enum FLASH_ERRORS_Etag
 {
@@ -123,6 +135,7 @@ typedef struct tagFLASH_DEVICE FLASH_DEVICE_T;
 
 typedef FLASH_ERRORS_E(*PFN_FLASH_RESET)(const FLASH_DEVICE_T *ptFlashDev, unsigned long ulSector);
 typedef FLASH_ERRORS_E(*PFN_FLASH_ERASE)(const FLASH_DEVICE_T *ptFlashDev, unsigned long ulSector);
+typedef FLASH_ERRORS_E(*PFN_FLASH_ERASESECTORS)(const FLASH_DEVICE_T *ptFlashDev, unsigned long ulFirstSector, unsigned long ulSectorCnt, unsigned long *pulErasedCnt);
 typedef FLASH_ERRORS_E(*PFN_FLASH_ERASEALL)(const FLASH_DEVICE_T *ptFlashDev);
 typedef FLASH_ERRORS_E(*PFN_FLASH_PROGRAM)(const FLASH_DEVICE_T *ptFlashDev, unsigned long ulStartOffset, unsigned long ulLength, const void* pvData);
 typedef FLASH_ERRORS_E(*PFN_FLASH_LOCK)(const FLASH_DEVICE_T *ptFlashDev, unsigned long ulSector);
@@ -130,11 +143,15 @@ typedef FLASH_ERRORS_E(*PFN_FLASH_UNLOCK)(const FLASH_DEVICE_T *ptFlashDev);
 
 
 
+/* Use Buffered Enhanced Factory Programming for blank blocks on Intel flashes which support it. */
+#define PARFLASH_FLAG_BEFP 0x00000001U
+
 typedef struct
 {
 	unsigned int uiUnit;
 	unsigned int uiChipSelect;
 	unsigned long ulAllowedBusWidths;
+	unsigned long ulFlags;
 } PARFLASH_CONFIGURATION_T;
 
 /* Function pointer table for flash support. */
@@ -142,6 +159,7 @@ typedef struct FLASH_FUNCTIONS_Ttag
 {
 	PFN_FLASH_RESET         pfnReset;
 	PFN_FLASH_ERASE         pfnErase;
+	PFN_FLASH_ERASESECTORS  pfnEraseSectors;  /* Optional, erase several consecutive sectors at once. */
 	PFN_FLASH_ERASEALL      pfnEraseDevice;
 	PFN_FLASH_PROGRAM       pfnProgram;
 	PFN_FLASH_LOCK          pfnLock;
@@ -337,19 +355,24 @@ struct tagFLASH_DEVICE
 	FLASH_FUNCTIONS_T   tFlashFunctions;         /* Function pointer table for flash commands. */
 	PFN_FLASHSETUP      pfnSetup;                /* Function to setup the memory interface. */
 	char                acIdent[16];             /* Name of the device. */
-	SECTOR_INFO_T       atSectors[MAX_SECTORS];  /* Information for each sector. */
+	unsigned long       ulRegionCnt;             /* Number of erase block regions. */
+	ERASE_REGION_T      atRegions[MAX_ERASE_REGIONS]; /* The erase block regions in ascending order. */
 	int                 fPriExtQueryValid;        //!< 1 if tPriExtQuery is valid, 0 if not
 	union {
     	CFI_EXTQUERY_HEADER_T   tHeader;
     	CFI_SPANSION_EXTQUERY_T tSpansion;  
 	} tPriExtQuery;                               //!< CFI primary extended query block
+	int                 fBufferedEFP;             /* TRUE if blank blocks are programmed with BEFP (Intel only). */
 };
 
 
 
 int CFI_IdentifyFlash(FLASH_DEVICE_T* ptFlashDevice, PARFLASH_CONFIGURATION_T *ptCfg);
-const SECTOR_INFO_T *cfi_find_matching_sector(const FLASH_DEVICE_T *ptFlashDescription, unsigned long ulAddress);
+size_t cfi_find_matching_sector(const FLASH_DEVICE_T *ptFlashDescription, unsigned long ulAddress, SECTOR_INFO_T *ptSector);
 size_t cfi_find_matching_sector_index(const FLASH_DEVICE_T *ptFlashDescription, unsigned long ulAddress);
+int cfi_get_sector(const FLASH_DEVICE_T *ptFlashDescription, size_t sizIndex, SECTOR_INFO_T *ptSector);
+unsigned long cfi_get_sector_offset(const FLASH_DEVICE_T *ptFlashDescription, size_t sizIndex);
+unsigned long cfi_get_sector_size(const FLASH_DEVICE_T *ptFlashDescription, size_t sizIndex);
 
 #endif  /* __CFI_FLASH_H__ */
 
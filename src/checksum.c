@@ -0,0 +1,469 @@
+/***************************************************************************
+ *   Copyright (C) 2019 by Hilscher GmbH                                   *
+ *   cthelen@hilscher.com                                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program. If not, see                          *
+ *   <https://www.gnu.org/licenses/>.                                      *
+ ***************************************************************************/
+
+#include "checksum.h"
+
+#include <string.h>
+
+
+#if CFG_INCLUDE_CRC32!=0
+/*
+ * The CRC routines use the "slice-by-4" method. It processes 4 bytes with
+ * 4 table lookups per step. The tables need 4K bytes. They are generated
+ * for the selected polynomial when a CRC checksum is started, so only one
+ * set of tables is in the RAM.
+ */
+
+/* The reversed polynomials. */
+#define CRC32_POLYNOMIAL  0xedb88320U
+#define CRC32C_POLYNOMIAL 0x82f63b78U
+
+static unsigned long s_aulCrcTable[4][256];
+static unsigned long s_ulCrcTablePolynomial = 0;
+
+
+static void crc_generate_tables(unsigned long ulPolynomial)
+{
+	unsigned int uiCnt;
+	unsigned int uiBit;
+	unsigned long ulCrc;
+
+
+	/* Are the tables already valid for this polynomial? */
+	if( s_ulCrcTablePolynomial!=ulPolynomial )
+	{
+		for(uiCnt=0; uiCnt<256; ++uiCnt)
+		{
+			ulCrc = uiCnt;
+			for(uiBit=0; uiBit<8; ++uiBit)
+			{
+				ulCrc = (ulCrc>>1U) ^ (ulPolynomial & (0U-(ulCrc&1U)));
+			}
+			s_aulCrcTable[0][uiCnt] = ulCrc;
+		}
+
+		for(uiCnt=0; uiCnt<256; ++uiCnt)
+		{
+			ulCrc = s_aulCrcTable[0][uiCnt];
+			ulCrc = (ulCrc>>8U) ^ s_aulCrcTable[0][ulCrc&0xffU];
+			s_aulCrcTable[1][uiCnt] = ulCrc;
+			ulCrc = (ulCrc>>8U) ^ s_aulCrcTable[0][ulCrc&0xffU];
+			s_aulCrcTable[2][uiCnt] = ulCrc;
+			ulCrc = (ulCrc>>8U) ^ s_aulCrcTable[0][ulCrc&0xffU];
+			s_aulCrcTable[3][uiCnt] = ulCrc;
+		}
+
+		s_ulCrcTablePolynomial = ulPolynomial;
+	}
+}
+
+
+static unsigned long crc_update(unsigned long ulCrc, const unsigned char *pucData, size_t sizData)
+{
+	const unsigned char *pucEnd;
+	const unsigned long *pulCnt;
+	const unsigned long *pulEnd;
+
+
+	pucEnd = pucData + sizData;
+
+	/* Process the unaligned head byte by byte. */
+	while( pucData<pucEnd && (((unsigned long)pucData)&3U)!=0 )
+	{
+		ulCrc = (ulCrc>>8U) ^ s_aulCrcTable[0][(ulCrc^(*(pucData++)))&0xffU];
+	}
+
+	/* Process complete words. This needs a little endian CPU. */
+	pulCnt = (const unsigned long*)pucData;
+	pulEnd = pulCnt + (((size_t)(pucEnd-pucData)) / 4U);
+	while( pulCnt<pulEnd )
+	{
+		ulCrc ^= *(pulCnt++);
+		ulCrc = s_aulCrcTable[3][ ulCrc         & 0xffU] ^
+		        s_aulCrcTable[2][(ulCrc >>  8U) & 0xffU] ^
+		        s_aulCrcTable[1][(ulCrc >> 16U) & 0xffU] ^
+		        s_aulCrcTable[0][(ulCrc >> 24U) & 0xffU];
+	}
+
+	/* Process the tail byte by byte. */
+	pucData = (const unsigned char*)pulCnt;
+	while( pucData<pucEnd )
+	{
+		ulCrc = (ulCrc>>8U) ^ s_aulCrcTable[0][(ulCrc^(*(pucData++)))&0xffU];
+	}
+
+	return ulCrc;
+}
+#endif
+
+
+
+static int checksum_algorithm_init(CHECKSUM_CONTEXT_T *ptContext, CHECKSUM_ALGORITHM_T tAlgorithm)
+{
+	int iResult;
+
+
+	iResult = 0;
+	ptContext->tAlgorithm = tAlgorithm;
+	switch(tAlgorithm)
+	{
+	case CHECKSUM_ALGORITHM_SHA1:
+#if CFG_INCLUDE_SHA1!=0
+		SHA1_Init(&(ptContext->uState.tSha1));
+#else
+		iResult = -1;
+#endif
+		break;
+
+	case CHECKSUM_ALGORITHM_CRC32:
+#if CFG_INCLUDE_CRC32!=0
+		crc_generate_tables(CRC32_POLYNOMIAL);
+		ptContext->uState.ulCrc = 0xffffffffU;
+#else
+		iResult = -1;
+#endif
+		break;
+
+	case CHECKSUM_ALGORITHM_CRC32C:
+#if CFG_INCLUDE_CRC32!=0
+		crc_generate_tables(CRC32C_POLYNOMIAL);
+		ptContext->uState.ulCrc = 0xffffffffU;
+#else
+		iResult = -1;
+#endif
+		break;
+
+	default:
+		iResult = -1;
+		break;
+	}
+
+	return iResult;
+}
+
+
+
+static void checksum_algorithm_update(CHECKSUM_CONTEXT_T *ptContext, const void *pvData, size_t sizData)
+{
+	switch(ptContext->tAlgorithm)
+	{
+	case CHECKSUM_ALGORITHM_SHA1:
+#if CFG_INCLUDE_SHA1!=0
+		SHA1_Update(&(ptContext->uState.tSha1), pvData, sizData);
+#endif
+		break;
+
+	case CHECKSUM_ALGORITHM_CRC32:
+	case CHECKSUM_ALGORITHM_CRC32C:
+#if CFG_INCLUDE_CRC32!=0
+		ptContext->uState.ulCrc = crc_update(ptContext->uState.ulCrc, (const unsigned char*)pvData, sizData);
+#endif
+		break;
+	}
+}
+
+
+
+static size_t checksum_algorithm_final(CHECKSUM_CONTEXT_T *ptContext, unsigned char *pucChecksum)
+{
+	size_t sizChecksum;
+#if CFG_INCLUDE_CRC32!=0
+	unsigned long ulCrc;
+#endif
+
+
+	sizChecksum = 0;
+	switch(ptContext->tAlgorithm)
+	{
+	case CHECKSUM_ALGORITHM_SHA1:
+#if CFG_INCLUDE_SHA1!=0
+		SHA1_Final(pucChecksum, &(ptContext->uState.tSha1));
+		sizChecksum = 20;
+#endif
+		break;
+
+	case CHECKSUM_ALGORITHM_CRC32:
+	case CHECKSUM_ALGORITHM_CRC32C:
+#if CFG_INCLUDE_CRC32!=0
+		/* Write the CRC in big endian order. This is the usual notation. */
+		ulCrc = ptContext->uState.ulCrc ^ 0xffffffffU;
+		pucChecksum[0] = (unsigned char)((ulCrc >> 24U) & 0xffU);
+		pucChecksum[1] = (unsigned char)((ulCrc >> 16U) & 0xffU);
+		pucChecksum[2] = (unsigned char)((ulCrc >>  8U) & 0xffU);
+		pucChecksum[3] = (unsigned char)( ulCrc         & 0xffU);
+		sizChecksum = 4;
+#endif
+		break;
+	}
+
+	return sizChecksum;
+}
+
+
+
+/*! Start a new checksum.
+ *
+ * \param ptContext   The checksum context.
+ * \param tAlgorithm  The algorithm.
+ * \return 0 on success, -1 if the algorithm is not available in this build.
+ */
+int checksum_init(CHECKSUM_CONTEXT_T *ptContext, CHECKSUM_ALGORITHM_T tAlgorithm)
+{
+	ptContext->sizBlockSize = 0;
+	ptContext->sizBlockLeft = 0;
+	ptContext->pucBlockChecksums = NULL;
+	ptContext->sizBlockChecksums = 0;
+
+	return checksum_algorithm_init(ptContext, tAlgorithm);
+}
+
+
+
+/*! Add data to a checksum.
+ *
+ * In block mode the data is split at the block borders. The checksum of
+ * each complete block is appended to the list of block checksums.
+ *
+ * \param ptContext  The checksum context.
+ * \param pvData     Pointer to the data.
+ * \param sizData    Size of the data in bytes.
+ */
+void checksum_update(CHECKSUM_CONTEXT_T *ptContext, const void *pvData, size_t sizData)
+{
+	const unsigned char *pucData;
+	size_t sizChunk;
+
+
+	if( ptContext->sizBlockSize==0 )
+	{
+		checksum_algorithm_update(ptContext, pvData, sizData);
+	}
+	else
+	{
+		pucData = (const unsigned char*)pvData;
+		while( sizData!=0 )
+		{
+			sizChunk = ptContext->sizBlockLeft;
+			if( sizChunk>sizData )
+			{
+				sizChunk = sizData;
+			}
+
+			checksum_algorithm_update(ptContext, pucData, sizChunk);
+			pucData += sizChunk;
+			sizData -= sizChunk;
+			ptContext->sizBlockLeft -= sizChunk;
+
+			/* Is the block complete? */
+			if( ptContext->sizBlockLeft==0 )
+			{
+				ptContext->sizBlockChecksums += checksum_algorithm_final(ptContext, ptContext->pucBlockChecksums + ptContext->sizBlockChecksums);
+
+				/* Start the next block. The algorithm was already accepted by checksum_blocks_init. */
+				checksum_algorithm_init(ptContext, ptContext->tAlgorithm);
+				ptContext->sizBlockLeft = ptContext->sizBlockSize;
+			}
+		}
+	}
+}
+
+
+
+/*! Finish a checksum.
+ *
+ * \param ptContext    The checksum context.
+ * \param pucChecksum  Buffer for the result. It must have room for CHECKSUM_MAX_SIZE bytes.
+ * \return The size of the checksum in bytes.
+ */
+size_t checksum_final(CHECKSUM_CONTEXT_T *ptContext, unsigned char *pucChecksum)
+{
+	return checksum_algorithm_final(ptContext, pucChecksum);
+}
+
+
+
+/*! Get the size of a checksum.
+ *
+ * \param tAlgorithm  The algorithm.
+ * \return The size of the checksum in bytes or 0 for an unknown algorithm.
+ */
+size_t checksum_get_size(CHECKSUM_ALGORITHM_T tAlgorithm)
+{
+	size_t sizChecksum;
+
+
+	switch(tAlgorithm)
+	{
+	case CHECKSUM_ALGORITHM_SHA1:
+		sizChecksum = 20;
+		break;
+
+	case CHECKSUM_ALGORITHM_CRC32:
+	case CHECKSUM_ALGORITHM_CRC32C:
+		sizChecksum = 4;
+		break;
+
+	default:
+		sizChecksum = 0;
+		break;
+	}
+
+	return sizChecksum;
+}
+
+
+
+/*! Start a list of block checksums.
+ *
+ * The data passed to checksum_update is split into blocks of sizBlockSize
+ * bytes. The checksums of all blocks are written one after the other to
+ * pucBlockChecksums. The last block may be shorter.
+ *
+ * \param ptContext          The checksum context.
+ * \param tAlgorithm         The algorithm.
+ * \param sizBlockSize       The size of one block in bytes. It must not be 0.
+ * \param pucBlockChecksums  The buffer for the block checksums.
+ * \return 0 on success, -1 if the algorithm is not available in this build, the block size is 0 or the buffer is NULL.
+ */
+int checksum_blocks_init(CHECKSUM_CONTEXT_T *ptContext, CHECKSUM_ALGORITHM_T tAlgorithm, size_t sizBlockSize, unsigned char *pucBlockChecksums)
+{
+	int iResult;
+
+
+	iResult = -1;
+	if( sizBlockSize!=0 && pucBlockChecksums!=NULL )
+	{
+		iResult = checksum_init(ptContext, tAlgorithm);
+		if( iResult==0 )
+		{
+			ptContext->sizBlockSize = sizBlockSize;
+			ptContext->sizBlockLeft = sizBlockSize;
+			ptContext->pucBlockChecksums = pucBlockChecksums;
+		}
+	}
+
+	return iResult;
+}
+
+
+
+/*! Finish a list of block checksums.
+ *
+ * This appends the checksum of the last block if it is not complete.
+ *
+ * \param ptContext  The checksum context.
+ * \return The size of all block checksums in bytes.
+ */
+size_t checksum_blocks_final(CHECKSUM_CONTEXT_T *ptContext)
+{
+	if( ptContext->sizBlockLeft!=ptContext->sizBlockSize )
+	{
+		ptContext->sizBlockChecksums += checksum_algorithm_final(ptContext, ptContext->pucBlockChecksums + ptContext->sizBlockChecksums);
+		ptContext->sizBlockLeft = ptContext->sizBlockSize;
+	}
+
+	return ptContext->sizBlockChecksums;
+}
+
+
+
+/*! Get the number of nodes in a hash tree.
+ *
+ * Each level has half the nodes of the level below, rounded up. An odd
+ * node at the end of a level moves up unchanged.
+ *
+ * \param ulLeaves  The number of leaves.
+ * \return The number of nodes in all levels including the leaves and the root.
+ */
+unsigned long checksum_tree_get_nodes(unsigned long ulLeaves)
+{
+	unsigned long ulNodes;
+
+
+	ulNodes = ulLeaves;
+	while( ulLeaves>1U )
+	{
+		ulLeaves = (ulLeaves + 1U) / 2U;
+		ulNodes += ulLeaves;
+	}
+
+	return ulNodes;
+}
+
+
+
+/*! Finish a hash tree.
+ *
+ * The block checksums are the leaves of the tree. Each inner node is the
+ * checksum of CHECKSUM_TREE_NODE_PREFIX followed by its 2 children. An odd
+ * node at the end of a level moves up unchanged. The levels are written
+ * after the leaves, so the complete tree is in the buffer of the block
+ * checksums afterwards and a part of the data can be checked with the
+ * nodes on its path. The tree of an empty area is the checksum of no data.
+ *
+ * \param ptContext  The checksum context. It must be started with checksum_blocks_init.
+ * \param pucRoot    Buffer for the root. It must have room for CHECKSUM_MAX_SIZE bytes.
+ * \return The size of the root in bytes.
+ */
+size_t checksum_tree_final(CHECKSUM_CONTEXT_T *ptContext, unsigned char *pucRoot)
+{
+	static const unsigned char aucPrefix[1] = { CHECKSUM_TREE_NODE_PREFIX };
+	size_t sizChecksum;
+	size_t sizLevel;
+	size_t sizNode;
+	unsigned char *pucLevel;
+	unsigned char *pucNext;
+
+
+	sizChecksum = checksum_get_size(ptContext->tAlgorithm);
+	sizLevel = checksum_blocks_final(ptContext) / sizChecksum;
+	pucLevel = ptContext->pucBlockChecksums;
+
+	if( sizLevel==0 )
+	{
+		/* No data at all. */
+		checksum_algorithm_init(ptContext, ptContext->tAlgorithm);
+		sizChecksum = checksum_algorithm_final(ptContext, pucRoot);
+	}
+	else
+	{
+		while( sizLevel>1U )
+		{
+			pucNext = pucLevel + sizLevel * sizChecksum;
+			for(sizNode=0; sizNode+1U<sizLevel; sizNode+=2U)
+			{
+				checksum_algorithm_init(ptContext, ptContext->tAlgorithm);
+				checksum_algorithm_update(ptContext, aucPrefix, sizeof(aucPrefix));
+				checksum_algorithm_update(ptContext, pucLevel + sizNode * sizChecksum, 2U * sizChecksum);
+				checksum_algorithm_final(ptContext, pucNext + (sizNode / 2U) * sizChecksum);
+			}
+			if( sizNode<sizLevel )
+			{
+				memcpy(pucNext + (sizNode / 2U) * sizChecksum, pucLevel + sizNode * sizChecksum, sizChecksum);
+			}
+
+			pucLevel = pucNext;
+			sizLevel = (sizLevel + 1U) / 2U;
+		}
+
+		memcpy(pucRoot, pucLevel, sizChecksum);
+	}
+
+	return sizChecksum;
+}
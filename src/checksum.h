@@ -0,0 +1,83 @@
+/***************************************************************************
+ *   Copyright (C) 2019 by Hilscher GmbH                                   *
+ *   cthelen@hilscher.com                                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program. If not, see                          *
+ *   <https://www.gnu.org/licenses/>.                                      *
+ ***************************************************************************/
+
+#ifndef __CHECKSUM_H__
+#define __CHECKSUM_H__
+
+#include <stddef.h>
+
+#if CFG_INCLUDE_SHA1!=0
+#       include "sha1.h"
+#endif
+
+
+/* The checksum operation is available if at least one algorithm is included. */
+#if CFG_INCLUDE_SHA1!=0 || CFG_INCLUDE_CRC32!=0
+#       define CFG_INCLUDE_CHECKSUM 1
+#else
+#       define CFG_INCLUDE_CHECKSUM 0
+#endif
+
+
+typedef enum CHECKSUM_ALGORITHM_ENUM
+{
+	CHECKSUM_ALGORITHM_SHA1         = 0,    /* SHA1, 20 bytes */
+	CHECKSUM_ALGORITHM_CRC32        = 1,    /* CRC32 like zlib and Ethernet, 4 bytes big endian */
+	CHECKSUM_ALGORITHM_CRC32C       = 2     /* CRC32C (Castagnoli), 4 bytes big endian */
+} CHECKSUM_ALGORITHM_T;
+
+/* This is the size of the largest checksum. */
+#define CHECKSUM_MAX_SIZE 20
+
+
+typedef struct CHECKSUM_CONTEXT_STRUCT
+{
+	CHECKSUM_ALGORITHM_T tAlgorithm;
+	union
+	{
+#if CFG_INCLUDE_SHA1!=0
+		SHA_CTX tSha1;
+#endif
+		unsigned long ulCrc;
+	} uState;
+
+	/* Block mode: build one checksum for each block of sizBlockSize bytes. */
+	size_t sizBlockSize;
+	size_t sizBlockLeft;
+	unsigned char *pucBlockChecksums;
+	size_t sizBlockChecksums;
+} CHECKSUM_CONTEXT_T;
+
+
+int checksum_init(CHECKSUM_CONTEXT_T *ptContext, CHECKSUM_ALGORITHM_T tAlgorithm);
+void checksum_update(CHECKSUM_CONTEXT_T *ptContext, const void *pvData, size_t sizData);
+size_t checksum_final(CHECKSUM_CONTEXT_T *ptContext, unsigned char *pucChecksum);
+
+size_t checksum_get_size(CHECKSUM_ALGORITHM_T tAlgorithm);
+int checksum_blocks_init(CHECKSUM_CONTEXT_T *ptContext, CHECKSUM_ALGORITHM_T tAlgorithm, size_t sizBlockSize, unsigned char *pucBlockChecksums);
+size_t checksum_blocks_final(CHECKSUM_CONTEXT_T *ptContext);
+
+/* The prefix of the inner nodes of a hash tree. */
+#define CHECKSUM_TREE_NODE_PREFIX 0x01U
+
+unsigned long checksum_tree_get_nodes(unsigned long ulLeaves);
+size_t checksum_tree_final(CHECKSUM_CONTEXT_T *ptContext, unsigned char *pucRoot);
+
+
+#endif  /* __CHECKSUM_H__ */
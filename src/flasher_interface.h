@@ -25,7 +25,9 @@
 #include <string.h>
 
 #include "cfi_flash.h"
+#include "checksum.h"
 #include "internal_flash/internal_flash.h"
+#include "mem_check.h"
 #include "spi_flash.h"
 #include "spi_macro_player.h"
 #ifdef CFG_INCLUDE_SDIO
@@ -33,7 +35,7 @@
 #endif
 /*-------------------------------------*/
 
-#define FLASHER_INTERFACE_VERSION 0x00030000
+#define FLASHER_INTERFACE_VERSION 0x00040000
 
 
 typedef enum BUS_ENUM
@@ -56,7 +58,14 @@ typedef enum OPERATION_MODE_ENUM
 	OPERATION_MODE_GetEraseArea     = 7,    /* expand an area to the erase block borders */
 	OPERATION_MODE_GetBoardInfo     = 8,    /* get bus and unit information */
 	OPERATION_MODE_EasyErase        = 9,    /* A combination of GetEraseArea, IsErased and Erase. */
-	OPERATION_MODE_SpiMacroPlayer   = 10    /* Play an SPI macro. */
+	OPERATION_MODE_SpiMacroPlayer   = 10,   /* Play an SPI macro. */
+	OPERATION_MODE_EraseFlashVerify = 11,   /* Erase if necessary, flash and verify in one call. */
+	OPERATION_MODE_Batch            = 12,   /* Execute a list of operations. */
+	OPERATION_MODE_FlashStream      = 13,   /* Flash data from a ring buffer which is filled while the flasher runs. */
+	OPERATION_MODE_GetEraseMap      = 14,   /* Get a bitmap of the erase units which are not erased. */
+	OPERATION_MODE_Patch            = 15,   /* Rebuild an area from its current contents and a delta. */
+	OPERATION_MODE_Fill             = 16,   /* Write a repeating pattern to an area. */
+	OPERATION_MODE_Copy             = 17    /* Copy an area inside a device or to another device. */
 } OPERATION_MODE_T;
 
 
@@ -90,6 +99,8 @@ typedef struct CMD_PARAMETER_FLASH_STRUCT
 	unsigned long ulStartAdr;
 	unsigned long ulDataByteSize;
 	unsigned char *pucData;
+	const unsigned char *pucCompressed;   /* If ulCompressedSize is not 0, unpack the LZ4 block at pucCompressed to pucData first. */
+	unsigned long ulCompressedSize;
 } CMD_PARAMETER_FLASH_T;
 
 
@@ -107,27 +118,97 @@ typedef struct CMD_PARAMETER_READ_STRUCT
 	unsigned long ulStartAdr;
 	unsigned long ulEndAdr;
 	unsigned char *pucData;
+	unsigned char *pucCompressed;         /* If ulCompressedMax is not 0, pack the data as an LZ4 block to pucCompressed. */
+	unsigned long ulCompressedMax;
+	unsigned long ulCompressedSize;       /* out: size of the LZ4 block or 0 if it did not fit, then use pucData */
 } CMD_PARAMETER_READ_T;
 
 
+/*
+    pucReport is an optional buffer for a list of all differences. If it is
+    NULL, the verify stops at the first difference. See mem_check.h for the
+    layout of the report.
+*/
 typedef struct CMD_PARAMETER_VERIFY_STRUCT
 {
 	const DEVICE_DESCRIPTION_T *ptDeviceDescription;
 	unsigned long ulStartAdr;
 	unsigned long ulEndAdr;
 	unsigned char *pucData;
+	unsigned char *pucReport;
+	size_t sizReport;
 } CMD_PARAMETER_VERIFY_T;
 
 
+/*
+    If ulBlockSize is not 0, the area is split into blocks of ulBlockSize
+    bytes and the checksums of all blocks are written one after the other to
+    pucBlockChecksums. The last block may be shorter. aucChecksum is not used
+    in this case.
+
+    With CHECKSUM_FLAG_Tree the block checksums are the leaves of a hash
+    tree. The levels of the tree follow the leaves in pucBlockChecksums up
+    to the root, see checksum_tree_final. This needs room for
+    checksum_tree_get_nodes(blocks) checksums. The root is also written to
+    aucChecksum.
+*/
+#define CHECKSUM_FLAG_Tree 0x00000001U
+
 typedef struct CMD_PARAMETER_CHECKSUM_STRUCT
 {
 	const DEVICE_DESCRIPTION_T *ptDeviceDescription;
 	unsigned long ulStartAdr;
 	unsigned long ulEndAdr;
-	unsigned char aucSha1[20];
+	CHECKSUM_ALGORITHM_T tAlgorithm;
+	unsigned long ulBlockSize;
+	unsigned char *pucBlockChecksums;
+	unsigned char aucChecksum[CHECKSUM_MAX_SIZE];
+	unsigned long ulFlags;
 } CMD_PARAMETER_CHECKSUM_T;
 
 
+/*
+    The erase area [ulEraseStartAdr, ulEraseEndAdr[ is checked and erased if
+    it is not empty. This is done before the data is written. It can be
+    larger than the data, e.g. to erase the area for a complete image with
+    the first chunk. Set both to 0 to skip the erase.
+    The erase area is expanded to the erase block borders. The result
+    shows which step failed.
+    With ERASEFLASHVERIFY_FLAG_Sparse the data is sent as a list of extents
+    at pucExtents. Each extent is a DWORD with the offset in the data, a
+    DWORD with the length and the data padded to a multiple of 4 bytes.
+    All bytes between the extents are expected to be erased. Only the
+    extents are written, but the complete area is verified.
+*/
+#define ERASEFLASHVERIFY_FLAG_TrustEraseStatus 0x00000001U  /* skip the check after the erase if the device checks the erase itself */
+#define ERASEFLASHVERIFY_FLAG_Sparse           0x00000002U  /* the data is a list of extents at pucExtents */
+
+typedef enum ERASEFLASHVERIFY_RESULT_ENUM
+{
+	ERASEFLASHVERIFY_RESULT_Ok              = 0,
+	ERASEFLASHVERIFY_RESULT_EraseFailed     = 1,
+	ERASEFLASHVERIFY_RESULT_FlashFailed     = 2,
+	ERASEFLASHVERIFY_RESULT_VerifyFailed    = 3
+} ERASEFLASHVERIFY_RESULT_T;
+
+typedef struct CMD_PARAMETER_ERASEFLASHVERIFY_STRUCT
+{
+	const DEVICE_DESCRIPTION_T *ptDeviceDescription;
+	unsigned long ulStartAdr;
+	unsigned long ulDataByteSize;
+	unsigned char *pucData;
+	unsigned long ulEraseStartAdr;            /* in: area to erase, out: expanded erase area */
+	unsigned long ulEraseEndAdr;
+	unsigned long ulFlags;
+	ERASEFLASHVERIFY_RESULT_T tResult;        /* out */
+	unsigned long ulErased;                   /* out: 1 if the erase area was erased, 0 if it was already empty */
+	const unsigned char *pucCompressed;       /* in: LZ4 block for pucData if ulCompressedSize is not 0 */
+	unsigned long ulCompressedSize;
+	const unsigned char *pucExtents;          /* in: list of extents for ERASEFLASHVERIFY_FLAG_Sparse */
+	unsigned long ulExtentsSize;
+} CMD_PARAMETER_ERASEFLASHVERIFY_T;
+
+
 typedef struct CMD_PARAMETER_DETECT_STRUCT
 {
 	BUS_T tSourceTyp;
@@ -150,6 +231,17 @@ typedef struct CMD_PARAMETER_ISERASED_STRUCT
 } CMD_PARAMETER_ISERASED_T;
 
 
+/*
+    GetEraseArea expands [ulStartAdr, ulEndAdr[ to the erase block borders.
+    EasyErase uses the same parameters and erases only the erase blocks in
+    the expanded area which are not empty. Its return message is 0xff if
+    nothing was erased. Otherwise it is the return message of the last
+    erase operation, i.e. 1 if the device checked the erase with its error
+    status bits and 0 if not.
+    NOTE: Before the erase map was used, the return message of EasyErase
+          was the one of IsErased: 0xff if the area was already empty and
+          0 if it was erased.
+*/
 typedef struct CMD_PARAMETER_GETERASEAREA_STRUCT
 {
 	const DEVICE_DESCRIPTION_T *ptDeviceDescription;
@@ -158,6 +250,28 @@ typedef struct CMD_PARAMETER_GETERASEAREA_STRUCT
 } CMD_PARAMETER_GETERASEAREA_T;
 
 
+/*
+    The area [ulStartAdr, ulEndAdr[ is expanded to the erase block borders
+    and split into units of ulUnitSize bytes. This is the size of the erase
+    block at the start of the area. Bit n in pucBitmap (bit n%8 of byte n/8)
+    is set if unit n is not erased.
+    If a device has erase blocks of different sizes, a unit is marked if
+    any erase block in it is not erased, and a larger erase block marks all
+    of its units.
+*/
+typedef struct CMD_PARAMETER_GETERASEMAP_STRUCT
+{
+	const DEVICE_DESCRIPTION_T *ptDeviceDescription;
+	unsigned long ulStartAdr;                 /* in: area to scan, out: expanded area */
+	unsigned long ulEndAdr;
+	unsigned char *pucBitmap;
+	unsigned long ulBitmapSize;               /* size of the bitmap buffer in bytes */
+	unsigned long ulUnitSize;                 /* out */
+	unsigned long ulUnits;                    /* out */
+	unsigned long ulDirtyUnits;               /* out */
+} CMD_PARAMETER_GETERASEMAP_T;
+
+
 typedef struct CMD_PARAMETER_GETBOARDINFO_STRUCT
 {
 	unsigned long ulBusId;
@@ -167,6 +281,142 @@ typedef struct CMD_PARAMETER_GETBOARDINFO_STRUCT
 } CMD_PARAMETER_GETBOARDINFO_T;
 
 
+/*
+    The stream control block is shared between the host and the flasher.
+    The ring buffer has ulSlots slots of ulSlotSize bytes. Both counters
+    only increase, the slot for a counter value is "counter % ulSlots".
+    The host may write a slot while ulProducer-ulConsumer<ulSlots. It
+    increments ulProducer after the complete slot is written.
+    The flasher programs the slot at ulConsumer and increments ulConsumer
+    after it is done. Then it prints a progress line, so the host gets a
+    chance to fill the free slot.
+    The host can stop the flasher with a non-zero value in ulAbort.
+    The flasher fails if no new slot arrives within ulTimeoutMs.
+*/
+typedef struct FLASH_STREAM_CONTROL_STRUCT
+{
+	volatile unsigned long ulProducer;
+	volatile unsigned long ulConsumer;
+	volatile unsigned long ulAbort;
+} FLASH_STREAM_CONTROL_T;
+
+typedef struct CMD_PARAMETER_FLASHSTREAM_STRUCT
+{
+	const DEVICE_DESCRIPTION_T *ptDeviceDescription;
+	unsigned long ulStartAdr;
+	unsigned long ulDataByteSize;
+	FLASH_STREAM_CONTROL_T *ptControl;
+	unsigned char *pucRing;
+	unsigned long ulSlotSize;
+	unsigned long ulSlots;
+	unsigned long ulTimeoutMs;
+} CMD_PARAMETER_FLASHSTREAM_T;
+
+
+/*
+    The new contents of [ulStartAdr, ulStartAdr+ulDataByteSize[ are built
+    from the current flash contents and the delta at pucPatch. The delta is
+    a list of instructions. Each one starts with a DWORD with the opcode in
+    the bits 31..30 and the number of bytes in the bits 29..0.
+      PATCH_OP_Copy:    a DWORD with the flash offset of the source follows
+      PATCH_OP_Literal: the bytes follow, padded to a multiple of 4 bytes
+    The instructions produce the new contents from the start to the end.
+    The area is processed one erase block at a time. Each block is built in
+    the staging buffer, which must hold the largest erase block in the area.
+    Only the blocks which changed are erased and written. A copy can read
+    from the current block and everything behind it, but not from a block
+    which was already rewritten.
+*/
+#define PATCH_OP_Copy     0U
+#define PATCH_OP_Literal  1U
+#define PATCH_OP_SHIFT    30U
+#define PATCH_LENGTH_MASK 0x3fffffffU
+
+typedef struct CMD_PARAMETER_PATCH_STRUCT
+{
+	const DEVICE_DESCRIPTION_T *ptDeviceDescription;
+	unsigned long ulStartAdr;
+	unsigned long ulDataByteSize;
+	const unsigned char *pucPatch;
+	unsigned long ulPatchSize;
+	unsigned char *pucStaging;
+	unsigned long ulStagingSize;
+	unsigned long ulChangedBlocks;            /* out */
+} CMD_PARAMETER_PATCH_T;
+
+
+/*
+    The area [ulStartAdr, ulStartAdr+ulDataByteSize[ is written with the
+    first ulPatternSize bytes of aucPattern, repeated from the start of the
+    area. The area must be erased. The data is built in pucBuffer and
+    written one buffer full at a time.
+*/
+#define FILL_PATTERN_MAX 16
+
+typedef struct CMD_PARAMETER_FILL_STRUCT
+{
+	const DEVICE_DESCRIPTION_T *ptDeviceDescription;
+	unsigned long ulStartAdr;
+	unsigned long ulDataByteSize;
+	unsigned char *pucBuffer;
+	unsigned long ulBufferSize;
+	unsigned long ulPatternSize;
+	unsigned char aucPattern[FILL_PATTERN_MAX];
+} CMD_PARAMETER_FILL_T;
+
+
+/*
+    Copy [ulSrcAdr, ulSrcAdr+ulDataByteSize[ of the source device to
+    ulDstAdr of the destination device. ptSrcDeviceDescription can be NULL
+    for a copy inside the destination device. The data goes through
+    pucBuffer.
+    Without COPY_FLAG_Erase the destination must be erased. It is written
+    one buffer full at a time.
+    With COPY_FLAG_Erase each erase block of the destination is read to the
+    buffer, updated with the source data and only erased and written if it
+    changed. The buffer must hold the largest erase block. This mode is
+    needed if the areas overlap in the same device. The blocks are then
+    processed in the direction which reads all source data before it is
+    overwritten.
+*/
+#define COPY_FLAG_Erase 0x00000001U
+
+typedef struct CMD_PARAMETER_COPY_STRUCT
+{
+	const DEVICE_DESCRIPTION_T *ptDeviceDescription;      /* the destination device */
+	unsigned long ulDstAdr;
+	unsigned long ulDataByteSize;
+	const DEVICE_DESCRIPTION_T *ptSrcDeviceDescription;   /* the source device or NULL */
+	unsigned long ulSrcAdr;
+	unsigned char *pucBuffer;
+	unsigned long ulBufferSize;
+	unsigned long ulFlags;
+} CMD_PARAMETER_COPY_T;
+
+
+/*
+    ptEntries points to ulEntries complete parameter blocks. They are
+    executed in order. A batch can not contain another batch.
+    pulResults has 2 DWORDs for each entry: the result of the operation
+    (0 = OK) and its return message. Entries which were not executed get
+    BATCH_RESULT_NotExecuted in both DWORDs.
+    The batch stops at the first failed entry unless
+    BATCH_FLAG_ContinueOnError is set. It fails if any entry failed.
+*/
+#define BATCH_FLAG_ContinueOnError 0x00000001U
+#define BATCH_RESULT_NotExecuted   0xffffffffU
+
+struct tFlasherInputParameter_STRUCT;
+
+typedef struct CMD_PARAMETER_BATCH_STRUCT
+{
+	struct tFlasherInputParameter_STRUCT *ptEntries;
+	unsigned long ulEntries;
+	unsigned long ulFlags;
+	unsigned long *pulResults;
+} CMD_PARAMETER_BATCH_T;
+
+
 typedef struct tFlasherInputParameter_STRUCT
 {
 	unsigned long ulParamVersion;
@@ -183,6 +433,13 @@ typedef struct tFlasherInputParameter_STRUCT
 		CMD_PARAMETER_GETERASEAREA_T tGetEraseArea;
 		CMD_PARAMETER_GETBOARDINFO_T tGetBoardInfo;
 		CMD_PARAMETER_SPIMACROPLAYER_T tSpiMacroPlayer;
+		CMD_PARAMETER_ERASEFLASHVERIFY_T tEraseFlashVerify;
+		CMD_PARAMETER_BATCH_T tBatch;
+		CMD_PARAMETER_FLASHSTREAM_T tFlashStream;
+		CMD_PARAMETER_GETERASEMAP_T tGetEraseMap;
+		CMD_PARAMETER_PATCH_T tPatch;
+		CMD_PARAMETER_FILL_T tFill;
+		CMD_PARAMETER_COPY_T tCopy;
 	} uParameter;
 } tFlasherInputParameter;
 
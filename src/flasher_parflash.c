@@ -21,6 +21,7 @@
 #include "flasher_parflash.h"
 
 #include "asic_types.h"
+#include "mem_check.h"
 #include "progress_bar.h"
 #include "uprintf.h"
 #if ASIC_TYP==ASIC_TYP_NETX4000
@@ -53,6 +54,11 @@
 #endif /* CFG_DEBUGMSG!=0 */
 
 
+/* The verify and isErased operations check the flash in chunks of this size
+ * and update the progress bar after each chunk.
+ */
+#define PARFLASH_CHECK_CHUNK_SIZE 0x10000U
+
 
 #if ASIC_TYP==ASIC_TYP_NETX500 || ASIC_TYP==ASIC_TYP_NETX100 || ASIC_TYP==ASIC_TYP_NETX50
 /* in: ptCfg->uiChipSelect
@@ -490,8 +496,8 @@ NETX_CONSOLEAPP_RESULT_T parflash_getEraseArea(CMD_PARAMETER_GETERASEAREA_T *ptP
 	const FLASH_DEVICE_T *ptFlashDescription;
 	unsigned long ulStartAdr;
 	unsigned long ulEndAdr;
-	const SECTOR_INFO_T *ptSectorStart;
-	const SECTOR_INFO_T *ptSectorEnd;
+	SECTOR_INFO_T tSectorStart;
+	SECTOR_INFO_T tSectorEnd;
 	unsigned long ulEraseBlockStart;
 	unsigned long ulEraseBlockEnd;
 
@@ -500,13 +506,10 @@ NETX_CONSOLEAPP_RESULT_T parflash_getEraseArea(CMD_PARAMETER_GETERASEAREA_T *ptP
 	ulEndAdr  = ptParameter->ulEndAdr;
 
 	/* Look for the erase block which contains the start address. */
-	ptSectorStart = cfi_find_matching_sector(ptFlashDescription, ulStartAdr);
-	ptSectorEnd = cfi_find_matching_sector(ptFlashDescription, ulEndAdr-1);
-
-	if( ptSectorStart!=NULL && ptSectorEnd!=NULL )
+	if( cfi_find_matching_sector(ptFlashDescription, ulStartAdr, &tSectorStart)!=0xffffffffU && cfi_find_matching_sector(ptFlashDescription, ulEndAdr-1, &tSectorEnd)!=0xffffffffU )
 	{
-		ulEraseBlockStart = ptSectorStart->ulOffset;
-		ulEraseBlockEnd   = ptSectorEnd->ulOffset + ptSectorEnd->ulSize;
+		ulEraseBlockStart = tSectorStart.ulOffset;
+		ulEraseBlockEnd   = tSectorEnd.ulOffset + tSectorEnd.ulSize;
 
 		DEBUGMSG(ZONE_VERBOSE, ("requested area: [0x%08x, 0x%08x[\n", ulStartAdr, ulEndAdr));
 		DEBUGMSG(ZONE_VERBOSE, ("erase area:     [0x%08x, 0x%08x[\n", ulEraseBlockStart, ulEraseBlockEnd));
@@ -537,6 +540,8 @@ NETX_CONSOLEAPP_RESULT_T parflash_isErased(const CMD_PARAMETER_ISERASED_T *ptPar
 	ADR_T tEnd;
 	unsigned long ulProgressBarPosition;
 	unsigned long ulErased;
+	size_t sizChunk;
+	size_t sizOffset;
 
 	ptFlashDescription = &(ptParameter->ptDeviceDescription->uInfo.tParFlash);
 	ulStartAdr = ptParameter->ulStartAdr;
@@ -555,26 +560,31 @@ NETX_CONSOLEAPP_RESULT_T parflash_isErased(const CMD_PARAMETER_ISERASED_T *ptPar
 	tEnd.puc  = ptFlashDescription->pucFlashBase;
 	tEnd.puc += ulEndAdr;
 
-	/* Loop over the complete area. */
+	/* Loop over the complete area in chunks of 64K bytes. */
 	ulErased = 0xffU;
 	while( tCnt.puc<tEnd.puc )
 	{
-		ulErased &= *tCnt.puc;
-		if( ulErased!=0xff )
+		sizChunk = (size_t)(tEnd.puc - tCnt.puc);
+		if( sizChunk>PARFLASH_CHECK_CHUNK_SIZE )
+		{
+			sizChunk = PARFLASH_CHECK_CHUNK_SIZE;
+		}
+
+		sizOffset = mem_check_first_not_pattern(tCnt.puc, sizChunk, MEM_CHECK_ERASED_VALUE);
+		if( sizOffset<sizChunk )
 		{
+			tCnt.puc += sizOffset;
+			ulErased = *tCnt.puc;
 			uprintf("! Memory not erased at address 0x%08x - expected: 0x%02x found: 0x%02x\n", tCnt.ul, 0xff, ulErased);
 			break;
 		}
 		
-		++tCnt.puc;
+		tCnt.puc += sizChunk;
 		
-		/* Show progress every 64K bytes. */
-		if( (tCnt.ul&0xffff)==0 )
-		{
-			ulProgressBarPosition  = (unsigned long)(tCnt.puc - ptFlashDescription->pucFlashBase);
-			ulProgressBarPosition -= ulStartAdr;
-			progress_bar_set_position(ulProgressBarPosition);
-		}
+		/* Show progress after each chunk. */
+		ulProgressBarPosition  = (unsigned long)(tCnt.puc - ptFlashDescription->pucFlashBase);
+		ulProgressBarPosition -= ulStartAdr;
+		progress_bar_set_position(ulProgressBarPosition);
 	}
 
 	progress_bar_finalize();
@@ -621,7 +631,8 @@ static NETX_CONSOLEAPP_RESULT_T parflash_unlock(const FLASH_DEVICE_T *ptFlashDev
 static NETX_CONSOLEAPP_RESULT_T parflash_compare(
 	const FLASH_DEVICE_T *ptFlashDescription, 
 	unsigned long ulStartAdr, unsigned long ulEndAdr, 
-	const unsigned char* pucDataStartAdr);
+	const unsigned char* pucDataStartAdr,
+	MEM_CHECK_REPORT_T *ptReport);
 	
 NETX_CONSOLEAPP_RESULT_T parflash_flash(const CMD_PARAMETER_FLASH_T *ptParameter)
 {
@@ -634,7 +645,7 @@ NETX_CONSOLEAPP_RESULT_T parflash_flash(const CMD_PARAMETER_FLASH_T *ptParameter
 	unsigned long ulProgressBarPosition;
 	
 	const FLASH_DEVICE_T *ptFlashDescription;
-	const SECTOR_INFO_T *ptSector;
+	SECTOR_INFO_T tSector;
 	unsigned long ulSectorOffset;
 	
 	unsigned long ulChunkSize;
@@ -655,15 +666,14 @@ NETX_CONSOLEAPP_RESULT_T parflash_flash(const CMD_PARAMETER_FLASH_T *ptParameter
 		while( ulDataByteSize!=0 )
 		{
 			/* Split the data by erase sectors. */
-			ptSector = cfi_find_matching_sector(ptFlashDescription, ulFlashStartAdr);
-			if( ptSector==NULL )
+			if( cfi_find_matching_sector(ptFlashDescription, ulFlashStartAdr, &tSector)==0xffffffffU )
 			{
 				uprintf("Can not find sector in table!\n");
 				tResult = NETX_CONSOLEAPP_RESULT_ERROR;
 				break;
 			}
-			ulSectorOffset = ulFlashStartAdr - ptSector->ulOffset;
-			ulChunkSize = ptSector->ulSize - ulSectorOffset;
+			ulSectorOffset = ulFlashStartAdr - tSector.ulOffset;
+			ulChunkSize = tSector.ulSize - ulSectorOffset;
 			if( ulChunkSize>ulDataByteSize )
 			{
 				ulChunkSize = ulDataByteSize;
@@ -696,7 +706,7 @@ NETX_CONSOLEAPP_RESULT_T parflash_flash(const CMD_PARAMETER_FLASH_T *ptParameter
 		ulDataByteSize  = ptParameter->ulDataByteSize;
 		pucDataStartAdr = ptParameter->pucData;
 
-		tResult = parflash_compare(ptFlashDescription, ulFlashStartAdr, ulFlashStartAdr + ulDataByteSize, pucDataStartAdr);
+		tResult = parflash_compare(ptFlashDescription, ulFlashStartAdr, ulFlashStartAdr + ulDataByteSize, pucDataStartAdr, NULL);
 	}
 	return tResult;
 }
@@ -707,11 +717,14 @@ NETX_CONSOLEAPP_RESULT_T parflash_erase(const CMD_PARAMETER_ERASE_T *ptParameter
 	
 	unsigned long ulEraseStartAdr;
 	unsigned long ulEraseEndAdr;
-	unsigned long ulProgressBarPosition;
+	unsigned long ulSectorsLeft;
+	unsigned long ulSectorsErased;
+	unsigned long ulErasedCnt;
 	const FLASH_DEVICE_T *ptFlashDescription;
-	const SECTOR_INFO_T *ptSectors;
+	SECTOR_INFO_T tSector;
 	FLASH_ERRORS_E tFlashError;
 	size_t sizCnt;
+	size_t sizLast;
 
 	ulEraseStartAdr = ptParameter->ulStartAdr;
 	ulEraseEndAdr   = ptParameter->ulEndAdr;
@@ -720,12 +733,26 @@ NETX_CONSOLEAPP_RESULT_T parflash_erase(const CMD_PARAMETER_ERASE_T *ptParameter
 
 	tResult = NETX_CONSOLEAPP_RESULT_OK;
 	/* Split the data by erase sectors. */
-	sizCnt = cfi_find_matching_sector_index(ptFlashDescription, ulEraseStartAdr);
+	sizCnt = cfi_find_matching_sector(ptFlashDescription, ulEraseStartAdr, &tSector);
 	if( sizCnt==0xffffffffU )
 	{
 		uprintf("! Can not find sector in table!\n");
 		tResult = NETX_CONSOLEAPP_RESULT_ERROR;
 	}
+	else
+	{
+		/* Get the sector with the last byte of the area. An empty area still erases the first sector. */
+		sizLast = sizCnt;
+		if( ulEraseEndAdr>tSector.ulOffset+tSector.ulSize )
+		{
+			sizLast = cfi_find_matching_sector_index(ptFlashDescription, ulEraseEndAdr - 1U);
+			if( sizLast==0xffffffffU )
+			{
+				uprintf("! Can not find sector in table!\n");
+				tResult = NETX_CONSOLEAPP_RESULT_ERROR;
+			}
+		}
+	}
 	
 	if (tResult == NETX_CONSOLEAPP_RESULT_OK)
 	{
@@ -735,15 +762,23 @@ NETX_CONSOLEAPP_RESULT_T parflash_erase(const CMD_PARAMETER_ERASE_T *ptParameter
 	if (tResult == NETX_CONSOLEAPP_RESULT_OK)
 	{
 		uprintf("#Erasing...\n");
-		progress_bar_init(ulEraseEndAdr - ulEraseStartAdr);
-		ulProgressBarPosition = 0;
+		ulSectorsLeft = sizLast - sizCnt + 1U;
+		ulSectorsErased = 0;
+		progress_bar_init(ulSectorsLeft);
 		
-		ptSectors = ptFlashDescription->atSectors;
-		do
+		while( ulSectorsLeft!=0 )
 		{
-			DEBUGMSG(ZONE_VERBOSE, (". Erasing sector %d: [0x%08x, 0x%08x[\n", 
-				sizCnt, ptSectors[sizCnt].ulOffset,ptSectors[sizCnt].ulOffset+ptSectors[sizCnt].ulSize));
-			tFlashError = ptFlashDescription->tFlashFunctions.pfnErase(ptFlashDescription, sizCnt);
+			DEBUGMSG(ZONE_VERBOSE, (". Erasing %d sectors from sector %d\n", ulSectorsLeft, sizCnt));
+			/* Queue several sectors in one erase cycle if the flash supports it. */
+			if( ptFlashDescription->tFlashFunctions.pfnEraseSectors!=NULL )
+			{
+				tFlashError = ptFlashDescription->tFlashFunctions.pfnEraseSectors(ptFlashDescription, sizCnt, ulSectorsLeft, &ulErasedCnt);
+			}
+			else
+			{
+				tFlashError = ptFlashDescription->tFlashFunctions.pfnErase(ptFlashDescription, sizCnt);
+				ulErasedCnt = 1;
+			}
 			if( tFlashError!=eFLASH_NO_ERROR )
 			{
 				/* failed to erase the sector */
@@ -752,14 +787,14 @@ NETX_CONSOLEAPP_RESULT_T parflash_erase(const CMD_PARAMETER_ERASE_T *ptParameter
 				break;
 			}
 			
-			/* Show progress */
-			ulProgressBarPosition += ptSectors[sizCnt].ulSize;
-			progress_bar_set_position(ulProgressBarPosition);
-			
-			/* Next sector. */
-			++sizCnt;
+			/* Show progress in completed sectors. */
+			ulSectorsErased += ulErasedCnt;
+			progress_bar_set_position(ulSectorsErased);
 			
-		} while( sizCnt<ptFlashDescription->ulSectorCnt && ptSectors[sizCnt].ulOffset<ulEraseEndAdr );
+			/* Next sectors. */
+			sizCnt += ulErasedCnt;
+			ulSectorsLeft -= ulErasedCnt;
+		}
 		uprintf(". Erase complete.\n");
 		progress_bar_finalize();
 	}
@@ -824,8 +859,8 @@ NETX_CONSOLEAPP_RESULT_T parflash_read(const CMD_PARAMETER_READ_T *ptParameter)
 	return tResult;
 }
 
-#if CFG_INCLUDE_SHA1!=0
-NETX_CONSOLEAPP_RESULT_T parflash_sha1(const CMD_PARAMETER_CHECKSUM_T *ptParameter, SHA_CTX *ptSha1Context)
+#if CFG_INCLUDE_CHECKSUM!=0
+NETX_CONSOLEAPP_RESULT_T parflash_checksum(const CMD_PARAMETER_CHECKSUM_T *ptParameter, CHECKSUM_CONTEXT_T *ptChecksumContext)
 {
 	NETX_CONSOLEAPP_RESULT_T tResult;
 	
@@ -854,7 +889,7 @@ NETX_CONSOLEAPP_RESULT_T parflash_sha1(const CMD_PARAMETER_CHECKSUM_T *ptParamet
 		}
 		
 		pvFlashAddr = (const void*)(ptFlashDescription->pucFlashBase + ulStartAdr + ulOffset);
-		SHA1_Update(ptSha1Context, pvFlashAddr, ulBlockSize);
+		checksum_update(ptChecksumContext, pvFlashAddr, ulBlockSize);
 		
 		ulOffset += ulBlockSize;
 		
@@ -872,14 +907,19 @@ NETX_CONSOLEAPP_RESULT_T parflash_sha1(const CMD_PARAMETER_CHECKSUM_T *ptParamet
    NETX_CONSOLEAPP_RESULT_OK: equal, 
    NETX_CONSOLEAPP_RESULT_ERROR: not equal 
  */
-static NETX_CONSOLEAPP_RESULT_T parflash_compare(const FLASH_DEVICE_T *ptFlashDescription, unsigned long ulStartAdr, unsigned long ulEndAdr, const unsigned char* pucDataStartAdr)
+static NETX_CONSOLEAPP_RESULT_T parflash_compare(const FLASH_DEVICE_T *ptFlashDescription, unsigned long ulStartAdr, unsigned long ulEndAdr, const unsigned char* pucDataStartAdr, MEM_CHECK_REPORT_T *ptReport)
 {
+	NETX_CONSOLEAPP_RESULT_T tResult;
 	/* src/srcEnd point to Flash; dst, points to RAM */
 	CADR_T tSrc;
 	CADR_T tDst;
 	CADR_T tSrcEnd;
 	
 	unsigned long ulProgressBarPosition;
+	size_t sizChunk;
+	size_t sizOffset;
+
+	tResult = NETX_CONSOLEAPP_RESULT_OK;
 
 	uprintf("# Verifying...\n");
 
@@ -897,25 +937,52 @@ static NETX_CONSOLEAPP_RESULT_T parflash_compare(const FLASH_DEVICE_T *ptFlashDe
 	progress_bar_init(ulEndAdr-ulStartAdr);
 	ulProgressBarPosition = 0;
 	
-	/* Loop over the complete area. */
+	/* Loop over the complete area in chunks of 64K bytes. */
 	while( tSrc.puc<tSrcEnd.puc )
 	{
-		if (*tDst.puc != *tSrc.puc) 
+		sizChunk = (size_t)(tSrcEnd.puc - tSrc.puc);
+		if( sizChunk>PARFLASH_CHECK_CHUNK_SIZE )
 		{
-			uprintf("! verify error at address 0x%08x. buffer: 0x%02x, flash: 0x%02x.\n", tSrc.ul, *tDst.puc, *tSrc.puc);
-			return NETX_CONSOLEAPP_RESULT_ERROR;
+			sizChunk = PARFLASH_CHECK_CHUNK_SIZE;
 		}
-		++tDst.puc;
-		++tSrc.puc;
-		++ulProgressBarPosition;
 
-		/* Show progress every 64K bytes. */
-		if( (ulProgressBarPosition&0xffff)==0 )
+		if( ptReport!=NULL )
 		{
-			progress_bar_set_position(ulProgressBarPosition);
+			/* Collect all differences and continue with the next chunk. */
+			if( mem_check_report_differences(ptReport, ulStartAdr + ulProgressBarPosition, tSrc.puc, tDst.puc, sizChunk)!=0 )
+			{
+				tResult = NETX_CONSOLEAPP_RESULT_ERROR;
+			}
+		}
+		else
+		{
+			sizOffset = mem_check_first_difference(tSrc.puc, tDst.puc, sizChunk);
+			if( sizOffset<sizChunk )
+			{
+				tDst.puc += sizOffset;
+				tSrc.puc += sizOffset;
+				uprintf("! verify error at address 0x%08x. buffer: 0x%02x, flash: 0x%02x.\n", tSrc.ul, *tDst.puc, *tSrc.puc);
+				return NETX_CONSOLEAPP_RESULT_ERROR;
+			}
 		}
+		tDst.puc += sizChunk;
+		tSrc.puc += sizChunk;
+		ulProgressBarPosition += sizChunk;
+
+		/* Show progress after each chunk. */
+		progress_bar_set_position(ulProgressBarPosition);
 	}
 	progress_bar_finalize();
+
+	if( ptReport!=NULL )
+	{
+		mem_check_report_finalize(ptReport);
+		if( tResult!=NETX_CONSOLEAPP_RESULT_OK )
+		{
+			uprintf("! verify error, found %d different areas.\n", ptReport->sizRanges);
+			return tResult;
+		}
+	}
 	
 	uprintf(". verify ok\n");
 	return NETX_CONSOLEAPP_RESULT_OK;
@@ -925,7 +992,7 @@ static NETX_CONSOLEAPP_RESULT_T parflash_compare(const FLASH_DEVICE_T *ptFlashDe
    the value stored in ptConsoleParams->pvReturnMessage is the result of the comparison.
    0 = equal, 1 = not equal
 */
-NETX_CONSOLEAPP_RESULT_T parflash_verify(const CMD_PARAMETER_VERIFY_T *ptParameter, NETX_CONSOLEAPP_PARAMETER_T *ptConsoleParams)
+NETX_CONSOLEAPP_RESULT_T parflash_verify(const CMD_PARAMETER_VERIFY_T *ptParameter, MEM_CHECK_REPORT_T *ptReport, NETX_CONSOLEAPP_PARAMETER_T *ptConsoleParams)
 {
 	NETX_CONSOLEAPP_RESULT_T tResult;
 	NETX_CONSOLEAPP_RESULT_T tEqual;
@@ -941,7 +1008,7 @@ NETX_CONSOLEAPP_RESULT_T parflash_verify(const CMD_PARAMETER_VERIFY_T *ptParamet
 	pucDataStartAdr = ptParameter->pucData;
 	
 	tResult = NETX_CONSOLEAPP_RESULT_OK;
-	tEqual = parflash_compare(ptFlashDescription, ulStartAdr, ulEndAdr, pucDataStartAdr);
+	tEqual = parflash_compare(ptFlashDescription, ulStartAdr, ulEndAdr, pucDataStartAdr, ptReport);
 	ptConsoleParams->pvReturnMessage = (void*)tEqual;
 	
 	return tResult;
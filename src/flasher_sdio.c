@@ -22,6 +22,7 @@
 #include "portcontrol.h"
 #include "uprintf.h"
 #include "progress_bar.h"
+#include "mem_check.h"
 
 /* Detection is unreliable when JTAG is used. 
    The problem does not seem to occur when ulInitialSpeedKHz is set to 800, 
@@ -235,8 +236,8 @@ NETX_CONSOLEAPP_RESULT_T sdio_read(CMD_PARAMETER_READ_T *ptParams)
 }
 
 
-#if CFG_INCLUDE_SHA1!=0
-NETX_CONSOLEAPP_RESULT_T sdio_sha1(CMD_PARAMETER_CHECKSUM_T *ptParams, SHA_CTX *ptSha1Context)
+#if CFG_INCLUDE_CHECKSUM!=0
+NETX_CONSOLEAPP_RESULT_T sdio_checksum(CMD_PARAMETER_CHECKSUM_T *ptParams, CHECKSUM_CONTEXT_T *ptChecksumContext)
 {
 	NETX_CONSOLEAPP_RESULT_T tResult;
 	
@@ -260,7 +261,7 @@ NETX_CONSOLEAPP_RESULT_T sdio_sha1(CMD_PARAMETER_CHECKSUM_T *ptParams, SHA_CTX *
 			break;
 		}
 		
-		SHA1_Update(ptSha1Context, (const void*)(tFlashPos.tSector.auc + tFlashPos.ulSectorOffset), tFlashPos.ulChunkLength);
+		checksum_update(ptChecksumContext, (const void*)(tFlashPos.tSector.auc + tFlashPos.ulSectorOffset), tFlashPos.ulChunkLength);
 
 		flashpos_skip_chunk(&tFlashPos);
 	}
@@ -284,10 +285,11 @@ NETX_CONSOLEAPP_RESULT_T sdio_sha1(CMD_PARAMETER_CHECKSUM_T *ptParams, SHA_CTX *
 		ptConsoleParams->pvReturnMessage != 0: the data differs
 	return value != NETX_CONSOLEAPP_RESULT_OK: an error occurred
 */
-NETX_CONSOLEAPP_RESULT_T sdio_verify(CMD_PARAMETER_VERIFY_T *ptParams, unsigned long *pulVerifyResult)
+NETX_CONSOLEAPP_RESULT_T sdio_verify(CMD_PARAMETER_VERIFY_T *ptParams, MEM_CHECK_REPORT_T *ptReport, unsigned long *pulVerifyResult)
 {
 	NETX_CONSOLEAPP_RESULT_T tResult;
 	int fEqual; /* ==0: equal, !=0: not equal */
+	int fDifferent; /* !=0: the report has entries */
 
 	FLASH_POSITIONS_T tFlashPos;
 	const SDIO_HANDLE_T *ptSdioHandle;
@@ -295,11 +297,12 @@ NETX_CONSOLEAPP_RESULT_T sdio_verify(CMD_PARAMETER_VERIFY_T *ptParams, unsigned
 	unsigned long ulFlashAdr; /* device offset (for error message) */
 	unsigned char *pucBuffer; /* buffer position */
 	unsigned char *pucSector; /* sector position */
-	unsigned char *pucSectorEnd;
+	size_t sizOffset;
 	
 	/* assume success */
 	tResult = NETX_CONSOLEAPP_RESULT_OK;
 	fEqual = 0;
+	fDifferent = 0;
 	
 	ptSdioHandle = &ptParams->ptDeviceDescription->uInfo.tSdioHandle;
 	
@@ -318,26 +321,39 @@ NETX_CONSOLEAPP_RESULT_T sdio_verify(CMD_PARAMETER_VERIFY_T *ptParams, unsigned
 		}
 		
 		pucSector = tFlashPos.tSector.auc+tFlashPos.ulSectorOffset;
-		pucSectorEnd = pucSector+tFlashPos.ulChunkLength;
 		
-		while (pucSector < pucSectorEnd)
+		if( ptReport!=NULL )
 		{
-			if (*pucSector != *pucBuffer) {
+			/* Collect all differences and continue with the next chunk. */
+			if( mem_check_report_differences(ptReport, ulFlashAdr, pucSector, pucBuffer, tFlashPos.ulChunkLength)!=0 )
+			{
+				fDifferent = 1;
+			}
+		}
+		else
+		{
+			sizOffset = mem_check_first_difference(pucSector, pucBuffer, tFlashPos.ulChunkLength);
+			if( sizOffset<tFlashPos.ulChunkLength )
+			{
 				uprintf("! verify error at address 0x%08x. buffer: 0x%02x, flash: 0x%02x.\n", 
-				ulFlashAdr, *pucBuffer, *pucSector); 
+				ulFlashAdr + sizOffset, pucBuffer[sizOffset], pucSector[sizOffset]); 
 				fEqual = 1;
-				break;
 			}
-			++pucSector;
-			++pucBuffer;
-			++ulFlashAdr;
 		}
+		pucBuffer += tFlashPos.ulChunkLength;
+		ulFlashAdr += tFlashPos.ulChunkLength;
 		
 		flashpos_skip_chunk(&tFlashPos);
 	}
 	
 	if (tResult == NETX_CONSOLEAPP_RESULT_OK)
 	{
+		if( ptReport!=NULL )
+		{
+			mem_check_report_finalize(ptReport);
+			fEqual = fDifferent;
+		}
+
 		if( fEqual==0 )
 		{
 			uprintf(". Verify OK. The data in the memory and the flash are identical.\n");
@@ -400,7 +416,9 @@ NETX_CONSOLEAPP_RESULT_T sdio_write(CMD_PARAMETER_FLASH_T *ptParams)
 		tVerifyParams.ulStartAdr = ptParams->ulStartAdr;
 		tVerifyParams.ulEndAdr   = ptParams->ulStartAdr + ptParams->ulDataByteSize; 
 		tVerifyParams.pucData    = ptParams->pucData;
-		tResult = sdio_verify (&tVerifyParams, &ulVerifyResult);
+		tVerifyParams.pucReport  = NULL;
+		tVerifyParams.sizReport  = 0;
+		tResult = sdio_verify (&tVerifyParams, NULL, &ulVerifyResult);
 
 		if ((tResult != NETX_CONSOLEAPP_RESULT_OK) || ulVerifyResult != 0)
 		{
@@ -508,7 +526,7 @@ NETX_CONSOLEAPP_RESULT_T sdio_is_erased(CMD_PARAMETER_ISERASED_T *ptParams, unsi
 	
 	unsigned long ulFlashAdr; /* device offset (for error message) */
 	unsigned char *pucCnt;
-	unsigned char *pucEnd;
+	size_t sizOffset;
 	
 	/* assume success */
 	tResult = NETX_CONSOLEAPP_RESULT_OK;
@@ -529,18 +547,14 @@ NETX_CONSOLEAPP_RESULT_T sdio_is_erased(CMD_PARAMETER_ISERASED_T *ptParams, unsi
 		}
 		
 		pucCnt = tFlashPos.tSector.auc+tFlashPos.ulSectorOffset;
-		pucEnd = pucCnt+tFlashPos.ulChunkLength;
 		
-		while (pucCnt < pucEnd)
+		sizOffset = mem_check_first_not_pattern(pucCnt, tFlashPos.ulChunkLength, 0);
+		if( sizOffset<tFlashPos.ulChunkLength )
 		{
-			if (*pucCnt != 0) {
-				uprintf("! not erased at address 0x%08x - expected: 0x%02x found: 0x%02x\n", ulFlashAdr, 0, *pucCnt);
-				fIsErased = 1;
-				break;
-			}
-			++pucCnt;
-			++ulFlashAdr;
+			uprintf("! not erased at address 0x%08x - expected: 0x%02x found: 0x%02x\n", ulFlashAdr + sizOffset, 0, pucCnt[sizOffset]);
+			fIsErased = 1;
 		}
+		ulFlashAdr += tFlashPos.ulChunkLength;
 		
 		flashpos_skip_chunk(&tFlashPos);
 	}
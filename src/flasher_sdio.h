@@ -21,21 +21,19 @@
 #define __NETX4000_SDIO_WRAP__
 
 #include "flasher_interface.h"
-#if CFG_INCLUDE_SHA1!=0
-#       include "sha1.h"
-#endif
+#include "checksum.h"
  
 
 NETX_CONSOLEAPP_RESULT_T sdio_detect_wrap(SDIO_HANDLE_T *ptSdioHandle);
 NETX_CONSOLEAPP_RESULT_T sdio_read(CMD_PARAMETER_READ_T *ptParams);
 NETX_CONSOLEAPP_RESULT_T sdio_write(CMD_PARAMETER_FLASH_T *ptParams);
-NETX_CONSOLEAPP_RESULT_T sdio_verify(CMD_PARAMETER_VERIFY_T *ptParams, unsigned long *pulVerifyResult);
+NETX_CONSOLEAPP_RESULT_T sdio_verify(CMD_PARAMETER_VERIFY_T *ptParams, MEM_CHECK_REPORT_T *ptReport, unsigned long *pulVerifyResult);
 NETX_CONSOLEAPP_RESULT_T sdio_erase(CMD_PARAMETER_ERASE_T *ptParams);
 NETX_CONSOLEAPP_RESULT_T sdio_is_erased(CMD_PARAMETER_ISERASED_T *ptParams, unsigned long *pulIsErasedResult);
 
 NETX_CONSOLEAPP_RESULT_T sdio_get_erase_area(CMD_PARAMETER_GETERASEAREA_T *ptParameter);
-#if CFG_INCLUDE_SHA1!=0
-NETX_CONSOLEAPP_RESULT_T sdio_sha1(CMD_PARAMETER_CHECKSUM_T *ptParams, SHA_CTX *ptSha1Context);
+#if CFG_INCLUDE_CHECKSUM!=0
+NETX_CONSOLEAPP_RESULT_T sdio_checksum(CMD_PARAMETER_CHECKSUM_T *ptParams, CHECKSUM_CONTEXT_T *ptChecksumContext);
 #endif
 #endif /* __NETX4000_SDIO_WRAP__ */
 
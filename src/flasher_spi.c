@@ -44,6 +44,17 @@
 #define SPI_BUFFER_SIZE 8192
 unsigned char pucSpiBuffer[SPI_BUFFER_SIZE];
 
+/* The buffer for the segments of spi_read_segments. This is pucSpiBuffer
+ * or a larger free area set with spi_set_segment_buffer.
+ */
+static unsigned char *pucSegmentBuffer = pucSpiBuffer;
+static size_t sizSegmentBuffer = SPI_BUFFER_SIZE;
+
+/* Reads into the destination are split in pieces of this size only to
+ * update the progress bar. They are still one read command.
+ */
+#define SPI_READ_PROGRESS_STEP 0x10000U
+
 /*-----------------------------------*/
 
 static NETX_CONSOLEAPP_RESULT_T spi_write_with_progress(const FLASHER_SPI_FLASH_T *ptFlashDev, unsigned long ulFlashStartAdr, unsigned long ulDataByteLen, const unsigned char *pucDataStartAdr)
@@ -136,13 +147,29 @@ static NETX_CONSOLEAPP_RESULT_T spi_write_with_progress(const FLASHER_SPI_FLASH_
 
 		if( tResult==NETX_CONSOLEAPP_RESULT_OK )
 		{
-			/* process complete pages */
+			/* process complete pages
+			 * Pass several pages at once to the driver. Devices with more than one
+			 * buffer can load the next page while the previous one is programmed.
+			 */
+			ulMaxSegSize = (SPI_BUFFER_SIZE / ulPageSize) * ulPageSize;
 			while( ulC+ulPageSize<ulE )
 			{
-				/* write one page */
-				iResult = Drv_SpiWritePage(ptFlashDev, ulC, pucDC, ulPageSize);
-/*				iResult = Drv_SpiEraseAndWritePage(ptFlashDev, ulC, ulPageSize, pucDC); */
-				if( iResult!=0 )
+				/* get all complete pages, limit them to 'ulMaxSegSize' */
+				ulSegSize = ((ulE - ulC - 1U) / ulPageSize) * ulPageSize;
+				if( ulSegSize>ulMaxSegSize )
+				{
+					ulSegSize = ulMaxSegSize;
+				}
+
+				/* write the pages */
+				iResult = Drv_SpiWritePages(ptFlashDev, ulC, pucDC, ulSegSize);
+				if( iResult==SPI_FLASH_STATUS_ERROR )
+				{
+					uprintf("! the device reported a program error in [0x%08x, 0x%08x[\n", ulC, ulC+ulSegSize);
+					tResult = NETX_CONSOLEAPP_RESULT_ERROR;
+					break;
+				}
+				else if( iResult!=0 )
 				{
 					uprintf("! write error\n");
 					tResult = NETX_CONSOLEAPP_RESULT_ERROR;
@@ -150,11 +177,11 @@ static NETX_CONSOLEAPP_RESULT_T spi_write_with_progress(const FLASHER_SPI_FLASH_
 				}
 
 				/* next segment */
-				ulC += ulPageSize;
-				pucDC += ulPageSize;
+				ulC += ulSegSize;
+				pucDC += ulSegSize;
 
 				/* inc progress */
-				ulProgressCnt += ulPageSize;
+				ulProgressCnt += ulSegSize;
 				progress_bar_set_position(ulProgressCnt);
 			}
 
@@ -201,168 +228,291 @@ static NETX_CONSOLEAPP_RESULT_T spi_write_with_progress(const FLASHER_SPI_FLASH_
 }
 
 
-static NETX_CONSOLEAPP_RESULT_T spi_verify_with_progress(const FLASHER_SPI_FLASH_T *ptFlashDev, unsigned long ulFlashStartAdr, unsigned long ulDataByteLen, const unsigned char *pucDataStartAdr)
+/**
+ * @brief Set the buffer for checksum, verify and isErased.
+ *
+ * Larger segments mean less work per byte. The buffer must stay free until
+ * the operation is finished. If the buffer is not larger than the internal
+ * one, the internal buffer is used.
+ *
+ * @param pucBuffer [in] Start of a free area in the RAM.
+ * @param sizBuffer [in] Size of the area in bytes.
+ */
+void spi_set_segment_buffer(unsigned char *pucBuffer, size_t sizBuffer)
 {
-	int iResult;
-	unsigned long       ulC, ulE;
-	unsigned long       ulSegSize, ulMaxSegSize;
-	unsigned long       ulProgressCnt;
-	unsigned char       *pucCmp0;
-	const unsigned char *pucCmp1;
-	const unsigned char *pucDC;
-	size_t sizCmpCnt;
+	if( pucBuffer!=NULL && sizBuffer>SPI_BUFFER_SIZE )
+	{
+		pucSegmentBuffer = pucBuffer;
+		sizSegmentBuffer = sizBuffer;
+	}
+	else
+	{
+		pucSegmentBuffer = pucSpiBuffer;
+		sizSegmentBuffer = SPI_BUFFER_SIZE;
+	}
+}
 
 
-	uprintf("# Verifying...\n");
+/* This callback gets the segments of a continuous read.
+ * It returns 0 to continue with the next segment or something else to stop.
+ */
+typedef int (*PFN_SPI_READ_SEGMENT_T)(void *pvUser, unsigned long ulFlashAdr, const unsigned char *pucData, size_t sizData);
+
+
+/**
+ * @brief Read an area of the flash in segments and pass them to a callback.
+ *
+ * The area is read with one continuous read command. The slave stays
+ * selected between the segments, so the command, address and dummy bytes
+ * are sent only once for the complete area.
+ *
+ * @param ptFlashDev      [in] Device information returned by spi_detect.
+ * @param ulFlashStartAdr [in] Start offset in the flash memory.
+ * @param ulFlashEndAdr   [in] End offset (offset of the last byte +1).
+ * @param pfnSegment      [in] The callback for each segment.
+ * @param pvUser          [in] Passed to the callback.
+ *
+ * @return
+ * - NETX_CONSOLEAPP_RESULT_OK: all segments were read or the callback stopped the read
+ * - NETX_CONSOLEAPP_RESULT_ERROR: failed to read from the flash
+ */
+static NETX_CONSOLEAPP_RESULT_T spi_read_segments(const FLASHER_SPI_FLASH_T *ptFlashDev, unsigned long ulFlashStartAdr, unsigned long ulFlashEndAdr, PFN_SPI_READ_SEGMENT_T pfnSegment, void *pvUser)
+{
+	NETX_CONSOLEAPP_RESULT_T tResult;
+	unsigned long ulC;
+	unsigned long ulSegSize;
+	int iResult;
 
-	ulMaxSegSize = SPI_BUFFER_SIZE;
 
-	/* loop over all data */
-	ulC = ulFlashStartAdr;
-	ulE = ulC + ulDataByteLen;
-	pucDC = pucDataStartAdr;
+	tResult = NETX_CONSOLEAPP_RESULT_OK;
 
-	ulProgressCnt = 0;
-	progress_bar_init(ulDataByteLen);
+	progress_bar_init(ulFlashEndAdr-ulFlashStartAdr);
 
-	while( ulC<ulE )
+	if( ulFlashStartAdr<ulFlashEndAdr )
 	{
-		/* get the next segment, limit it to 'ulMaxSegSize' */
-		ulSegSize = ulE - ulC;
-		if( ulSegSize>ulMaxSegSize )
-		{
-			ulSegSize = ulMaxSegSize;
-		}
-
-		/* read the segment */
-		iResult = Drv_SpiReadFlash(ptFlashDev, ulC, pucSpiBuffer, ulSegSize);
+		iResult = Drv_SpiReadFlashStart(ptFlashDev, ulFlashStartAdr);
 		if( iResult!=0 )
 		{
-			return NETX_CONSOLEAPP_RESULT_ERROR;
+			tResult = NETX_CONSOLEAPP_RESULT_ERROR;
 		}
-
-		/* compare... */
-		pucCmp0 = pucSpiBuffer;
-		pucCmp1 = pucDC;
-		sizCmpCnt = 0;
-		while( sizCmpCnt<ulSegSize )
+		else
 		{
-			if( pucCmp0[sizCmpCnt]!=pucCmp1[sizCmpCnt] )
+			ulC = ulFlashStartAdr;
+			while( ulC<ulFlashEndAdr )
 			{
-				uprintf(". verify error at offset 0x%08x. buffer: 0x%02x, flash: 0x%02x.\n", ulC + sizCmpCnt, pucCmp1[sizCmpCnt], pucCmp0[sizCmpCnt]);
-				return NETX_CONSOLEAPP_RESULT_ERROR;
-			}
-			++sizCmpCnt;
-		}
+				/* get the next segment, limit it to the buffer size */
+				ulSegSize = ulFlashEndAdr - ulC;
+				if( ulSegSize>sizSegmentBuffer )
+				{
+					ulSegSize = sizSegmentBuffer;
+				}
+
+				/* read the segment */
+				iResult = Drv_SpiReadFlashContinue(ptFlashDev, pucSegmentBuffer, ulSegSize);
+				if( iResult!=0 )
+				{
+					tResult = NETX_CONSOLEAPP_RESULT_ERROR;
+					break;
+				}
 
-		/* next segment */
-		ulC += ulSegSize;
-		pucDC += ulSegSize;
+				/* next segment */
+				ulC += ulSegSize;
 
-		/* inc progress */
-		ulProgressCnt += ulSegSize;
-		progress_bar_set_position(ulProgressCnt);
+				/* inc progress */
+				progress_bar_set_position(ulC - ulFlashStartAdr);
+
+				iResult = pfnSegment(pvUser, ulC - ulSegSize, pucSegmentBuffer, ulSegSize);
+				if( iResult!=0 )
+				{
+					break;
+				}
+			}
+
+			iResult = Drv_SpiReadFlashStop(ptFlashDev);
+			if( iResult!=0 )
+			{
+				tResult = NETX_CONSOLEAPP_RESULT_ERROR;
+			}
+		}
 	}
 
 	progress_bar_finalize();
-	uprintf(". verify ok\n");
 
-	/* compare ok! */
-	return NETX_CONSOLEAPP_RESULT_OK;
+	return tResult;
 }
 
 
-static NETX_CONSOLEAPP_RESULT_T spi_read_with_progress(const FLASHER_SPI_FLASH_T *ptFlashDev, unsigned long ulFlashStartAdr, unsigned long ulFlashEndAdr, unsigned char *pucDataAdr)
+typedef struct SPI_VERIFY_STATE_STRUCT
 {
-	unsigned long ulSegSize, ulMaxSegSize;
-	unsigned long ulProgressCnt;
-	int iResult;
+	unsigned long ulFlashStartAdr;
+	const unsigned char *pucDataStartAdr;
+	MEM_CHECK_REPORT_T *ptReport;
+	int iDifferent;
+} SPI_VERIFY_STATE_T;
 
 
-	uprintf("# Reading...\n");
+static int spi_verify_segment(void *pvUser, unsigned long ulFlashAdr, const unsigned char *pucData, size_t sizData)
+{
+	SPI_VERIFY_STATE_T *ptState;
+	const unsigned char *pucDC;
+	size_t sizCmpCnt;
+	int iStop;
 
-	ulMaxSegSize = SPI_BUFFER_SIZE;
 
-	ulProgressCnt = 0;
-	progress_bar_init(ulFlashEndAdr-ulFlashStartAdr);
+	ptState = (SPI_VERIFY_STATE_T*)pvUser;
+	pucDC = ptState->pucDataStartAdr + (ulFlashAdr - ptState->ulFlashStartAdr);
 
-	while( ulFlashStartAdr<ulFlashEndAdr )
+	iStop = 0;
+	if( ptState->ptReport!=NULL )
 	{
-		/* get the next segment, limit it to 'ulMaxSegSize' */
-		ulSegSize = ulFlashEndAdr - ulFlashStartAdr;
-		if( ulSegSize>ulMaxSegSize )
+		/* Collect all differences and continue with the next segment. */
+		if( mem_check_report_differences(ptState->ptReport, ulFlashAdr, pucData, pucDC, sizData)!=0 )
 		{
-			ulSegSize = ulMaxSegSize;
+			ptState->iDifferent = 1;
 		}
-
-		/* read the segment */
-		iResult = Drv_SpiReadFlash(ptFlashDev, ulFlashStartAdr, pucDataAdr, ulSegSize);
-		if( iResult!=0 )
+	}
+	else
+	{
+		sizCmpCnt = mem_check_first_difference(pucData, pucDC, sizData);
+		if( sizCmpCnt<sizData )
 		{
-			return NETX_CONSOLEAPP_RESULT_ERROR;
+			uprintf(". verify error at offset 0x%08x. buffer: 0x%02x, flash: 0x%02x.\n", ulFlashAdr + sizCmpCnt, pucDC[sizCmpCnt], pucData[sizCmpCnt]);
+			ptState->iDifferent = 1;
+			iStop = 1;
 		}
+	}
 
-		/* next segment */
-		ulFlashStartAdr += ulSegSize;
-		pucDataAdr += ulSegSize;
+	return iStop;
+}
 
-		/* inc progress */
-		ulProgressCnt += ulSegSize;
-		progress_bar_set_position(ulProgressCnt);
+
+static NETX_CONSOLEAPP_RESULT_T spi_verify_with_progress(const FLASHER_SPI_FLASH_T *ptFlashDev, unsigned long ulFlashStartAdr, unsigned long ulDataByteLen, const unsigned char *pucDataStartAdr, MEM_CHECK_REPORT_T *ptReport)
+{
+	NETX_CONSOLEAPP_RESULT_T tResult;
+	SPI_VERIFY_STATE_T tState;
+
+
+	uprintf("# Verifying...\n");
+
+	tState.ulFlashStartAdr = ulFlashStartAdr;
+	tState.pucDataStartAdr = pucDataStartAdr;
+	tState.ptReport = ptReport;
+	tState.iDifferent = 0;
+
+	tResult = spi_read_segments(ptFlashDev, ulFlashStartAdr, ulFlashStartAdr + ulDataByteLen, spi_verify_segment, &tState);
+	if( tResult!=NETX_CONSOLEAPP_RESULT_OK )
+	{
+		return tResult;
 	}
 
-	progress_bar_finalize();
-	uprintf(". read ok\n");
+	if( ptReport!=NULL )
+	{
+		mem_check_report_finalize(ptReport);
+		if( tState.iDifferent!=0 )
+		{
+			uprintf("! verify error, found %d different areas.\n", ptReport->sizRanges);
+		}
+	}
+
+	if( tState.iDifferent!=0 )
+	{
+		return NETX_CONSOLEAPP_RESULT_ERROR;
+	}
 
-	/* read ok! */
+	uprintf(". verify ok\n");
+
+	/* compare ok! */
 	return NETX_CONSOLEAPP_RESULT_OK;
 }
 
-#if CFG_INCLUDE_SHA1!=0
-static NETX_CONSOLEAPP_RESULT_T spi_sha1_with_progress(const FLASHER_SPI_FLASH_T *ptFlashDev, unsigned long ulFlashStartAdr, unsigned long ulFlashEndAdr, SHA_CTX *ptSha1Context)
+
+static NETX_CONSOLEAPP_RESULT_T spi_read_with_progress(const FLASHER_SPI_FLASH_T *ptFlashDev, unsigned long ulFlashStartAdr, unsigned long ulFlashEndAdr, unsigned char *pucDataAdr)
 {
-	unsigned long ulSegSize, ulMaxSegSize;
-	unsigned long ulProgressCnt;
+	NETX_CONSOLEAPP_RESULT_T tResult;
+	unsigned long ulC;
+	unsigned long ulSegSize;
 	int iResult;
 
-	uprintf("# Calculating hash...\n");
 
-	ulMaxSegSize = SPI_BUFFER_SIZE;
+	uprintf("# Reading...\n");
+
+	tResult = NETX_CONSOLEAPP_RESULT_OK;
 
-	ulProgressCnt = 0;
 	progress_bar_init(ulFlashEndAdr-ulFlashStartAdr);
 
-	while( ulFlashStartAdr<ulFlashEndAdr )
+	/* Read directly into the destination with one read command. */
+	if( ulFlashStartAdr<ulFlashEndAdr )
 	{
-		/* get the next segment, limit it to 'ulMaxSegSize' */
-		ulSegSize = ulFlashEndAdr - ulFlashStartAdr;
-		if( ulSegSize>ulMaxSegSize )
-		{
-			ulSegSize = ulMaxSegSize;
-		}
-
-		/* read the segment */
-		iResult = Drv_SpiReadFlash(ptFlashDev, ulFlashStartAdr, pucSpiBuffer, ulSegSize);
+		iResult = Drv_SpiReadFlashStart(ptFlashDev, ulFlashStartAdr);
 		if( iResult!=0 )
 		{
-			return NETX_CONSOLEAPP_RESULT_ERROR;
+			tResult = NETX_CONSOLEAPP_RESULT_ERROR;
 		}
-		
-		SHA1_Update(ptSha1Context, (const void*)pucSpiBuffer, ulSegSize);
+		else
+		{
+			ulC = ulFlashStartAdr;
+			while( ulC<ulFlashEndAdr )
+			{
+				ulSegSize = ulFlashEndAdr - ulC;
+				if( ulSegSize>SPI_READ_PROGRESS_STEP )
+				{
+					ulSegSize = SPI_READ_PROGRESS_STEP;
+				}
+
+				iResult = Drv_SpiReadFlashContinue(ptFlashDev, pucDataAdr, ulSegSize);
+				if( iResult!=0 )
+				{
+					tResult = NETX_CONSOLEAPP_RESULT_ERROR;
+					break;
+				}
 
-		/* next segment */
-		ulFlashStartAdr += ulSegSize;
+				ulC += ulSegSize;
+				pucDataAdr += ulSegSize;
 
-		/* inc progress */
-		ulProgressCnt += ulSegSize;
-		progress_bar_set_position(ulProgressCnt);
+				/* inc progress */
+				progress_bar_set_position(ulC - ulFlashStartAdr);
+			}
+
+			iResult = Drv_SpiReadFlashStop(ptFlashDev);
+			if( iResult!=0 )
+			{
+				tResult = NETX_CONSOLEAPP_RESULT_ERROR;
+			}
+		}
 	}
 
 	progress_bar_finalize();
-	uprintf(". hash done\n");
 
-	/* read ok! */
-	return NETX_CONSOLEAPP_RESULT_OK;
+	if( tResult==NETX_CONSOLEAPP_RESULT_OK )
+	{
+		uprintf(". read ok\n");
+	}
+
+	return tResult;
+}
+
+#if CFG_INCLUDE_CHECKSUM!=0
+static int spi_checksum_segment(void *pvUser, unsigned long ulFlashAdr __attribute__((unused)), const unsigned char *pucData, size_t sizData)
+{
+	checksum_update((CHECKSUM_CONTEXT_T*)pvUser, (const void*)pucData, sizData);
+	return 0;
+}
+
+
+static NETX_CONSOLEAPP_RESULT_T spi_checksum_with_progress(const FLASHER_SPI_FLASH_T *ptFlashDev, unsigned long ulFlashStartAdr, unsigned long ulFlashEndAdr, CHECKSUM_CONTEXT_T *ptChecksumContext)
+{
+	NETX_CONSOLEAPP_RESULT_T tResult;
+
+
+	uprintf("# Calculating hash...\n");
+
+	tResult = spi_read_segments(ptFlashDev, ulFlashStartAdr, ulFlashEndAdr, spi_checksum_segment, ptChecksumContext);
+	if( tResult==NETX_CONSOLEAPP_RESULT_OK )
+	{
+		uprintf(". hash done\n");
+	}
+
+	return tResult;
 }
 #endif
 
@@ -474,7 +624,15 @@ static NETX_CONSOLEAPP_RESULT_T spi_erase_with_progress(const FLASHER_SPI_FLASH_
 		{
 			iResult = Drv_SpiEraseFlashSector(ptFlashDev, ulAddress);
 		}
-		if( iResult!=0 )
+		if( iResult==SPI_FLASH_STATUS_ERROR )
+		{
+			/* The device reported an error for this block. Continue with the
+			 * next block to get a list of all failed blocks.
+			 */
+			uprintf("! the device reported an erase error for [0x%08x, 0x%08x[\n", ulAddress, ulAddress+ulEraseChunk);
+			tResult = NETX_CONSOLEAPP_RESULT_ERROR;
+		}
+		else if( iResult!=0 )
 		{
 			uprintf("! erase failed at address 0x%08x\n", ulAddress);
 			tResult = NETX_CONSOLEAPP_RESULT_ERROR;
@@ -490,7 +648,10 @@ static NETX_CONSOLEAPP_RESULT_T spi_erase_with_progress(const FLASHER_SPI_FLASH_
 	}
 
 	progress_bar_finalize();
-	uprintf(". erase OK\n");
+	if( tResult==NETX_CONSOLEAPP_RESULT_OK )
+	{
+		uprintf(". erase OK\n");
+	}
 
 	/* Return the result. */
 	return tResult;
@@ -529,7 +690,7 @@ NETX_CONSOLEAPP_RESULT_T spi_flash(const FLASHER_SPI_FLASH_T *ptFlashDescription
 	else
 	{
 		/* verify data */
-		tResult = spi_verify_with_progress(ptFlashDescription, ulFlashStartAdr, ulDataByteSize, pucDataStartAdr);
+		tResult = spi_verify_with_progress(ptFlashDescription, ulFlashStartAdr, ulDataByteSize, pucDataStartAdr, NULL);
 	}
 
 	return tResult;
@@ -547,15 +708,18 @@ NETX_CONSOLEAPP_RESULT_T spi_flash(const FLASHER_SPI_FLASH_T *ptFlashDescription
  * @param ptFlashDescription [in]  Device information returned by spi_detect.
  * @param ulStartAdr         [in]  Start offset of the first erase block to be erased.
  * @param ulEndAdr           [in]  End offset of the last erase block to be erased (offset of the last byte + 1).
+ * @param ppvReturnMessage   [out] 1 if the device checked the erase operation with its error status bits, 0 if not.
+ *                                 In the first case the area does not have to be read back to check the result.
  *
  * @return
  * - NETX_CONSOLEAPP_RESULT_OK: success, the memory has been erased.
  * - NETX_CONSOLEAPP_RESULT_ERROR: An error has occurred.
  */
 
-NETX_CONSOLEAPP_RESULT_T spi_erase(const FLASHER_SPI_FLASH_T *ptFlashDescription, unsigned long ulStartAdr, unsigned long ulEndAdr)
+NETX_CONSOLEAPP_RESULT_T spi_erase(const FLASHER_SPI_FLASH_T *ptFlashDescription, unsigned long ulStartAdr, unsigned long ulEndAdr, void **ppvReturnMessage)
 {
 	NETX_CONSOLEAPP_RESULT_T tResult;
+	unsigned long ulTrusted;
 
 
 	/* erase the block */
@@ -565,6 +729,13 @@ NETX_CONSOLEAPP_RESULT_T spi_erase(const FLASHER_SPI_FLASH_T *ptFlashDescription
 		uprintf("! erase error\n");
 	}
 
+	ulTrusted = 0;
+	if( tResult==NETX_CONSOLEAPP_RESULT_OK && Drv_SpiHasErrorStatus(ptFlashDescription)!=0 )
+	{
+		ulTrusted = 1;
+	}
+	*ppvReturnMessage = (void*)ulTrusted;
+
 	return tResult;
 }
 
@@ -604,14 +775,14 @@ NETX_CONSOLEAPP_RESULT_T spi_read(const FLASHER_SPI_FLASH_T *ptFlashDescription,
 }
 
 
-#if CFG_INCLUDE_SHA1!=0
-NETX_CONSOLEAPP_RESULT_T spi_sha1(const FLASHER_SPI_FLASH_T *ptFlashDescription, unsigned long ulStartAdr, unsigned long ulEndAdr, SHA_CTX *ptSha1Context)
+#if CFG_INCLUDE_CHECKSUM!=0
+NETX_CONSOLEAPP_RESULT_T spi_checksum(const FLASHER_SPI_FLASH_T *ptFlashDescription, unsigned long ulStartAdr, unsigned long ulEndAdr, CHECKSUM_CONTEXT_T *ptChecksumContext)
 {
 	NETX_CONSOLEAPP_RESULT_T tResult;
 
 
 	/* read data */
-	tResult = spi_sha1_with_progress(ptFlashDescription, ulStartAdr, ulEndAdr, ptSha1Context);
+	tResult = spi_checksum_with_progress(ptFlashDescription, ulStartAdr, ulEndAdr, ptChecksumContext);
 	if( tResult!=NETX_CONSOLEAPP_RESULT_OK )
 	{
 		uprintf("! error calculating hash\n");
@@ -633,6 +804,7 @@ NETX_CONSOLEAPP_RESULT_T spi_sha1(const FLASHER_SPI_FLASH_T *ptFlashDescription,
  * @param ulFlashStartAdr     [in]  Start offset in the flash memory.
  * @param ulFlashEndAdr       [in]  End offset (offset of the last byte + 1).
  * @param pucData             [in]  Address of the data to be verified in RAM.
+ * @param ptReport            [in]  Collect all differences in this report. NULL stops at the first difference.
  * @param ppvReturnMessage    [Out] Result of the compare operation.
  *
  * @return
@@ -640,7 +812,7 @@ NETX_CONSOLEAPP_RESULT_T spi_sha1(const FLASHER_SPI_FLASH_T *ptFlashDescription,
  * - NETX_CONSOLEAPP_RESULT_ERROR, *ppvReturnMessage == NETX_CONSOLEAPP_RESULT_ERROR Verify failed, or the data was compared and is not equal.
  */
 
-NETX_CONSOLEAPP_RESULT_T spi_verify(const FLASHER_SPI_FLASH_T *ptFlashDescription, unsigned long ulFlashStartAdr, unsigned long ulFlashEndAdr, const unsigned char *pucData, void **ppvReturnMessage)
+NETX_CONSOLEAPP_RESULT_T spi_verify(const FLASHER_SPI_FLASH_T *ptFlashDescription, unsigned long ulFlashStartAdr, unsigned long ulFlashEndAdr, const unsigned char *pucData, MEM_CHECK_REPORT_T *ptReport, void **ppvReturnMessage)
 {
 	NETX_CONSOLEAPP_RESULT_T tResult;
 	unsigned long ulDataByteSize;
@@ -649,7 +821,7 @@ NETX_CONSOLEAPP_RESULT_T spi_verify(const FLASHER_SPI_FLASH_T *ptFlashDescriptio
 	ulDataByteSize  = ulFlashEndAdr - ulFlashStartAdr;
 
 	/* verify data */
-	tResult = spi_verify_with_progress(ptFlashDescription, ulFlashStartAdr, ulDataByteSize, pucData);
+	tResult = spi_verify_with_progress(ptFlashDescription, ulFlashStartAdr, ulDataByteSize, pucData, ptReport);
 	
 	*ppvReturnMessage = (void*)tResult;
 
@@ -708,6 +880,29 @@ NETX_CONSOLEAPP_RESULT_T spi_detect(FLASHER_SPI_CONFIGURATION_T *ptSpiConfigurat
 
 /*-----------------------------------*/
 
+static int spi_isErased_segment(void *pvUser, unsigned long ulFlashAdr, const unsigned char *pucData, size_t sizData)
+{
+	unsigned long *pulErased;
+	size_t sizOffset;
+	int iStop;
+
+
+	pulErased = (unsigned long*)pvUser;
+
+	iStop = 0;
+	sizOffset = mem_check_first_not_pattern(pucData, sizData, MEM_CHECK_ERASED_VALUE);
+	if( sizOffset<sizData )
+	{
+		*pulErased = pucData[sizOffset];
+		uprintf("! Memory not erased at offset 0x%08x - expected: 0x%02x found: 0x%02x\n", 
+			ulFlashAdr + sizOffset, 0xff, *pulErased);
+		iStop = 1;
+	}
+
+	return iStop;
+}
+
+
 /**
  * @brief Check if an area of the flash memory is erased. 
  *
@@ -727,90 +922,115 @@ NETX_CONSOLEAPP_RESULT_T spi_detect(FLASHER_SPI_CONFIGURATION_T *ptSpiConfigurat
 NETX_CONSOLEAPP_RESULT_T spi_isErased(const FLASHER_SPI_FLASH_T *ptFlashDescription, unsigned long ulStartAdr, unsigned long ulEndAdr, void **ppvReturnMessage)
 {
 	NETX_CONSOLEAPP_RESULT_T  tResult;
-	unsigned long ulCnt;
-	unsigned char *pucCnt;
-	unsigned char *pucEnd;
-	unsigned long ulSegSize, ulMaxSegSize;
-	unsigned long ulProgressCnt;
-	int iResult;
 	unsigned long ulErased;
 
 
-	/* expect success */
-	tResult = NETX_CONSOLEAPP_RESULT_OK;
-
 	ulErased = 0xffU;
 
 	uprintf("# Checking data...\n");
 
-	ulMaxSegSize = SPI_BUFFER_SIZE;
+	tResult = spi_read_segments(ptFlashDescription, ulStartAdr, ulEndAdr, spi_isErased_segment, &ulErased);
 
-	/* loop over all data */
-	ulCnt = ulStartAdr;
-	ulProgressCnt = 0;
-	progress_bar_init(ulEndAdr-ulStartAdr);
-
-	while( ulCnt<ulEndAdr )
+	if( tResult==NETX_CONSOLEAPP_RESULT_OK )
 	{
-		/* get the next segment, limit it to 'ulMaxSegSize' */
-		ulSegSize = ulEndAdr - ulCnt;
-		if( ulSegSize>ulMaxSegSize )
+		if( ulErased==0xff )
 		{
-			ulSegSize = ulMaxSegSize;
+			uprintf(". CLEAN! The area is erased.\n");
 		}
-
-		/* read the segment */
-		iResult = Drv_SpiReadFlash(ptFlashDescription, ulCnt, pucSpiBuffer, ulSegSize);
-		if( iResult!=0 )
+		else
 		{
-			tResult = NETX_CONSOLEAPP_RESULT_ERROR;
-			break;
+			uprintf(". DIRTY! The area is not erased.\n");
 		}
+		*ppvReturnMessage = (void*)ulErased;
+	}
+
+	return tResult;
+}
+
+
+/*-----------------------------------*/
+
+typedef struct SPI_ERASE_MAP_STATE_STRUCT
+{
+	unsigned long ulStartAdr;
+	unsigned long ulUnitSize;
+	unsigned char *pucBitmap;
+	unsigned long ulDirtyUnits;
+} SPI_ERASE_MAP_STATE_T;
+
+
+static int spi_eraseMap_segment(void *pvUser, unsigned long ulFlashAdr, const unsigned char *pucData, size_t sizData)
+{
+	SPI_ERASE_MAP_STATE_T *ptState;
+	size_t sizOffset;
+	unsigned long ulUnit;
+	unsigned char ucMask;
 
-		pucCnt = pucSpiBuffer;
-		pucEnd = pucSpiBuffer + ulSegSize;
-		while( pucCnt<pucEnd )
-		{
-			ulErased &= *pucCnt;
-			if( ulErased!=0xff )
-			{
-				uprintf("! Memory not erased at offset 0x%08x - expected: 0x%02x found: 0x%02x\n", 
-					ulCnt + (unsigned long)(pucCnt - pucSpiBuffer), 0xff, ulErased);
-				/* exit inner loop */
-				break;
-			}
-			
-			++pucCnt;
-		}
 
-		if( ulErased!=0xff )
+	ptState = (SPI_ERASE_MAP_STATE_T*)pvUser;
+
+	sizOffset = 0;
+	while( sizOffset<sizData )
+	{
+		sizOffset += mem_check_first_not_pattern(pucData + sizOffset, sizData - sizOffset, MEM_CHECK_ERASED_VALUE);
+		if( sizOffset>=sizData )
 		{
-			/* exit outer loop */
 			break;
 		}
 
-		/* next segment */
-		ulCnt += ulSegSize;
-		pucCnt += ulSegSize;
+		/* Mark the unit as dirty. */
+		ulUnit = (ulFlashAdr + sizOffset - ptState->ulStartAdr) / ptState->ulUnitSize;
+		ucMask = (unsigned char)(1U << (ulUnit & 7U));
+		if( (ptState->pucBitmap[ulUnit >> 3U] & ucMask)==0 )
+		{
+			ptState->pucBitmap[ulUnit >> 3U] |= ucMask;
+			++ptState->ulDirtyUnits;
+		}
 
-		/* increment progress */
-		ulProgressCnt += ulSegSize;
-		progress_bar_set_position(ulProgressCnt);
+		/* Continue with the next unit. */
+		sizOffset = ptState->ulStartAdr + (ulUnit + 1U) * ptState->ulUnitSize - ulFlashAdr;
 	}
 
-	progress_bar_finalize();
+	return 0;
+}
+
+
+/**
+ * @brief Find the erase units in an area which are not erased.
+ *
+ * Reads the area from ulStartAdr to ulEndAdr-1 in one pass and sets the bit
+ * for each unit of ulUnitSize bytes which contains a byte other than 0xff.
+ * The bitmap must be cleared by the caller.
+ *
+ * @param ptFlashDescription [in]  Device information returned by spi_detect.
+ * @param ulStartAdr         [in]  Start offset in the flash memory. This is the start of unit 0.
+ * @param ulEndAdr           [in]  End offset (offset of the last byte to be checked + 1).
+ * @param ulUnitSize         [in]  Size of one unit in bytes.
+ * @param pucBitmap          [out] One bit for each unit, bit n%8 of byte n/8 is unit n.
+ * @param pulDirtyUnits      [out] Number of units which are not erased.
+ *
+ * @return
+ * - NETX_CONSOLEAPP_RESULT_OK: The area has been checked.
+ * - NETX_CONSOLEAPP_RESULT_ERROR: An error has occurred.
+ */
+NETX_CONSOLEAPP_RESULT_T spi_getEraseMap(const FLASHER_SPI_FLASH_T *ptFlashDescription, unsigned long ulStartAdr, unsigned long ulEndAdr, unsigned long ulUnitSize, unsigned char *pucBitmap, unsigned long *pulDirtyUnits)
+{
+	NETX_CONSOLEAPP_RESULT_T tResult;
+	SPI_ERASE_MAP_STATE_T tState;
 
+
+	tState.ulStartAdr = ulStartAdr;
+	tState.ulUnitSize = ulUnitSize;
+	tState.pucBitmap = pucBitmap;
+	tState.ulDirtyUnits = 0;
+
+	uprintf("# Scanning the erase units...\n");
+
+	tResult = spi_read_segments(ptFlashDescription, ulStartAdr, ulEndAdr, spi_eraseMap_segment, &tState);
 	if( tResult==NETX_CONSOLEAPP_RESULT_OK )
 	{
-		if( ulErased==0xff )
-		{
-			uprintf(". CLEAN! The area is erased.\n");
-		}
-		else
-		{
-			uprintf(". DIRTY! The area is not erased.\n");
-		}
-		*ppvReturnMessage = (void*)ulErased;
+		uprintf(". %d units are not erased.\n", tState.ulDirtyUnits);
+		*pulDirtyUnits = tState.ulDirtyUnits;
 	}
 
 	return tResult;
@@ -180,8 +180,8 @@ NETX_CONSOLEAPP_RESULT_T internal_flash_read(CMD_PARAMETER_READ_T *ptParameter)
 
 
 
-#if CFG_INCLUDE_SHA1!=0
-NETX_CONSOLEAPP_RESULT_T internal_flash_sha1(CMD_PARAMETER_CHECKSUM_T *ptParameter, SHA_CTX *ptSha1Context)
+#if CFG_INCLUDE_CHECKSUM!=0
+NETX_CONSOLEAPP_RESULT_T internal_flash_checksum(CMD_PARAMETER_CHECKSUM_T *ptParameter, CHECKSUM_CONTEXT_T *ptChecksumContext)
 {
 	NETX_CONSOLEAPP_RESULT_T tResult;
 	INTERNAL_FLASH_TYPE_T tType;
@@ -203,7 +203,7 @@ NETX_CONSOLEAPP_RESULT_T internal_flash_sha1(CMD_PARAMETER_CHECKSUM_T *ptParamet
 			break;
 
 		case INTERNAL_FLASH_TYPE_MAZ_V0:
-			tResult = internal_flash_maz_v0_sha1(ptParameter, ptSha1Context);
+			tResult = internal_flash_maz_v0_checksum(ptParameter, ptChecksumContext);
 			break;
 		}
 	}
@@ -214,7 +214,7 @@ NETX_CONSOLEAPP_RESULT_T internal_flash_sha1(CMD_PARAMETER_CHECKSUM_T *ptParamet
 
 
 
-NETX_CONSOLEAPP_RESULT_T internal_flash_verify(CMD_PARAMETER_VERIFY_T *ptParameter, NETX_CONSOLEAPP_PARAMETER_T *ptConsoleParams)
+NETX_CONSOLEAPP_RESULT_T internal_flash_verify(CMD_PARAMETER_VERIFY_T *ptParameter, MEM_CHECK_REPORT_T *ptReport, NETX_CONSOLEAPP_PARAMETER_T *ptConsoleParams)
 {
 	NETX_CONSOLEAPP_RESULT_T tResult;
 	INTERNAL_FLASH_TYPE_T tType;
@@ -236,7 +236,7 @@ NETX_CONSOLEAPP_RESULT_T internal_flash_verify(CMD_PARAMETER_VERIFY_T *ptParamet
 			break;
 
 		case INTERNAL_FLASH_TYPE_MAZ_V0:
-			tResult = internal_flash_maz_v0_verify(ptParameter, ptConsoleParams);
+			tResult = internal_flash_maz_v0_verify(ptParameter, ptReport, ptConsoleParams);
 			break;
 		}
 	}
@@ -24,19 +24,17 @@
 
 #include "netx_consoleapp.h"
 #include "flasher_interface.h"
-#if CFG_INCLUDE_SHA1!=0
-#       include "sha1.h"
-#endif
+#include "checksum.h"
 
 NETX_CONSOLEAPP_RESULT_T internal_flash_detect(CMD_PARAMETER_DETECT_T *ptParameter);
 
 NETX_CONSOLEAPP_RESULT_T internal_flash_flash(CMD_PARAMETER_FLASH_T *ptParameter);
 NETX_CONSOLEAPP_RESULT_T internal_flash_erase(CMD_PARAMETER_ERASE_T *ptParameter);
 NETX_CONSOLEAPP_RESULT_T internal_flash_read(CMD_PARAMETER_READ_T *ptParameter);
-#if CFG_INCLUDE_SHA1!=0
-NETX_CONSOLEAPP_RESULT_T internal_flash_sha1(CMD_PARAMETER_CHECKSUM_T *ptParameter, SHA_CTX *ptSha1Context);
+#if CFG_INCLUDE_CHECKSUM!=0
+NETX_CONSOLEAPP_RESULT_T internal_flash_checksum(CMD_PARAMETER_CHECKSUM_T *ptParameter, CHECKSUM_CONTEXT_T *ptChecksumContext);
 #endif
-NETX_CONSOLEAPP_RESULT_T internal_flash_verify(CMD_PARAMETER_VERIFY_T *ptParameter, NETX_CONSOLEAPP_PARAMETER_T *ptConsoleParams);
+NETX_CONSOLEAPP_RESULT_T internal_flash_verify(CMD_PARAMETER_VERIFY_T *ptParameter, MEM_CHECK_REPORT_T *ptReport, NETX_CONSOLEAPP_PARAMETER_T *ptConsoleParams);
 NETX_CONSOLEAPP_RESULT_T internal_flash_isErased(CMD_PARAMETER_ISERASED_T *ptParameter, NETX_CONSOLEAPP_PARAMETER_T *ptConsoleParams);
 NETX_CONSOLEAPP_RESULT_T internal_flash_getEraseArea(CMD_PARAMETER_GETERASEAREA_T *ptParameter);
 
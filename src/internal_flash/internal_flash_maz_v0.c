@@ -22,6 +22,7 @@
 #include "internal_flash_maz_v0.h"
 
 #include "delay.h"
+#include "mem_check.h"
 #include "netx_io_areas.h"
 #include "uprintf.h"
 
@@ -1261,8 +1262,8 @@ NETX_CONSOLEAPP_RESULT_T internal_flash_maz_v0_read(CMD_PARAMETER_READ_T *ptPara
 }
 
 
-#       if CFG_INCLUDE_SHA1!=0
-NETX_CONSOLEAPP_RESULT_T internal_flash_maz_v0_sha1(CMD_PARAMETER_CHECKSUM_T *ptParameter, SHA_CTX *ptSha1Context)
+#       if CFG_INCLUDE_CHECKSUM!=0
+NETX_CONSOLEAPP_RESULT_T internal_flash_maz_v0_checksum(CMD_PARAMETER_CHECKSUM_T *ptParameter, CHECKSUM_CONTEXT_T *ptChecksumContext)
 {
 	uprintf("! not yet....\n");
 	return NETX_CONSOLEAPP_RESULT_ERROR;
@@ -1270,7 +1271,7 @@ NETX_CONSOLEAPP_RESULT_T internal_flash_maz_v0_sha1(CMD_PARAMETER_CHECKSUM_T *pt
 #       endif
 
 
-NETX_CONSOLEAPP_RESULT_T internal_flash_maz_v0_verify(CMD_PARAMETER_VERIFY_T *ptParameter, NETX_CONSOLEAPP_PARAMETER_T *ptConsoleParams)
+NETX_CONSOLEAPP_RESULT_T internal_flash_maz_v0_verify(CMD_PARAMETER_VERIFY_T *ptParameter, MEM_CHECK_REPORT_T *ptReport, NETX_CONSOLEAPP_PARAMETER_T *ptConsoleParams)
 {
 	NETX_CONSOLEAPP_RESULT_T tResult;
 	const INTERNAL_FLASH_ATTRIBUTES_MAZ_V0_T *ptAttr;
@@ -1336,21 +1337,28 @@ NETX_CONSOLEAPP_RESULT_T internal_flash_maz_v0_verify(CMD_PARAMETER_VERIFY_T *pt
 					/* Compare the data from the buffer with the flash contents. */
 					pucBufferStart = ptParameter->pucData;
 	
-					ulOffset = 0;
 					ulLength = ulOffsetEnd - ulOffsetStart;
-					do
+					if( ptReport!=NULL )
 					{
-						ucFlashData = pucFlashStart[ulOffset];
-						ucBufferData = pucBufferStart[ulOffset];
-						if( ucFlashData!=ucBufferData )
+						/* Collect all differences. */
+						if( mem_check_report_differences(ptReport, ulOffsetStart, pucFlashStart, pucBufferStart, ulLength)!=0 )
+						{
+							uprintf(". verify error, found %d different areas.\n", ptReport->sizRanges);
+							tResult = NETX_CONSOLEAPP_RESULT_ERROR;
+						}
+						mem_check_report_finalize(ptReport);
+					}
+					else
+					{
+						ulOffset = mem_check_first_difference(pucFlashStart, pucBufferStart, ulLength);
+						if( ulOffset<ulLength )
 						{
+							ucFlashData = pucFlashStart[ulOffset];
+							ucBufferData = pucBufferStart[ulOffset];
 							uprintf(". verify error at offset 0x%08x. buffer: 0x%02x, flash: 0x%02x.\n", ulOffsetStart + ulOffset, ucBufferData, ucFlashData);
 							tResult = NETX_CONSOLEAPP_RESULT_ERROR;
-							break;
 						}
-	
-						++ulOffset;
-					} while( ulOffset<ulLength );
+					}
 				}
 
 				ptConsoleParams->pvReturnMessage = (void*)tResult;
@@ -1425,19 +1433,14 @@ NETX_CONSOLEAPP_RESULT_T internal_flash_maz_v0_is_erased(CMD_PARAMETER_ISERASED_
 					/* Be optimistic... */
 					tResult = NETX_CONSOLEAPP_RESULT_OK;
 	
-					ulOffset = 0;
 					ulLength = ulOffsetEnd - ulOffsetStart;
-					do
+					ulOffset = mem_check_first_not_pattern(pucFlashStart, ulLength, MEM_CHECK_ERASED_VALUE);
+					ucFlashData = 0xffU;
+					if( ulOffset<ulLength )
 					{
 						ucFlashData = pucFlashStart[ulOffset];
-						if( ucFlashData!=0xffU )
-						{
-							uprintf("! Memory not erased at offset 0x%08x - expected: 0x%02x found: 0x%02x\n", ulOffsetStart + ulOffset, 0xff, ucFlashData);
-							break;
-						}
-	
-						++ulOffset;
-					} while( ulOffset<ulLength );
+						uprintf("! Memory not erased at offset 0x%08x - expected: 0x%02x found: 0x%02x\n", ulOffsetStart + ulOffset, 0xff, ucFlashData);
+					}
 	
 					if( ucFlashData==0xff )
 					{
@@ -1534,8 +1537,8 @@ NETX_CONSOLEAPP_RESULT_T internal_flash_maz_v0_read(CMD_PARAMETER_READ_T *ptPara
 }
 
 
-#       if CFG_INCLUDE_SHA1!=0
-NETX_CONSOLEAPP_RESULT_T internal_flash_maz_v0_sha1(CMD_PARAMETER_CHECKSUM_T *ptParameter __attribute__((unused)), SHA_CTX *ptSha1Context __attribute__((unused)))
+#       if CFG_INCLUDE_CHECKSUM!=0
+NETX_CONSOLEAPP_RESULT_T internal_flash_maz_v0_checksum(CMD_PARAMETER_CHECKSUM_T *ptParameter __attribute__((unused)), CHECKSUM_CONTEXT_T *ptChecksumContext __attribute__((unused)))
 {
 	uprintf("! Internal flash MAZ V0 is not available on this platform.\n");
 	return NETX_CONSOLEAPP_RESULT_ERROR;
@@ -1543,7 +1546,7 @@ NETX_CONSOLEAPP_RESULT_T internal_flash_maz_v0_sha1(CMD_PARAMETER_CHECKSUM_T *pt
 #       endif
 
 
-NETX_CONSOLEAPP_RESULT_T internal_flash_maz_v0_verify(CMD_PARAMETER_VERIFY_T *ptParameter __attribute__((unused)), NETX_CONSOLEAPP_PARAMETER_T *ptConsoleParams __attribute__((unused)))
+NETX_CONSOLEAPP_RESULT_T internal_flash_maz_v0_verify(CMD_PARAMETER_VERIFY_T *ptParameter __attribute__((unused)), MEM_CHECK_REPORT_T *ptReport __attribute__((unused)), NETX_CONSOLEAPP_PARAMETER_T *ptConsoleParams __attribute__((unused)))
 {
 	uprintf("! Internal flash MAZ V0 is not available on this platform.\n");
 	return NETX_CONSOLEAPP_RESULT_ERROR;
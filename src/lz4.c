@@ -0,0 +1,386 @@
+/***************************************************************************
+ *   Copyright (C) 2019 by Hilscher GmbH                                   *
+ *   cthelen@hilscher.com                                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program. If not, see                          *
+ *   <https://www.gnu.org/licenses/>.                                      *
+ ***************************************************************************/
+
+#include "lz4.h"
+
+
+/*
+ * The LZ4 block format is a list of sequences. Each sequence has:
+ *   a token: the upper 4 bits are the number of literals, the lower 4 bits
+ *            are the match length minus 4,
+ *   more literal length bytes if the count in the token is 15,
+ *   the literals,
+ *   a 16 bit little endian match offset,
+ *   more match length bytes if the count in the token is 15.
+ * The last sequence has only literals.
+ */
+
+
+#define LZ4_MIN_MATCH 4U
+#define LZ4_LENGTH_MORE 15U
+#define LZ4_MAX_OFFSET 65535U
+
+/* The last match must start 12 bytes before the end of the block and the
+ * last 5 bytes must be literals.
+ */
+#define LZ4_MATCH_START_LIMIT 12U
+#define LZ4_LAST_LITERALS 5U
+
+/* The compressor remembers the last position of each hash in this table. */
+#define LZ4_HASH_BITS 10U
+#define LZ4_HASH_ENTRIES (1U<<LZ4_HASH_BITS)
+#define LZ4_HASH_INVALID 0xffffffffU
+
+static unsigned long aulLz4HashTable[LZ4_HASH_ENTRIES];
+
+
+/*! Read an extended length.
+ *
+ * \param ppucSrc    Pointer to the read position. It is moved behind the length bytes.
+ * \param pucSrcEnd  End of the compressed data.
+ * \param psizLength The length from the token. The extension is added to it.
+ * \return 0 on success, -1 if the data ends in the length.
+ */
+static int lz4_read_length(const unsigned char **ppucSrc, const unsigned char *pucSrcEnd, size_t *psizLength)
+{
+	const unsigned char *pucSrc;
+	unsigned int uiValue;
+	size_t sizLength;
+
+
+	pucSrc = *ppucSrc;
+	sizLength = *psizLength;
+	do
+	{
+		if( pucSrc>=pucSrcEnd )
+		{
+			return -1;
+		}
+		uiValue = *(pucSrc++);
+		sizLength += uiValue;
+	} while( uiValue==0xffU );
+
+	*ppucSrc = pucSrc;
+	*psizLength = sizLength;
+
+	return 0;
+}
+
+
+
+/*! Unpack a block in the LZ4 format.
+ *
+ * The source and destination areas must not overlap.
+ *
+ * \param pucSrc      Pointer to the compressed data.
+ * \param sizSrc      Size of the compressed data in bytes.
+ * \param pucDst      Pointer to the buffer for the unpacked data.
+ * \param sizDst      Size of the buffer in bytes.
+ * \param psizResult  Returns the number of unpacked bytes.
+ * \return 0 on success, -1 if the data is invalid or does not fit into the buffer.
+ */
+int lz4_decompress(const unsigned char *pucSrc, size_t sizSrc, unsigned char *pucDst, size_t sizDst, size_t *psizResult)
+{
+	const unsigned char *pucSrcEnd;
+	unsigned char *pucDstCnt;
+	unsigned char *pucDstEnd;
+	const unsigned char *pucMatch;
+	unsigned int uiToken;
+	size_t sizLength;
+	size_t sizOffset;
+
+
+	pucSrcEnd = pucSrc + sizSrc;
+	pucDstCnt = pucDst;
+	pucDstEnd = pucDst + sizDst;
+
+	while( pucSrc<pucSrcEnd )
+	{
+		uiToken = *(pucSrc++);
+
+		/* Copy the literals. */
+		sizLength = uiToken >> 4U;
+		if( sizLength==LZ4_LENGTH_MORE && lz4_read_length(&pucSrc, pucSrcEnd, &sizLength)!=0 )
+		{
+			return -1;
+		}
+		if( sizLength>(size_t)(pucSrcEnd-pucSrc) || sizLength>(size_t)(pucDstEnd-pucDstCnt) )
+		{
+			return -1;
+		}
+		while( sizLength!=0 )
+		{
+			*(pucDstCnt++) = *(pucSrc++);
+			--sizLength;
+		}
+
+		/* The last sequence ends after the literals. */
+		if( pucSrc==pucSrcEnd )
+		{
+			break;
+		}
+
+		/* Get the match offset. */
+		if( (size_t)(pucSrcEnd-pucSrc)<2U )
+		{
+			return -1;
+		}
+		sizOffset = (size_t)(pucSrc[0] | (pucSrc[1]<<8U));
+		pucSrc += 2;
+		if( sizOffset==0 || sizOffset>(size_t)(pucDstCnt-pucDst) )
+		{
+			return -1;
+		}
+
+		/* Copy the match. It may overlap with the output. */
+		sizLength = uiToken & 0x0fU;
+		if( sizLength==LZ4_LENGTH_MORE && lz4_read_length(&pucSrc, pucSrcEnd, &sizLength)!=0 )
+		{
+			return -1;
+		}
+		sizLength += LZ4_MIN_MATCH;
+		if( sizLength>(size_t)(pucDstEnd-pucDstCnt) )
+		{
+			return -1;
+		}
+		pucMatch = pucDstCnt - sizOffset;
+		while( sizLength!=0 )
+		{
+			*(pucDstCnt++) = *(pucMatch++);
+			--sizLength;
+		}
+	}
+
+	*psizResult = (size_t)(pucDstCnt - pucDst);
+
+	return 0;
+}
+
+
+
+/*! Write an extended length.
+ *
+ * \param ppucDst    Pointer to the write position. It is moved behind the length bytes.
+ * \param pucDstEnd  End of the buffer.
+ * \param sizLength  The length minus the part in the token.
+ * \return 0 on success, -1 if the buffer is too small.
+ */
+static int lz4_write_length(unsigned char **ppucDst, unsigned char *pucDstEnd, size_t sizLength)
+{
+	unsigned char *pucDst;
+
+
+	pucDst = *ppucDst;
+	do
+	{
+		if( pucDst>=pucDstEnd )
+		{
+			return -1;
+		}
+		if( sizLength>=0xffU )
+		{
+			*(pucDst++) = 0xffU;
+			sizLength -= 0xffU;
+		}
+		else
+		{
+			*(pucDst++) = (unsigned char)sizLength;
+			break;
+		}
+	} while( 1 );
+
+	*ppucDst = pucDst;
+
+	return 0;
+}
+
+
+
+/*! Write one sequence.
+ *
+ * \param ppucDst      Pointer to the write position. It is moved behind the sequence.
+ * \param pucDstEnd    End of the buffer.
+ * \param pucLiterals  Pointer to the literals.
+ * \param sizLiterals  Number of literals.
+ * \param sizOffset    Offset of the match.
+ * \param sizMatch     Length of the match or 0 for the last sequence.
+ * \return 0 on success, -1 if the buffer is too small.
+ */
+static int lz4_write_sequence(unsigned char **ppucDst, unsigned char *pucDstEnd, const unsigned char *pucLiterals, size_t sizLiterals, size_t sizOffset, size_t sizMatch)
+{
+	unsigned char *pucDst;
+	unsigned char *pucToken;
+	unsigned int uiToken;
+
+
+	pucDst = *ppucDst;
+	if( pucDst>=pucDstEnd )
+	{
+		return -1;
+	}
+	pucToken = pucDst++;
+
+	if( sizLiterals>=LZ4_LENGTH_MORE )
+	{
+		uiToken = LZ4_LENGTH_MORE << 4U;
+		if( lz4_write_length(&pucDst, pucDstEnd, sizLiterals - LZ4_LENGTH_MORE)!=0 )
+		{
+			return -1;
+		}
+	}
+	else
+	{
+		uiToken = (unsigned int)(sizLiterals << 4U);
+	}
+
+	if( sizLiterals>(size_t)(pucDstEnd-pucDst) )
+	{
+		return -1;
+	}
+	while( sizLiterals!=0 )
+	{
+		*(pucDst++) = *(pucLiterals++);
+		--sizLiterals;
+	}
+
+	if( sizMatch!=0 )
+	{
+		if( (size_t)(pucDstEnd-pucDst)<2U )
+		{
+			return -1;
+		}
+		*(pucDst++) = (unsigned char)(sizOffset & 0xffU);
+		*(pucDst++) = (unsigned char)(sizOffset >> 8U);
+
+		sizMatch -= LZ4_MIN_MATCH;
+		if( sizMatch>=LZ4_LENGTH_MORE )
+		{
+			uiToken |= LZ4_LENGTH_MORE;
+			if( lz4_write_length(&pucDst, pucDstEnd, sizMatch - LZ4_LENGTH_MORE)!=0 )
+			{
+				return -1;
+			}
+		}
+		else
+		{
+			uiToken |= (unsigned int)sizMatch;
+		}
+	}
+
+	*pucToken = (unsigned char)uiToken;
+	*ppucDst = pucDst;
+
+	return 0;
+}
+
+
+
+static unsigned int lz4_hash(const unsigned char *pucData)
+{
+	unsigned long ulValue;
+
+
+	ulValue  = (unsigned long)pucData[0];
+	ulValue |= ((unsigned long)pucData[1]) << 8U;
+	ulValue |= ((unsigned long)pucData[2]) << 16U;
+	ulValue |= ((unsigned long)pucData[3]) << 24U;
+
+	return (unsigned int)(((ulValue * 2654435761UL) & 0xffffffffUL) >> (32U - LZ4_HASH_BITS));
+}
+
+
+
+/*! Pack a block in the LZ4 format.
+ *
+ * This is a simple greedy compressor. It is fast and packs runs of the
+ * same value very well, e.g. erased areas of a flash.
+ *
+ * \param pucSrc  Pointer to the data.
+ * \param sizSrc  Size of the data in bytes.
+ * \param pucDst  Pointer to the buffer for the compressed data.
+ * \param sizDst  Size of the buffer in bytes.
+ * \return The size of the compressed data or 0 if it does not fit into the buffer.
+ */
+size_t lz4_compress(const unsigned char *pucSrc, size_t sizSrc, unsigned char *pucDst, size_t sizDst)
+{
+	unsigned char *pucDstCnt;
+	unsigned char *pucDstEnd;
+	size_t sizPos;
+	size_t sizAnchor;
+	size_t sizRef;
+	size_t sizMatch;
+	size_t sizMatchMax;
+	size_t sizMisses;
+	unsigned int uiHash;
+	unsigned int uiCnt;
+
+
+	pucDstCnt = pucDst;
+	pucDstEnd = pucDst + sizDst;
+
+	for(uiCnt=0; uiCnt<LZ4_HASH_ENTRIES; ++uiCnt)
+	{
+		aulLz4HashTable[uiCnt] = LZ4_HASH_INVALID;
+	}
+
+	sizAnchor = 0;
+	sizPos = 0;
+	sizMisses = 0;
+	while( sizSrc>LZ4_MATCH_START_LIMIT && sizPos<sizSrc-LZ4_MATCH_START_LIMIT )
+	{
+		uiHash = lz4_hash(pucSrc + sizPos);
+		sizRef = (size_t)aulLz4HashTable[uiHash];
+		aulLz4HashTable[uiHash] = (unsigned long)sizPos;
+
+		if( sizRef!=LZ4_HASH_INVALID && (sizPos-sizRef)<=LZ4_MAX_OFFSET &&
+		    pucSrc[sizRef]==pucSrc[sizPos] && pucSrc[sizRef+1U]==pucSrc[sizPos+1U] &&
+		    pucSrc[sizRef+2U]==pucSrc[sizPos+2U] && pucSrc[sizRef+3U]==pucSrc[sizPos+3U] )
+		{
+			/* Extend the match. */
+			sizMatchMax = sizSrc - LZ4_LAST_LITERALS - sizPos;
+			sizMatch = LZ4_MIN_MATCH;
+			while( sizMatch<sizMatchMax && pucSrc[sizRef+sizMatch]==pucSrc[sizPos+sizMatch] )
+			{
+				++sizMatch;
+			}
+
+			if( lz4_write_sequence(&pucDstCnt, pucDstEnd, pucSrc + sizAnchor, sizPos - sizAnchor, sizPos - sizRef, sizMatch)!=0 )
+			{
+				return 0;
+			}
+			sizPos += sizMatch;
+			sizAnchor = sizPos;
+			sizMisses = 0;
+		}
+		else
+		{
+			/* Skip faster over data which does not compress. */
+			++sizMisses;
+			sizPos += 1U + (sizMisses >> 6U);
+		}
+	}
+
+	/* The rest are literals. */
+	if( lz4_write_sequence(&pucDstCnt, pucDstEnd, pucSrc + sizAnchor, sizSrc - sizAnchor, 0, 0)!=0 )
+	{
+		return 0;
+	}
+
+	return (size_t)(pucDstCnt - pucDst);
+}
@@ -0,0 +1,34 @@
+/***************************************************************************
+ *   Copyright (C) 2019 by Hilscher GmbH                                   *
+ *   cthelen@hilscher.com                                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program. If not, see                          *
+ *   <https://www.gnu.org/licenses/>.                                      *
+ ***************************************************************************/
+
+#ifndef __LZ4_H__
+#define __LZ4_H__
+
+#include <stddef.h>
+
+
+/* This is a decoder and a simple encoder for the LZ4 block format. It is
+ * used to unpack compressed image data and to pack read data on the target.
+ */
+
+size_t lz4_compress(const unsigned char *pucSrc, size_t sizSrc, unsigned char *pucDst, size_t sizDst);
+int lz4_decompress(const unsigned char *pucSrc, size_t sizSrc, unsigned char *pucDst, size_t sizDst, size_t *psizResult);
+
+
+#endif  /* __LZ4_H__ */
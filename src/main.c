@@ -31,13 +31,15 @@
 /* Serial flash on SPI. */
 #include "flasher_spi.h"
 #include "spi_macro_player.h"
-#include "sha1.h"
+#include "checksum.h"
 
 #include "flasher_interface.h"
 #include "flasher_header.h"
 #include "units.h"
 #include "uprintf.h"
 #include "systime.h"
+#include "lz4.h"
+#include "mem_check.h"
 
 #include "main.h"
 
@@ -209,6 +211,30 @@ static NETX_CONSOLEAPP_RESULT_T check_device_description(const DEVICE_DESCRIPTIO
 /* ------------------------------------- */
 
 
+/* Unpack the data for a flash operation if it was sent compressed. */
+static NETX_CONSOLEAPP_RESULT_T decompress_data(unsigned char *pucData, unsigned long ulDataByteSize, const unsigned char *pucCompressed, unsigned long ulCompressedSize)
+{
+	NETX_CONSOLEAPP_RESULT_T tResult;
+	int iResult;
+	size_t sizResult;
+
+
+	tResult = NETX_CONSOLEAPP_RESULT_OK;
+	if( ulCompressedSize!=0 )
+	{
+		uprintf("# Unpacking 0x%08x bytes to 0x%08x bytes...\n", ulCompressedSize, ulDataByteSize);
+		iResult = lz4_decompress(pucCompressed, ulCompressedSize, pucData, ulDataByteSize, &sizResult);
+		if( iResult!=0 || sizResult!=ulDataByteSize )
+		{
+			uprintf("! The compressed data is invalid.\n");
+			tResult = NETX_CONSOLEAPP_RESULT_ERROR;
+		}
+	}
+
+	return tResult;
+}
+
+
 static NETX_CONSOLEAPP_RESULT_T opMode_flash(tFlasherInputParameter *ptAppParams)
 {
 	NETX_CONSOLEAPP_RESULT_T tResult;
@@ -222,6 +248,11 @@ static NETX_CONSOLEAPP_RESULT_T opMode_flash(tFlasherInputParameter *ptAppParams
 	/* Get a shortcut to the parameters. */
 	ptParameter = &(ptAppParams->uParameter.tFlash);
 
+	if( decompress_data(ptParameter->pucData, ptParameter->ulDataByteSize, ptParameter->pucCompressed, ptParameter->ulCompressedSize)!=NETX_CONSOLEAPP_RESULT_OK )
+	{
+		return NETX_CONSOLEAPP_RESULT_ERROR;
+	}
+
 	/* Get the source type. */
 	tSourceTyp = ptParameter->ptDeviceDescription->tSourceTyp;
 	switch(tSourceTyp)
@@ -264,7 +295,7 @@ static NETX_CONSOLEAPP_RESULT_T opMode_flash(tFlasherInputParameter *ptAppParams
 /* ------------------------------------- */
 
 
-static NETX_CONSOLEAPP_RESULT_T opMode_erase(tFlasherInputParameter *ptAppParams)
+static NETX_CONSOLEAPP_RESULT_T opMode_erase(tFlasherInputParameter *ptAppParams, NETX_CONSOLEAPP_PARAMETER_T *ptConsoleParams)
 {
 	NETX_CONSOLEAPP_RESULT_T tResult;
 	BUS_T tSourceTyp;
@@ -277,6 +308,9 @@ static NETX_CONSOLEAPP_RESULT_T opMode_erase(tFlasherInputParameter *ptAppParams
 	/* Get a shortcut to the parameters. */
 	ptParameter = &(ptAppParams->uParameter.tErase);
 
+	/* The result of the erase operation must be checked by the caller. */
+	ptConsoleParams->pvReturnMessage = (void*)0;
+
 	/* Get the source type. */
 	tSourceTyp = ptParameter->ptDeviceDescription->tSourceTyp;
 	switch(tSourceTyp)
@@ -290,7 +324,7 @@ static NETX_CONSOLEAPP_RESULT_T opMode_erase(tFlasherInputParameter *ptAppParams
 
 	case BUS_SPI:
 		/* Use SPI flash. */
-		tResult = spi_erase(&(ptParameter->ptDeviceDescription->uInfo.tSpiInfo), ptParameter->ulStartAdr, ptParameter->ulEndAdr);
+		tResult = spi_erase(&(ptParameter->ptDeviceDescription->uInfo.tSpiInfo), ptParameter->ulStartAdr, ptParameter->ulEndAdr, &(ptConsoleParams->pvReturnMessage));
 		break;
 
 #ifdef CFG_INCLUDE_INTFLASH
@@ -367,6 +401,15 @@ static NETX_CONSOLEAPP_RESULT_T opMode_read(tFlasherInputParameter *ptAppParams)
 		uprintf("! Unknown device type: 0x%08x\n", tSourceTyp);
 		break;
 	}
+
+	/* Pack the data for the host. */
+	ptParameter->ulCompressedSize = 0;
+	if( tResult==NETX_CONSOLEAPP_RESULT_OK && ptParameter->ulCompressedMax!=0 )
+	{
+		ptParameter->ulCompressedSize = lz4_compress(ptParameter->pucData, ptParameter->ulEndAdr - ptParameter->ulStartAdr, ptParameter->pucCompressed, ptParameter->ulCompressedMax);
+		uprintf(". Packed 0x%08x bytes to 0x%08x bytes.\n", ptParameter->ulEndAdr - ptParameter->ulStartAdr, ptParameter->ulCompressedSize);
+	}
+
 	return tResult;
 }
 
@@ -379,6 +422,8 @@ static NETX_CONSOLEAPP_RESULT_T opMode_verify(tFlasherInputParameter *ptAppParam
 	NETX_CONSOLEAPP_RESULT_T tResult;
 	BUS_T tSourceTyp;
 	CMD_PARAMETER_VERIFY_T *ptParameter;
+	MEM_CHECK_REPORT_T tReport;
+	MEM_CHECK_REPORT_T *ptReport;
 
 
 	/* Be pessimistic. */
@@ -387,6 +432,18 @@ static NETX_CONSOLEAPP_RESULT_T opMode_verify(tFlasherInputParameter *ptAppParam
 	/* Get a shortcut to the parameters. */
 	ptParameter = &(ptAppParams->uParameter.tVerify);
 
+	/* Collect all differences if a report buffer is set. */
+	ptReport = NULL;
+	if( ptParameter->pucReport!=NULL )
+	{
+		if( mem_check_report_init(&tReport, ptParameter->pucReport, ptParameter->sizReport)!=0 )
+		{
+			uprintf("! The report buffer at 0x%08x with 0x%08x bytes is not aligned or too small.\n", (unsigned long)ptParameter->pucReport, ptParameter->sizReport);
+			return NETX_CONSOLEAPP_RESULT_ERROR;
+		}
+		ptReport = &tReport;
+	}
+
 	/* Get the source type. */
 	tSourceTyp = ptParameter->ptDeviceDescription->tSourceTyp;
 
@@ -395,26 +452,26 @@ static NETX_CONSOLEAPP_RESULT_T opMode_verify(tFlasherInputParameter *ptAppParam
 #ifdef CFG_INCLUDE_PARFLASH
 	case BUS_ParFlash:
 		/* Use parallel flash. */
-		tResult = parflash_verify(ptParameter, ptConsoleParams);
+		tResult = parflash_verify(ptParameter, ptReport, ptConsoleParams);
 		break;
 #endif
 		
 	case BUS_SPI:
 		/* Use SPI flash. */
-		tResult = spi_verify(&(ptParameter->ptDeviceDescription->uInfo.tSpiInfo), ptParameter->ulStartAdr, ptParameter->ulEndAdr, ptParameter->pucData, &(ptConsoleParams->pvReturnMessage));
+		tResult = spi_verify(&(ptParameter->ptDeviceDescription->uInfo.tSpiInfo), ptParameter->ulStartAdr, ptParameter->ulEndAdr, ptParameter->pucData, ptReport, &(ptConsoleParams->pvReturnMessage));
 		break;
 
 #ifdef CFG_INCLUDE_INTFLASH
 	case BUS_IFlash:
 		/* Use internal flash. */
-		tResult = internal_flash_verify(ptParameter, ptConsoleParams);
+		tResult = internal_flash_verify(ptParameter, ptReport, ptConsoleParams);
 		break;
 #endif
 
 #ifdef CFG_INCLUDE_SDIO
 	case BUS_SDIO:
 		/* Use SDIO */
-		tResult = sdio_verify(ptParameter, (unsigned long*) &(ptConsoleParams->pvReturnMessage));
+		tResult = sdio_verify(ptParameter, ptReport, (unsigned long*) &(ptConsoleParams->pvReturnMessage));
 		break;
 #endif
 
@@ -427,13 +484,14 @@ static NETX_CONSOLEAPP_RESULT_T opMode_verify(tFlasherInputParameter *ptAppParam
 	return tResult;
 }
 
-#if CFG_INCLUDE_SHA1!=0
+#if CFG_INCLUDE_CHECKSUM!=0
 static NETX_CONSOLEAPP_RESULT_T opMode_checksum(tFlasherInputParameter *ptAppParams)
 {
 	NETX_CONSOLEAPP_RESULT_T tResult;
 	BUS_T tSourceTyp;
 	CMD_PARAMETER_CHECKSUM_T *ptParameter;
-	SHA_CTX tShaContext;
+	CHECKSUM_CONTEXT_T tChecksumContext;
+	int iResult;
 	
 
 	/* Be pessimistic. */
@@ -442,7 +500,20 @@ static NETX_CONSOLEAPP_RESULT_T opMode_checksum(tFlasherInputParameter *ptAppPar
 	/* Get a shortcut to the parameters. */
 	ptParameter = &(ptAppParams->uParameter.tChecksum);
 
-	SHA1_Init(&tShaContext);
+	if( ptParameter->ulBlockSize==0 )
+	{
+		iResult = checksum_init(&tChecksumContext, ptParameter->tAlgorithm);
+	}
+	else
+	{
+		/* Build one checksum for each block. */
+		iResult = checksum_blocks_init(&tChecksumContext, ptParameter->tAlgorithm, ptParameter->ulBlockSize, ptParameter->pucBlockChecksums);
+	}
+	if( iResult!=0 )
+	{
+		uprintf("! Invalid checksum parameters. The algorithm %d may not be supported by this build.\n", ptParameter->tAlgorithm);
+		return NETX_CONSOLEAPP_RESULT_ERROR;
+	}
 	
 	/* Get the source type. */
 	tSourceTyp = ptParameter->ptDeviceDescription->tSourceTyp;
@@ -451,26 +522,26 @@ static NETX_CONSOLEAPP_RESULT_T opMode_checksum(tFlasherInputParameter *ptAppPar
 #ifdef CFG_INCLUDE_PARFLASH
 	case BUS_ParFlash:
 		/* Use parallel flash. */
-		tResult = parflash_sha1(ptParameter, &tShaContext);
+		tResult = parflash_checksum(ptParameter, &tChecksumContext);
 		break;
 #endif
 		
 	case BUS_SPI:
 		/* Use SPI flash. */
-		tResult = spi_sha1(&(ptParameter->ptDeviceDescription->uInfo.tSpiInfo), ptParameter->ulStartAdr, ptParameter->ulEndAdr, &tShaContext);
+		tResult = spi_checksum(&(ptParameter->ptDeviceDescription->uInfo.tSpiInfo), ptParameter->ulStartAdr, ptParameter->ulEndAdr, &tChecksumContext);
 		break;
 
 #ifdef CFG_INCLUDE_INTFLASH
 	case BUS_IFlash:
 		/* Use the internal flash. */
-		tResult = internal_flash_sha1(ptParameter, &tShaContext);
+		tResult = internal_flash_checksum(ptParameter, &tChecksumContext);
 		break;
 #endif
 
 #ifdef CFG_INCLUDE_SDIO
 	case BUS_SDIO:
 		/* Use SDIO */
-		tResult = sdio_sha1(ptParameter, &tShaContext);
+		tResult = sdio_checksum(ptParameter, &tChecksumContext);
 		break;
 #endif
 	default:
@@ -482,7 +553,18 @@ static NETX_CONSOLEAPP_RESULT_T opMode_checksum(tFlasherInputParameter *ptAppPar
 	/* store hash value in parameter */
 	if (tResult == NETX_CONSOLEAPP_RESULT_OK)
 	{
-		SHA1_Final(&ptParameter->aucSha1[0], &tShaContext);
+		if( ptParameter->ulBlockSize==0 )
+		{
+			checksum_final(&tChecksumContext, ptParameter->aucChecksum);
+		}
+		else if( (ptParameter->ulFlags&CHECKSUM_FLAG_Tree)!=0 )
+		{
+			checksum_tree_final(&tChecksumContext, ptParameter->aucChecksum);
+		}
+		else
+		{
+			checksum_blocks_final(&tChecksumContext);
+		}
 	}
 	
 	return tResult;
@@ -723,24 +805,26 @@ static NETX_CONSOLEAPP_RESULT_T opMode_getBoardInfo(tFlasherInputParameter *ptAp
 /* ------------------------------------- */
 
 
-static NETX_CONSOLEAPP_RESULT_T opMode_easyErase(tFlasherInputParameter *ptAppParams, NETX_CONSOLEAPP_PARAMETER_T *ptConsoleParams)
+/* Get the size of the erase block at an offset. */
+static NETX_CONSOLEAPP_RESULT_T get_erase_unit(const DEVICE_DESCRIPTION_T *ptDeviceDescription, unsigned long ulAdr, unsigned long *pulUnitStart, unsigned long *pulUnitEnd)
 {
 	NETX_CONSOLEAPP_RESULT_T tResult;
+	tFlasherInputParameter tStep;
 
 
-	/* Adapt the erase area to the sector boundaries. */
-	tResult = opMode_getEraseArea(ptAppParams);
+	tStep.tOperationMode = OPERATION_MODE_GetEraseArea;
+	tStep.uParameter.tGetEraseArea.ptDeviceDescription = ptDeviceDescription;
+	tStep.uParameter.tGetEraseArea.ulStartAdr = ulAdr;
+	tStep.uParameter.tGetEraseArea.ulEndAdr = ulAdr + 1U;
+	tResult = opMode_getEraseArea(&tStep);
 	if( tResult==NETX_CONSOLEAPP_RESULT_OK )
 	{
-		/* Is the erase area already clean? */
-		tResult = opMode_isErased(ptAppParams, ptConsoleParams);
-		if( tResult==NETX_CONSOLEAPP_RESULT_OK )
+		*pulUnitStart = tStep.uParameter.tGetEraseArea.ulStartAdr;
+		*pulUnitEnd = tStep.uParameter.tGetEraseArea.ulEndAdr;
+		if( *pulUnitEnd<=*pulUnitStart )
 		{
-			/* The erase area is not clean. Erase it now. */
-			if( ptConsoleParams->pvReturnMessage!=((void*)0xff) )
-			{
-				tResult = opMode_erase(ptAppParams);
-			}
+			uprintf("! Invalid erase block at offset 0x%08x.\n", ulAdr);
+			tResult = NETX_CONSOLEAPP_RESULT_ERROR;
 		}
 	}
 
@@ -748,193 +832,1731 @@ static NETX_CONSOLEAPP_RESULT_T opMode_easyErase(tFlasherInputParameter *ptAppPa
 }
 
 
-/* ------------------------------------- */
-
-
-static NETX_CONSOLEAPP_RESULT_T opMode_spiMacroPlayer(tFlasherInputParameter *ptAppParams, NETX_CONSOLEAPP_PARAMETER_T *ptConsoleParams)
+/* Mark all units of ulUnitSize bytes in the bitmap which are not erased.
+ * ulStartAdr must be at an erase block border. The bitmap must be clear.
+ * SPI flashes are read in one pass. All other devices are checked with one
+ * IsErased for each erase block.
+ */
+static NETX_CONSOLEAPP_RESULT_T scan_erase_map(const DEVICE_DESCRIPTION_T *ptDeviceDescription, unsigned long ulStartAdr, unsigned long ulEndAdr, unsigned long ulUnitSize, unsigned char *pucBitmap, unsigned long *pulDirtyUnits)
 {
 	NETX_CONSOLEAPP_RESULT_T tResult;
-	(void) ptConsoleParams; /* unused */
+	tFlasherInputParameter tStep;
+	NETX_CONSOLEAPP_PARAMETER_T tStepConsoleParams;
+	unsigned long ulAdr;
+	unsigned long ulUnitStart;
+	unsigned long ulUnitEnd;
+	unsigned long ulUnit;
+	unsigned long ulLastUnit;
+	unsigned long ulDirtyUnits;
+	unsigned char ucMask;
+
+
+	if( ptDeviceDescription->tSourceTyp==BUS_SPI )
+	{
+		tResult = spi_getEraseMap(&(ptDeviceDescription->uInfo.tSpiInfo), ulStartAdr, ulEndAdr, ulUnitSize, pucBitmap, pulDirtyUnits);
+	}
+	else
+	{
+		tResult = NETX_CONSOLEAPP_RESULT_OK;
+		ulDirtyUnits = 0;
+		ulAdr = ulStartAdr;
+		while( ulAdr<ulEndAdr )
+		{
+			tResult = get_erase_unit(ptDeviceDescription, ulAdr, &ulUnitStart, &ulUnitEnd);
+			if( tResult!=NETX_CONSOLEAPP_RESULT_OK )
+			{
+				break;
+			}
+			if( ulUnitEnd>ulEndAdr )
+			{
+				ulUnitEnd = ulEndAdr;
+			}
 
-	tResult = spi_macro_player(&(ptAppParams->uParameter.tSpiMacroPlayer));
-	return tResult;
-}
+			tStep.tOperationMode = OPERATION_MODE_IsErased;
+			tStep.uParameter.tIsErased.ptDeviceDescription = ptDeviceDescription;
+			tStep.uParameter.tIsErased.ulStartAdr = ulAdr;
+			tStep.uParameter.tIsErased.ulEndAdr = ulUnitEnd;
+			tStepConsoleParams.pvInitParams = &tStep;
+			tStepConsoleParams.pvReturnMessage = NULL;
+			tResult = opMode_isErased(&tStep, &tStepConsoleParams);
+			if( tResult!=NETX_CONSOLEAPP_RESULT_OK )
+			{
+				break;
+			}
 
+			if( tStepConsoleParams.pvReturnMessage!=((void*)0xff) )
+			{
+				/* Mark all units which overlap the erase block. */
+				ulUnit = (ulAdr - ulStartAdr) / ulUnitSize;
+				ulLastUnit = (ulUnitEnd - 1U - ulStartAdr) / ulUnitSize;
+				while( ulUnit<=ulLastUnit )
+				{
+					ucMask = (unsigned char)(1U << (ulUnit & 7U));
+					if( (pucBitmap[ulUnit >> 3U] & ucMask)==0 )
+					{
+						pucBitmap[ulUnit >> 3U] |= ucMask;
+						++ulDirtyUnits;
+					}
+					++ulUnit;
+				}
+			}
 
-/* ------------------------------------- */
+			ulAdr = ulUnitEnd;
+		}
+		*pulDirtyUnits = ulDirtyUnits;
+	}
 
-#define FLAG_STARTADR 1
-#define FLAG_ENDADR 2
-#define FLAG_SIZE 4
-#define FLAG_BUFFERADR 8
-#define FLAG_DEVICE 16
+	return tResult;
+}
 
-#if 1
-static NETX_CONSOLEAPP_RESULT_T check_params(NETX_CONSOLEAPP_PARAMETER_T *ptConsoleParams)
+
+static NETX_CONSOLEAPP_RESULT_T opMode_getEraseMap(tFlasherInputParameter *ptAppParams, NETX_CONSOLEAPP_PARAMETER_T *ptConsoleParams)
 {
 	NETX_CONSOLEAPP_RESULT_T tResult;
-	tFlasherInputParameter *ptAppParams;
-	unsigned long ulParamVersion;
-	OPERATION_MODE_T tOpMode;
-	const DEVICE_DESCRIPTION_T *ptDeviceDescription;
-	unsigned long ulStartAdr;
-	unsigned long ulEndAdr       = 0; /* avoid 'uninitialized' warning */
-	unsigned long ulDataByteSize = 0; /* dito */
-	unsigned char *pucData;
-	unsigned long ulFlashSize;
-	unsigned long ulPars;
-	
-	/*  get application parameters */
-	ptAppParams = (tFlasherInputParameter*)ptConsoleParams->pvInitParams;
+	CMD_PARAMETER_GETERASEMAP_T *ptParameter;
+	tFlasherInputParameter tStep;
+	unsigned long ulUnitStart;
+	unsigned long ulUnitEnd;
+	unsigned long ulUnits;
+	unsigned long ulCnt;
 
-	/*  check parameter version */
-	ulParamVersion = ptAppParams->ulParamVersion;
-	if( ulParamVersion!=FLASHER_INTERFACE_VERSION )
+
+	/* Get a shortcut to the parameters. */
+	ptParameter = &(ptAppParams->uParameter.tGetEraseMap);
+	ptParameter->ulUnitSize = 0;
+	ptParameter->ulUnits = 0;
+	ptParameter->ulDirtyUnits = 0;
+
+	/* Expand the area to the erase block borders. */
+	tStep.tOperationMode = OPERATION_MODE_GetEraseArea;
+	tStep.uParameter.tGetEraseArea.ptDeviceDescription = ptParameter->ptDeviceDescription;
+	tStep.uParameter.tGetEraseArea.ulStartAdr = ptParameter->ulStartAdr;
+	tStep.uParameter.tGetEraseArea.ulEndAdr = ptParameter->ulEndAdr;
+	tResult = opMode_getEraseArea(&tStep);
+	if( tResult==NETX_CONSOLEAPP_RESULT_OK )
 	{
-		uprintf("! unknown parameter version: %04x.%04x. Expected %04x.%04x!\n", 
-			ulParamVersion>>16, ulParamVersion&0xffff, 
-			FLASHER_INTERFACE_VERSION>>16, FLASHER_INTERFACE_VERSION&0xffff);
-		return NETX_CONSOLEAPP_RESULT_ERROR;
+		ptParameter->ulStartAdr = tStep.uParameter.tGetEraseArea.ulStartAdr;
+		ptParameter->ulEndAdr = tStep.uParameter.tGetEraseArea.ulEndAdr;
+
+		/* The unit is the erase block at the start of the area. */
+		tResult = get_erase_unit(ptParameter->ptDeviceDescription, ptParameter->ulStartAdr, &ulUnitStart, &ulUnitEnd);
 	}
-	
-	/* Extract and print the parameters for each mode */
-	tOpMode = ptAppParams->tOperationMode;
-	switch( tOpMode )
+	if( tResult==NETX_CONSOLEAPP_RESULT_OK )
 	{
-	case OPERATION_MODE_Detect:
-		ulPars = 0;
-		uprintf(". Mode: Detect\n");
-		break;
+		ptParameter->ulUnitSize = ulUnitEnd - ulUnitStart;
+		ulUnits = (ptParameter->ulEndAdr - ptParameter->ulStartAdr + ptParameter->ulUnitSize - 1U) / ptParameter->ulUnitSize;
+		if( ((ulUnits + 7U) / 8U)>ptParameter->ulBitmapSize )
+		{
+			uprintf("! The bitmap needs 0x%08x bytes, but only 0x%08x bytes are available.\n", (ulUnits + 7U) / 8U, ptParameter->ulBitmapSize);
+			tResult = NETX_CONSOLEAPP_RESULT_ERROR;
+		}
+		else
+		{
+			ptParameter->ulUnits = ulUnits;
+			for(ulCnt=0; ulCnt<(ulUnits + 7U) / 8U; ++ulCnt)
+			{
+				ptParameter->pucBitmap[ulCnt] = 0;
+			}
+			tResult = scan_erase_map(ptParameter->ptDeviceDescription, ptParameter->ulStartAdr, ptParameter->ulEndAdr, ptParameter->ulUnitSize, ptParameter->pucBitmap, &(ptParameter->ulDirtyUnits));
+		}
+	}
 
-	case OPERATION_MODE_Flash:
-		ulPars = FLAG_STARTADR + FLAG_SIZE + FLAG_BUFFERADR + FLAG_DEVICE;
-		ulStartAdr          = ptAppParams->uParameter.tFlash.ulStartAdr;
-		ulDataByteSize      = ptAppParams->uParameter.tFlash.ulDataByteSize;
-		pucData             = ptAppParams->uParameter.tFlash.pucData;
-		ptDeviceDescription = ptAppParams->uParameter.tFlash.ptDeviceDescription;
-		uprintf(". Mode: Write to flash\n");
-		uprintf(". Start offset in flash: 0x%08x\n", ulStartAdr);
-		uprintf(". Data size:             0x%08x\n", ulDataByteSize);
-		uprintf(". Buffer address:        0x%08x\n", pucData);
-		break;
+	/* Return the number of units which are not erased. */
+	ptConsoleParams->pvReturnMessage = (void*)ptParameter->ulDirtyUnits;
 
-	case OPERATION_MODE_Erase:
-		ulPars = FLAG_STARTADR + FLAG_ENDADR + FLAG_DEVICE;
-		ulStartAdr          = ptAppParams->uParameter.tErase.ulStartAdr;
-		ulEndAdr            = ptAppParams->uParameter.tErase.ulEndAdr;
-		ptDeviceDescription = ptAppParams->uParameter.tErase.ptDeviceDescription;
-		uprintf(". Mode: Erase\n");
-		uprintf(". Flash offset [0x%08x, 0x%08x[\n", ulStartAdr, ulEndAdr);
-		break;
+	return tResult;
+}
 
-	case OPERATION_MODE_Read:
-		ulPars = FLAG_STARTADR + FLAG_ENDADR + FLAG_BUFFERADR + FLAG_DEVICE;
-		ulStartAdr          = ptAppParams->uParameter.tRead.ulStartAdr;
-		ulEndAdr            = ptAppParams->uParameter.tRead.ulEndAdr;
-		pucData             = ptAppParams->uParameter.tRead.pucData;
-		ptDeviceDescription = ptAppParams->uParameter.tRead.ptDeviceDescription;
-		uprintf(". Mode: Read\n");
-		uprintf(". Flash offset [0x%08x, 0x%08x[\n", ulStartAdr, ulEndAdr);
-		uprintf(". Buffer address: 0x%08x\n", pucData);
-		break;
-		
-	case OPERATION_MODE_Verify:
-		ulPars = FLAG_STARTADR + FLAG_ENDADR + FLAG_BUFFERADR + FLAG_DEVICE;
-		ulStartAdr          = ptAppParams->uParameter.tVerify.ulStartAdr;
-		ulEndAdr            = ptAppParams->uParameter.tVerify.ulEndAdr;
-		pucData             = ptAppParams->uParameter.tVerify.pucData;
-		ptDeviceDescription = ptAppParams->uParameter.tVerify.ptDeviceDescription;
-		uprintf(". Mode: Verify\n");
-		uprintf(". Flash offset [0x%08x, 0x%08x[\n", ulStartAdr, ulEndAdr);
-		uprintf(". Buffer address: 0x%08x\n", pucData);
-		break;
-		
-	case OPERATION_MODE_Checksum:
-		ulPars = FLAG_STARTADR + FLAG_ENDADR + FLAG_DEVICE;
-		ulStartAdr          = ptAppParams->uParameter.tChecksum.ulStartAdr;
-		ulEndAdr            = ptAppParams->uParameter.tChecksum.ulEndAdr;
-		ptDeviceDescription = ptAppParams->uParameter.tChecksum.ptDeviceDescription;
-		uprintf(". Mode: Checksum (SHA1)\n");
-		uprintf(". Flash offset [0x%08x, 0x%08x[\n", ulStartAdr, ulEndAdr);
-		break;
-		
-	case OPERATION_MODE_IsErased:
-		ulPars = FLAG_STARTADR + FLAG_ENDADR + FLAG_DEVICE;
-		ulStartAdr          = ptAppParams->uParameter.tIsErased.ulStartAdr;
-		ulEndAdr            = ptAppParams->uParameter.tIsErased.ulEndAdr;
-		ptDeviceDescription = ptAppParams->uParameter.tIsErased.ptDeviceDescription;
-		uprintf(". Mode: IsErased\n");
-		uprintf(". Flash offset [0x%08x, 0x%08x[\n", ulStartAdr, ulEndAdr);
-		break;
 
-	case OPERATION_MODE_GetEraseArea:
-		ulPars = FLAG_STARTADR + FLAG_ENDADR + FLAG_DEVICE;
-		ulStartAdr          = ptAppParams->uParameter.tGetEraseArea.ulStartAdr;
-		ulEndAdr            = ptAppParams->uParameter.tGetEraseArea.ulEndAdr;
-		ptDeviceDescription = ptAppParams->uParameter.tGetEraseArea.ptDeviceDescription;
-		uprintf(". Mode: Get Erase Area\n");
-		uprintf(". Flash offset [0x%08x, 0x%08x[\n", ulStartAdr, ulEndAdr);
-		break;
+/* EasyErase scans the area in windows of this many units. */
+#define EASY_ERASE_MAP_BYTES 256U
+static unsigned char aucEasyEraseMap[EASY_ERASE_MAP_BYTES];
 
-	case OPERATION_MODE_GetBoardInfo:
-		ulPars = 0;
-		uprintf(".Mode: Get Board Info\n");
-		break;
+static NETX_CONSOLEAPP_RESULT_T opMode_easyErase(tFlasherInputParameter *ptAppParams, NETX_CONSOLEAPP_PARAMETER_T *ptConsoleParams)
+{
+	NETX_CONSOLEAPP_RESULT_T tResult;
+	CMD_PARAMETER_GETERASEAREA_T *ptParameter;
+	tFlasherInputParameter tStep;
+	unsigned long ulUnitStart;
+	unsigned long ulUnitEnd;
+	unsigned long ulUnitSize;
+	unsigned long ulWindowStart;
+	unsigned long ulWindowEnd;
+	unsigned long ulWindowUnits;
+	unsigned long ulDirtyUnits;
+	unsigned long ulUnit;
+	unsigned long ulRunStart;
+	unsigned long ulCnt;
 
-	case OPERATION_MODE_EasyErase:
-		ulPars = FLAG_STARTADR + FLAG_ENDADR + FLAG_DEVICE;
-		ulStartAdr          = ptAppParams->uParameter.tGetEraseArea.ulStartAdr;
-		ulEndAdr            = ptAppParams->uParameter.tGetEraseArea.ulEndAdr;
-		ptDeviceDescription = ptAppParams->uParameter.tGetEraseArea.ptDeviceDescription;
-		uprintf(". Mode: Get Erase Area\n");
-		uprintf(". Flash offset [0x%08x, 0x%08x[\n", ulStartAdr, ulEndAdr);
-		break;
 
-	case OPERATION_MODE_SpiMacroPlayer:
-		ulPars = 0;
-		/* NOTE: do not print the mode here or the user will get insane for big macros. */
-		break;
+	/* Get a shortcut to the parameters. */
+	ptParameter = &(ptAppParams->uParameter.tGetEraseArea);
 
-	default:
-		ulPars = 0;
-		uprintf("! unknown operation mode: %d\n", tOpMode);
-		return NETX_CONSOLEAPP_RESULT_ERROR;
-		break;
+	/* Adapt the erase area to the sector boundaries. */
+	tResult = opMode_getEraseArea(ptAppParams);
+	if( tResult==NETX_CONSOLEAPP_RESULT_OK )
+	{
+		tResult = get_erase_unit(ptParameter->ptDeviceDescription, ptParameter->ulStartAdr, &ulUnitStart, &ulUnitEnd);
 	}
-	
-	/* If the mode requires a device description, check if it is correct
-		and if the offsets are within the size */
-	if (ulPars & FLAG_DEVICE)
+
+	/* Nothing was erased so far. */
+	ptConsoleParams->pvReturnMessage = (void*)0xff;
+
+	if( tResult==NETX_CONSOLEAPP_RESULT_OK )
 	{
-		tResult = check_device_description(ptDeviceDescription);
-		if (tResult != NETX_CONSOLEAPP_RESULT_OK)
-		{
-			return tResult;
-		}
-		else
+		ulUnitSize = ulUnitEnd - ulUnitStart;
+
+		/* Find the units which are not erased and erase only them. */
+		ulWindowStart = ptParameter->ulStartAdr;
+		while( tResult==NETX_CONSOLEAPP_RESULT_OK && ulWindowStart<ptParameter->ulEndAdr )
 		{
-			ulFlashSize = getFlashSize(ptDeviceDescription);
-			uprintf(". Flash size: 0x%08x\n", ulFlashSize);
-			
-			if ((ulPars & FLAG_STARTADR) && ulStartAdr >= ulFlashSize)
+			ulWindowUnits = (ptParameter->ulEndAdr - ulWindowStart + ulUnitSize - 1U) / ulUnitSize;
+			if( ulWindowUnits>8U*EASY_ERASE_MAP_BYTES )
 			{
-				uprintf("! Start offset exceeds flash size.\n");
-				return NETX_CONSOLEAPP_RESULT_ERROR;
+				ulWindowUnits = 8U*EASY_ERASE_MAP_BYTES;
 			}
-			
-			if ((ulPars & FLAG_ENDADR) && ulEndAdr > ulFlashSize
-				&& ( tOpMode != OPERATION_MODE_GetEraseArea && ulEndAdr != 0xffffffffU))
+			ulWindowEnd = ulWindowStart + ulWindowUnits * ulUnitSize;
+			if( ulWindowEnd>ptParameter->ulEndAdr )
 			{
-				uprintf("! End offset exceeds flash size.\n");
-				return NETX_CONSOLEAPP_RESULT_ERROR;
+				ulWindowEnd = ptParameter->ulEndAdr;
 			}
-			
-			if ((ulPars & FLAG_SIZE) && ulDataByteSize > ulFlashSize)
+
+			for(ulCnt=0; ulCnt<EASY_ERASE_MAP_BYTES; ++ulCnt)
 			{
-				uprintf("! Data size exceeds flash size.\n");
-				return NETX_CONSOLEAPP_RESULT_ERROR;
+				aucEasyEraseMap[ulCnt] = 0;
 			}
-		}
+			tResult = scan_erase_map(ptParameter->ptDeviceDescription, ulWindowStart, ulWindowEnd, ulUnitSize, aucEasyEraseMap, &ulDirtyUnits);
+
+			/* Erase each run of dirty units with one command. */
+			ulUnit = 0;
+			while( tResult==NETX_CONSOLEAPP_RESULT_OK && ulDirtyUnits!=0 && ulUnit<ulWindowUnits )
+			{
+				if( (aucEasyEraseMap[ulUnit >> 3U] & (1U << (ulUnit & 7U)))==0 )
+				{
+					++ulUnit;
+				}
+				else
+				{
+					ulRunStart = ulUnit;
+					do
+					{
+						++ulUnit;
+					} while( ulUnit<ulWindowUnits && (aucEasyEraseMap[ulUnit >> 3U] & (1U << (ulUnit & 7U)))!=0 );
+
+					tStep.tOperationMode = OPERATION_MODE_GetEraseArea;
+					tStep.uParameter.tGetEraseArea.ptDeviceDescription = ptParameter->ptDeviceDescription;
+					tStep.uParameter.tGetEraseArea.ulStartAdr = ulWindowStart + ulRunStart * ulUnitSize;
+					tStep.uParameter.tGetEraseArea.ulEndAdr = ulWindowStart + ulUnit * ulUnitSize;
+					if( tStep.uParameter.tGetEraseArea.ulEndAdr>ulWindowEnd )
+					{
+						tStep.uParameter.tGetEraseArea.ulEndAdr = ulWindowEnd;
+					}
+					tResult = opMode_getEraseArea(&tStep);
+					if( tResult==NETX_CONSOLEAPP_RESULT_OK )
+					{
+						tStep.tOperationMode = OPERATION_MODE_Erase;
+						tResult = opMode_erase(&tStep, ptConsoleParams);
+					}
+				}
+			}
+
+			ulWindowStart = ulWindowEnd;
+		}
+	}
+
+	return tResult;
+}
+
+
+/* ------------------------------------- */
+
+
+/* Get the next extent from a sparse data list.
+ * Returns 1 if an extent was found, 0 at the end of the list and -1 if the
+ * list is invalid.
+ */
+static int sparse_next_extent(const unsigned char **ppucCnt, const unsigned char *pucEnd, unsigned long ulDataByteSize, unsigned long *pulOffset, unsigned long *pulLength, const unsigned char **ppucData)
+{
+	const unsigned char *pucCnt;
+	const unsigned long *pulHeader;
+	unsigned long ulOffset;
+	unsigned long ulLength;
+	unsigned long ulPadded;
+
+
+	pucCnt = *ppucCnt;
+	if( pucCnt==pucEnd )
+	{
+		return 0;
+	}
+	if( (size_t)(pucEnd-pucCnt)<2U*sizeof(unsigned long) )
+	{
+		return -1;
+	}
+
+	pulHeader = (const unsigned long*)pucCnt;
+	ulOffset = pulHeader[0];
+	ulLength = pulHeader[1];
+	pucCnt += 2U*sizeof(unsigned long);
+
+	ulPadded = (ulLength + 3U) & ~3U;
+	if( ulPadded<ulLength || ulPadded>(unsigned long)(pucEnd-pucCnt) || ulOffset>ulDataByteSize || ulLength>(ulDataByteSize-ulOffset) )
+	{
+		return -1;
+	}
+
+	*pulOffset = ulOffset;
+	*pulLength = ulLength;
+	*ppucData = pucCnt;
+	*ppucCnt = pucCnt + ulPadded;
+
+	return 1;
+}
+
+
+/* Build the complete data of a sparse erase-flash-verify in pucData. All
+ * bytes between the extents get the erased value.
+ */
+static NETX_CONSOLEAPP_RESULT_T sparse_expand(CMD_PARAMETER_ERASEFLASHVERIFY_T *ptParameter)
+{
+	const unsigned char *pucCnt;
+	const unsigned char *pucEnd;
+	const unsigned char *pucExtent;
+	unsigned long ulOffset;
+	unsigned long ulLength;
+	int iResult;
+
+
+	pucCnt = ptParameter->pucExtents;
+	pucEnd = pucCnt + ptParameter->ulExtentsSize;
+	if( (((unsigned long)pucCnt)&3U)!=0 )
+	{
+		uprintf("! The extent list is not aligned to a DWORD.\n");
+		return NETX_CONSOLEAPP_RESULT_ERROR;
+	}
+
+	memset(ptParameter->pucData, MEM_CHECK_ERASED_VALUE, ptParameter->ulDataByteSize);
+	do
+	{
+		iResult = sparse_next_extent(&pucCnt, pucEnd, ptParameter->ulDataByteSize, &ulOffset, &ulLength, &pucExtent);
+		if( iResult==1 )
+		{
+			memcpy(ptParameter->pucData + ulOffset, pucExtent, ulLength);
+		}
+	} while( iResult==1 );
+
+	if( iResult!=0 )
+	{
+		uprintf("! The extent list is invalid.\n");
+		return NETX_CONSOLEAPP_RESULT_ERROR;
+	}
+
+	return NETX_CONSOLEAPP_RESULT_OK;
+}
+
+
+static NETX_CONSOLEAPP_RESULT_T opMode_eraseFlashVerify(tFlasherInputParameter *ptAppParams, NETX_CONSOLEAPP_PARAMETER_T *ptConsoleParams)
+{
+	NETX_CONSOLEAPP_RESULT_T tResult;
+	CMD_PARAMETER_ERASEFLASHVERIFY_T *ptParameter;
+	tFlasherInputParameter tStep;
+	const DEVICE_DESCRIPTION_T *ptDeviceDescription;
+	int iSparse;
+	const unsigned char *pucCnt;
+	const unsigned char *pucEnd;
+	const unsigned char *pucExtent;
+	unsigned long ulOffset;
+	unsigned long ulLength;
+
+
+	/* Get a shortcut to the parameters. */
+	ptParameter = &(ptAppParams->uParameter.tEraseFlashVerify);
+	ptDeviceDescription = ptParameter->ptDeviceDescription;
+
+	ptParameter->tResult = ERASEFLASHVERIFY_RESULT_EraseFailed;
+	ptParameter->ulErased = 0;
+
+	/* The steps use the parameters of the single operations. */
+	tStep.ulParamVersion = ptAppParams->ulParamVersion;
+
+	/* Unpack the data before anything is erased. */
+	iSparse = ((ptParameter->ulFlags&ERASEFLASHVERIFY_FLAG_Sparse)!=0) ? 1 : 0;
+	if( iSparse!=0 )
+	{
+		tResult = sparse_expand(ptParameter);
+	}
+	else
+	{
+		tResult = decompress_data(ptParameter->pucData, ptParameter->ulDataByteSize, ptParameter->pucCompressed, ptParameter->ulCompressedSize);
+	}
+	if( tResult!=NETX_CONSOLEAPP_RESULT_OK )
+	{
+		ptParameter->tResult = ERASEFLASHVERIFY_RESULT_FlashFailed;
+	}
+	else if( ptParameter->ulEraseStartAdr<ptParameter->ulEraseEndAdr )
+	{
+		/* Is the erase area already clean? */
+		tStep.tOperationMode = OPERATION_MODE_IsErased;
+		tStep.uParameter.tIsErased.ptDeviceDescription = ptDeviceDescription;
+		tStep.uParameter.tIsErased.ulStartAdr = ptParameter->ulEraseStartAdr;
+		tStep.uParameter.tIsErased.ulEndAdr = ptParameter->ulEraseEndAdr;
+		tResult = opMode_isErased(&tStep, ptConsoleParams);
+		if( tResult==NETX_CONSOLEAPP_RESULT_OK && ptConsoleParams->pvReturnMessage!=((void*)0xff) )
+		{
+			/* Adapt the erase area to the sector boundaries. */
+			tStep.tOperationMode = OPERATION_MODE_GetEraseArea;
+			tStep.uParameter.tGetEraseArea.ptDeviceDescription = ptDeviceDescription;
+			tStep.uParameter.tGetEraseArea.ulStartAdr = ptParameter->ulEraseStartAdr;
+			tStep.uParameter.tGetEraseArea.ulEndAdr = ptParameter->ulEraseEndAdr;
+			tResult = opMode_getEraseArea(&tStep);
+			if( tResult==NETX_CONSOLEAPP_RESULT_OK )
+			{
+				tStep.tOperationMode = OPERATION_MODE_Erase;
+				tResult = opMode_erase(&tStep, ptConsoleParams);
+				if( tResult==NETX_CONSOLEAPP_RESULT_OK )
+				{
+					ptParameter->ulErased = 1;
+
+					/* Check the erased area unless the device checked it already. */
+					if( (ptParameter->ulFlags&ERASEFLASHVERIFY_FLAG_TrustEraseStatus)==0 || ptConsoleParams->pvReturnMessage!=((void*)1) )
+					{
+						tStep.tOperationMode = OPERATION_MODE_IsErased;
+						tResult = opMode_isErased(&tStep, ptConsoleParams);
+						if( tResult==NETX_CONSOLEAPP_RESULT_OK && ptConsoleParams->pvReturnMessage!=((void*)0xff) )
+						{
+							uprintf("! The area is not empty after the erase.\n");
+							tResult = NETX_CONSOLEAPP_RESULT_ERROR;
+						}
+					}
+				}
+
+				ptParameter->ulEraseStartAdr = tStep.uParameter.tErase.ulStartAdr;
+				ptParameter->ulEraseEndAdr = tStep.uParameter.tErase.ulEndAdr;
+			}
+		}
+	}
+
+	if( tResult==NETX_CONSOLEAPP_RESULT_OK )
+	{
+		ptParameter->tResult = ERASEFLASHVERIFY_RESULT_FlashFailed;
+
+		tStep.tOperationMode = OPERATION_MODE_Flash;
+		tStep.uParameter.tFlash.ptDeviceDescription = ptDeviceDescription;
+		tStep.uParameter.tFlash.pucCompressed = NULL;
+		tStep.uParameter.tFlash.ulCompressedSize = 0;
+		if( iSparse!=0 )
+		{
+			/* Write only the extents. The gaps stay erased. */
+			pucCnt = ptParameter->pucExtents;
+			pucEnd = pucCnt + ptParameter->ulExtentsSize;
+			while( tResult==NETX_CONSOLEAPP_RESULT_OK && sparse_next_extent(&pucCnt, pucEnd, ptParameter->ulDataByteSize, &ulOffset, &ulLength, &pucExtent)==1 )
+			{
+				tStep.uParameter.tFlash.ulStartAdr = ptParameter->ulStartAdr + ulOffset;
+				tStep.uParameter.tFlash.ulDataByteSize = ulLength;
+				tStep.uParameter.tFlash.pucData = ptParameter->pucData + ulOffset;
+				tResult = opMode_flash(&tStep);
+			}
+		}
+		else
+		{
+			tStep.uParameter.tFlash.ulStartAdr = ptParameter->ulStartAdr;
+			tStep.uParameter.tFlash.ulDataByteSize = ptParameter->ulDataByteSize;
+			tStep.uParameter.tFlash.pucData = ptParameter->pucData;
+			tResult = opMode_flash(&tStep);
+		}
+	}
+
+	/* The flash routines for SPI, parallel flash and SDIO verify the data
+	 * already. Only the internal flash needs a separate step. The gaps of
+	 * sparse data were not written, so the complete area is verified.
+	 */
+	if( tResult==NETX_CONSOLEAPP_RESULT_OK && (ptDeviceDescription->tSourceTyp==BUS_IFlash || iSparse!=0) )
+	{
+		ptParameter->tResult = ERASEFLASHVERIFY_RESULT_VerifyFailed;
+
+		tStep.tOperationMode = OPERATION_MODE_Verify;
+		tStep.uParameter.tVerify.ptDeviceDescription = ptDeviceDescription;
+		tStep.uParameter.tVerify.ulStartAdr = ptParameter->ulStartAdr;
+		tStep.uParameter.tVerify.ulEndAdr = ptParameter->ulStartAdr + ptParameter->ulDataByteSize;
+		tStep.uParameter.tVerify.pucData = ptParameter->pucData;
+		tStep.uParameter.tVerify.pucReport = NULL;
+		tStep.uParameter.tVerify.sizReport = 0;
+		tResult = opMode_verify(&tStep, ptConsoleParams);
+		if( tResult==NETX_CONSOLEAPP_RESULT_OK && ptConsoleParams->pvReturnMessage!=((void*)0) )
+		{
+			tResult = NETX_CONSOLEAPP_RESULT_ERROR;
+		}
+	}
+
+	if( tResult==NETX_CONSOLEAPP_RESULT_OK )
+	{
+		ptParameter->tResult = ERASEFLASHVERIFY_RESULT_Ok;
+	}
+	ptConsoleParams->pvReturnMessage = (void*)ptParameter->tResult;
+
+	return tResult;
+}
+
+
+
+/* Interval for the request messages to the host while the ring buffer is empty. */
+#define FLASH_STREAM_REQUEST_INTERVAL_MS 1000U
+
+static NETX_CONSOLEAPP_RESULT_T opMode_flashStream(tFlasherInputParameter *ptAppParams, NETX_CONSOLEAPP_PARAMETER_T *ptConsoleParams)
+{
+	NETX_CONSOLEAPP_RESULT_T tResult;
+	CMD_PARAMETER_FLASHSTREAM_T *ptParameter;
+	FLASH_STREAM_CONTROL_T *ptControl;
+	tFlasherInputParameter tStep;
+	unsigned long ulConsumer;
+	unsigned long ulOffset;
+	unsigned long ulChunkSize;
+	unsigned long ulWaitStart;
+	unsigned long ulLastRequest;
+	unsigned char *pucSlot;
+
+
+	/* Get a shortcut to the parameters. */
+	ptParameter = &(ptAppParams->uParameter.tFlashStream);
+	ptControl = ptParameter->ptControl;
+
+	/* Each slot is flashed with the parameters of the flash operation. */
+	tStep.ulParamVersion = ptAppParams->ulParamVersion;
+
+	tResult = NETX_CONSOLEAPP_RESULT_OK;
+	ulOffset = 0;
+	ulWaitStart = systime_get_ms();
+	ulLastRequest = ulWaitStart;
+	while( ulOffset<ptParameter->ulDataByteSize )
+	{
+		if( ptControl->ulAbort!=0 )
+		{
+			uprintf("! The host stopped the stream.\n");
+			tResult = NETX_CONSOLEAPP_RESULT_ERROR;
+			break;
+		}
+
+		ulConsumer = ptControl->ulConsumer;
+		if( ptControl->ulProducer==ulConsumer )
+		{
+			/* The ring buffer is empty. Wait for the host. */
+			if( systime_elapsed(ulWaitStart, ptParameter->ulTimeoutMs)!=0 )
+			{
+				uprintf("! Timeout while waiting for data from the host.\n");
+				tResult = NETX_CONSOLEAPP_RESULT_ERROR;
+				break;
+			}
+			if( systime_elapsed(ulLastRequest, FLASH_STREAM_REQUEST_INTERVAL_MS)!=0 )
+			{
+				/* Remind the host. */
+				uprintf("%% %08x/%08x\n", ulOffset, ptParameter->ulDataByteSize);
+				ulLastRequest = systime_get_ms();
+			}
+		}
+		else
+		{
+			ulChunkSize = ptParameter->ulDataByteSize - ulOffset;
+			if( ulChunkSize>ptParameter->ulSlotSize )
+			{
+				ulChunkSize = ptParameter->ulSlotSize;
+			}
+			pucSlot = ptParameter->pucRing + (ulConsumer % ptParameter->ulSlots) * ptParameter->ulSlotSize;
+
+			tStep.tOperationMode = OPERATION_MODE_Flash;
+			tStep.uParameter.tFlash.ptDeviceDescription = ptParameter->ptDeviceDescription;
+			tStep.uParameter.tFlash.ulStartAdr = ptParameter->ulStartAdr + ulOffset;
+			tStep.uParameter.tFlash.ulDataByteSize = ulChunkSize;
+			tStep.uParameter.tFlash.pucData = pucSlot;
+			tStep.uParameter.tFlash.pucCompressed = NULL;
+			tStep.uParameter.tFlash.ulCompressedSize = 0;
+			tResult = opMode_flash(&tStep);
+
+			/* Only the internal flash needs a separate verify, see opMode_eraseFlashVerify. */
+			if( tResult==NETX_CONSOLEAPP_RESULT_OK && ptParameter->ptDeviceDescription->tSourceTyp==BUS_IFlash )
+			{
+				tStep.tOperationMode = OPERATION_MODE_Verify;
+				tStep.uParameter.tVerify.ptDeviceDescription = ptParameter->ptDeviceDescription;
+				tStep.uParameter.tVerify.ulStartAdr = ptParameter->ulStartAdr + ulOffset;
+				tStep.uParameter.tVerify.ulEndAdr = ptParameter->ulStartAdr + ulOffset + ulChunkSize;
+				tStep.uParameter.tVerify.pucData = pucSlot;
+				tStep.uParameter.tVerify.pucReport = NULL;
+				tStep.uParameter.tVerify.sizReport = 0;
+				tResult = opMode_verify(&tStep, ptConsoleParams);
+				if( tResult==NETX_CONSOLEAPP_RESULT_OK && ptConsoleParams->pvReturnMessage!=((void*)0) )
+				{
+					tResult = NETX_CONSOLEAPP_RESULT_ERROR;
+				}
+			}
+
+			if( tResult!=NETX_CONSOLEAPP_RESULT_OK )
+			{
+				uprintf("! Failed to flash the slot at offset 0x%08x.\n", ulOffset);
+				break;
+			}
+
+			/* Release the slot. */
+			ulOffset += ulChunkSize;
+			ptControl->ulConsumer = ulConsumer + 1U;
+
+			/* The progress message tells the host that a slot is free. */
+			uprintf("%% %08x/%08x\n", ulOffset, ptParameter->ulDataByteSize);
+			ulWaitStart = systime_get_ms();
+			ulLastRequest = ulWaitStart;
+		}
+	}
+
+	/* Return the number of flashed bytes. */
+	ptConsoleParams->pvReturnMessage = (void*)ulOffset;
+
+	return tResult;
+}
+
+
+/* ------------------------------------- */
+
+
+/* Read an area of a device to the RAM. */
+static NETX_CONSOLEAPP_RESULT_T read_area(const DEVICE_DESCRIPTION_T *ptDeviceDescription, unsigned long ulStartAdr, unsigned long ulEndAdr, unsigned char *pucData)
+{
+	tFlasherInputParameter tStep;
+
+
+	tStep.tOperationMode = OPERATION_MODE_Read;
+	tStep.uParameter.tRead.ptDeviceDescription = ptDeviceDescription;
+	tStep.uParameter.tRead.ulStartAdr = ulStartAdr;
+	tStep.uParameter.tRead.ulEndAdr = ulEndAdr;
+	tStep.uParameter.tRead.pucData = pucData;
+	tStep.uParameter.tRead.pucCompressed = NULL;
+	tStep.uParameter.tRead.ulCompressedMax = 0;
+	return opMode_read(&tStep);
+}
+
+
+/* Write the new contents of a complete erase block. The block is only
+ * erased and written if it differs from pucData. piChanged is set to 1 if
+ * the block was written.
+ */
+static NETX_CONSOLEAPP_RESULT_T rewrite_erase_block(const DEVICE_DESCRIPTION_T *ptDeviceDescription, unsigned long ulBlockStart, unsigned long ulBlockEnd, unsigned char *pucData, NETX_CONSOLEAPP_PARAMETER_T *ptConsoleParams, int *piChanged)
+{
+	NETX_CONSOLEAPP_RESULT_T tResult;
+	tFlasherInputParameter tStep;
+
+
+	*piChanged = 0;
+
+	/* Is the block different from the new contents? */
+	tStep.tOperationMode = OPERATION_MODE_Verify;
+	tStep.uParameter.tVerify.ptDeviceDescription = ptDeviceDescription;
+	tStep.uParameter.tVerify.ulStartAdr = ulBlockStart;
+	tStep.uParameter.tVerify.ulEndAdr = ulBlockEnd;
+	tStep.uParameter.tVerify.pucData = pucData;
+	tStep.uParameter.tVerify.pucReport = NULL;
+	tStep.uParameter.tVerify.sizReport = 0;
+	tResult = opMode_verify(&tStep, ptConsoleParams);
+	if( tResult==NETX_CONSOLEAPP_RESULT_OK && ptConsoleParams->pvReturnMessage!=((void*)0) )
+	{
+		uprintf("# Rewriting the erase block [0x%08x, 0x%08x[.\n", ulBlockStart, ulBlockEnd);
+
+		tStep.tOperationMode = OPERATION_MODE_Erase;
+		tStep.uParameter.tErase.ptDeviceDescription = ptDeviceDescription;
+		tStep.uParameter.tErase.ulStartAdr = ulBlockStart;
+		tStep.uParameter.tErase.ulEndAdr = ulBlockEnd;
+		tResult = opMode_erase(&tStep, ptConsoleParams);
+		if( tResult==NETX_CONSOLEAPP_RESULT_OK )
+		{
+			*piChanged = 1;
+
+			tStep.tOperationMode = OPERATION_MODE_Flash;
+			tStep.uParameter.tFlash.ptDeviceDescription = ptDeviceDescription;
+			tStep.uParameter.tFlash.ulStartAdr = ulBlockStart;
+			tStep.uParameter.tFlash.ulDataByteSize = ulBlockEnd - ulBlockStart;
+			tStep.uParameter.tFlash.pucData = pucData;
+			tStep.uParameter.tFlash.pucCompressed = NULL;
+			tStep.uParameter.tFlash.ulCompressedSize = 0;
+			tResult = opMode_flash(&tStep);
+		}
+
+		/* Only the internal flash needs a separate verify, see opMode_eraseFlashVerify. */
+		if( tResult==NETX_CONSOLEAPP_RESULT_OK && ptDeviceDescription->tSourceTyp==BUS_IFlash )
+		{
+			tStep.tOperationMode = OPERATION_MODE_Verify;
+			tStep.uParameter.tVerify.ptDeviceDescription = ptDeviceDescription;
+			tStep.uParameter.tVerify.ulStartAdr = ulBlockStart;
+			tStep.uParameter.tVerify.ulEndAdr = ulBlockEnd;
+			tStep.uParameter.tVerify.pucData = pucData;
+			tStep.uParameter.tVerify.pucReport = NULL;
+			tStep.uParameter.tVerify.sizReport = 0;
+			tResult = opMode_verify(&tStep, ptConsoleParams);
+			if( tResult==NETX_CONSOLEAPP_RESULT_OK && ptConsoleParams->pvReturnMessage!=((void*)0) )
+			{
+				tResult = NETX_CONSOLEAPP_RESULT_ERROR;
+			}
+		}
+
+		if( tResult!=NETX_CONSOLEAPP_RESULT_OK )
+		{
+			uprintf("! Failed to rewrite the erase block [0x%08x, 0x%08x[.\n", ulBlockStart, ulBlockEnd);
+		}
+	}
+
+	return tResult;
+}
+
+
+/* Get the next instruction from a delta.
+ * Returns 1 if an instruction was found, 0 at the end of the delta and -1
+ * if the delta is invalid.
+ */
+static int patch_next_instruction(const unsigned char **ppucCnt, const unsigned char *pucEnd, unsigned long *pulOp, unsigned long *pulLength, unsigned long *pulSource, const unsigned char **ppucLiteral)
+{
+	const unsigned char *pucCnt;
+	const unsigned long *pulHeader;
+	unsigned long ulOp;
+	unsigned long ulLength;
+	unsigned long ulPadded;
+
+
+	pucCnt = *ppucCnt;
+	if( pucCnt==pucEnd )
+	{
+		return 0;
+	}
+	if( (size_t)(pucEnd-pucCnt)<sizeof(unsigned long) )
+	{
+		return -1;
+	}
+
+	pulHeader = (const unsigned long*)pucCnt;
+	ulOp = pulHeader[0] >> PATCH_OP_SHIFT;
+	ulLength = pulHeader[0] & PATCH_LENGTH_MASK;
+	pucCnt += sizeof(unsigned long);
+	if( ulLength==0 )
+	{
+		return -1;
+	}
+
+	if( ulOp==PATCH_OP_Copy )
+	{
+		if( (size_t)(pucEnd-pucCnt)<sizeof(unsigned long) )
+		{
+			return -1;
+		}
+		*pulSource = pulHeader[1];
+		*ppucLiteral = NULL;
+		pucCnt += sizeof(unsigned long);
+	}
+	else if( ulOp==PATCH_OP_Literal )
+	{
+		ulPadded = (ulLength + 3U) & ~3U;
+		if( ulPadded>(unsigned long)(pucEnd-pucCnt) )
+		{
+			return -1;
+		}
+		*pulSource = 0;
+		*ppucLiteral = pucCnt;
+		pucCnt += ulPadded;
+	}
+	else
+	{
+		return -1;
+	}
+
+	*pulOp = ulOp;
+	*pulLength = ulLength;
+	*ppucCnt = pucCnt;
+
+	return 1;
+}
+
+
+static NETX_CONSOLEAPP_RESULT_T opMode_patch(tFlasherInputParameter *ptAppParams, NETX_CONSOLEAPP_PARAMETER_T *ptConsoleParams)
+{
+	NETX_CONSOLEAPP_RESULT_T tResult;
+	CMD_PARAMETER_PATCH_T *ptParameter;
+	const DEVICE_DESCRIPTION_T *ptDeviceDescription;
+	const unsigned char *pucCnt;
+	const unsigned char *pucEnd;
+	const unsigned char *pucLiteral;
+	unsigned long ulOp;
+	unsigned long ulOpLength;
+	unsigned long ulSource;
+	unsigned long ulFlashSize;
+	unsigned long ulAdr;
+	unsigned long ulEndAdr;
+	unsigned long ulBlockStart;
+	unsigned long ulBlockEnd;
+	unsigned long ulPartEnd;
+	unsigned long ulChunkSize;
+	unsigned long ulRewrittenStart;
+	unsigned long ulRewrittenEnd;
+	int iResult;
+	int iChanged;
+
+
+	/* Get a shortcut to the parameters. */
+	ptParameter = &(ptAppParams->uParameter.tPatch);
+	ptDeviceDescription = ptParameter->ptDeviceDescription;
+	ptParameter->ulChangedBlocks = 0;
+
+	tResult = NETX_CONSOLEAPP_RESULT_OK;
+	pucCnt = ptParameter->pucPatch;
+	pucEnd = pucCnt + ptParameter->ulPatchSize;
+	if( (((unsigned long)pucCnt)&3U)!=0 )
+	{
+		uprintf("! The delta is not aligned to a DWORD.\n");
+		tResult = NETX_CONSOLEAPP_RESULT_ERROR;
+	}
+
+	ulFlashSize = getFlashSize(ptDeviceDescription);
+	ulOp = PATCH_OP_Copy;
+	ulOpLength = 0;
+	ulSource = 0;
+	pucLiteral = NULL;
+	ulRewrittenStart = 0;
+	ulRewrittenEnd = 0;
+	ulAdr = ptParameter->ulStartAdr;
+	ulEndAdr = ptParameter->ulStartAdr + ptParameter->ulDataByteSize;
+	while( tResult==NETX_CONSOLEAPP_RESULT_OK && ulAdr<ulEndAdr )
+	{
+		tResult = get_erase_unit(ptDeviceDescription, ulAdr, &ulBlockStart, &ulBlockEnd);
+		if( tResult!=NETX_CONSOLEAPP_RESULT_OK )
+		{
+			break;
+		}
+		if( (ulBlockEnd-ulBlockStart)>ptParameter->ulStagingSize )
+		{
+			uprintf("! The erase block [0x%08x, 0x%08x[ does not fit into the staging buffer.\n", ulBlockStart, ulBlockEnd);
+			tResult = NETX_CONSOLEAPP_RESULT_ERROR;
+			break;
+		}
+
+		/* Start with the current contents. This keeps the parts of the
+		 * block outside of the area.
+		 */
+		tResult = read_area(ptDeviceDescription, ulBlockStart, ulBlockEnd, ptParameter->pucStaging);
+
+		/* Build the new contents of the block. A copy reads the old data
+		 * from the flash, so it may overlap the area which is built.
+		 */
+		ulPartEnd = (ulBlockEnd<ulEndAdr) ? ulBlockEnd : ulEndAdr;
+		while( tResult==NETX_CONSOLEAPP_RESULT_OK && ulAdr<ulPartEnd )
+		{
+			if( ulOpLength==0 )
+			{
+				iResult = patch_next_instruction(&pucCnt, pucEnd, &ulOp, &ulOpLength, &ulSource, &pucLiteral);
+				if( iResult!=1 )
+				{
+					uprintf("! The delta is invalid or too short at offset 0x%08x.\n", ulAdr);
+					tResult = NETX_CONSOLEAPP_RESULT_ERROR;
+					break;
+				}
+			}
+
+			ulChunkSize = ulPartEnd - ulAdr;
+			if( ulChunkSize>ulOpLength )
+			{
+				ulChunkSize = ulOpLength;
+			}
+
+			if( ulOp==PATCH_OP_Literal )
+			{
+				memcpy(ptParameter->pucStaging + (ulAdr - ulBlockStart), pucLiteral, ulChunkSize);
+				pucLiteral += ulChunkSize;
+			}
+			else if( ulSource>ulFlashSize || ulChunkSize>(ulFlashSize-ulSource) )
+			{
+				uprintf("! The copy source 0x%08x is outside of the flash.\n", ulSource);
+				tResult = NETX_CONSOLEAPP_RESULT_ERROR;
+			}
+			else if( ulSource<ulRewrittenEnd && (ulSource+ulChunkSize)>ulRewrittenStart )
+			{
+				uprintf("! The copy source 0x%08x was already rewritten.\n", ulSource);
+				tResult = NETX_CONSOLEAPP_RESULT_ERROR;
+			}
+			else
+			{
+				tResult = read_area(ptDeviceDescription, ulSource, ulSource + ulChunkSize, ptParameter->pucStaging + (ulAdr - ulBlockStart));
+				ulSource += ulChunkSize;
+			}
+
+			ulAdr += ulChunkSize;
+			ulOpLength -= ulChunkSize;
+		}
+
+		if( tResult==NETX_CONSOLEAPP_RESULT_OK )
+		{
+			tResult = rewrite_erase_block(ptDeviceDescription, ulBlockStart, ulBlockEnd, ptParameter->pucStaging, ptConsoleParams, &iChanged);
+			if( tResult==NETX_CONSOLEAPP_RESULT_OK && iChanged!=0 )
+			{
+				if( ulRewrittenStart==ulRewrittenEnd )
+				{
+					ulRewrittenStart = ulBlockStart;
+				}
+				ulRewrittenEnd = ulBlockEnd;
+				++ptParameter->ulChangedBlocks;
+			}
+		}
+	}
+
+	if( tResult==NETX_CONSOLEAPP_RESULT_OK && (ulOpLength!=0 || pucCnt!=pucEnd) )
+	{
+		uprintf("! The delta is longer than the area.\n");
+		tResult = NETX_CONSOLEAPP_RESULT_ERROR;
+	}
+
+	/* Return the number of rewritten erase blocks. */
+	ptConsoleParams->pvReturnMessage = (void*)ptParameter->ulChangedBlocks;
+
+	return tResult;
+}
+
+
+/* ------------------------------------- */
+
+
+/* The fill writes chunks which are a multiple of the pattern size and of
+ * this size. The netX 90 internal flash needs 16 byte aligned chunks.
+ */
+#define FILL_CHUNK_ALIGN 16U
+
+static NETX_CONSOLEAPP_RESULT_T opMode_fill(tFlasherInputParameter *ptAppParams, NETX_CONSOLEAPP_PARAMETER_T *ptConsoleParams)
+{
+	NETX_CONSOLEAPP_RESULT_T tResult;
+	CMD_PARAMETER_FILL_T *ptParameter;
+	tFlasherInputParameter tStep;
+	unsigned long ulGranule;
+	unsigned long ulChunkMax;
+	unsigned long ulChunkSize;
+	unsigned long ulOffset;
+	unsigned long ulCnt;
+
+
+	/* Get a shortcut to the parameters. */
+	ptParameter = &(ptAppParams->uParameter.tFill);
+
+	/* Each chunk is written with the parameters of the flash operation. */
+	tStep.ulParamVersion = ptAppParams->ulParamVersion;
+
+	/* All chunks start with the first byte of the pattern. */
+	ulGranule = ptParameter->ulPatternSize * FILL_CHUNK_ALIGN;
+	ulChunkMax = ptParameter->ulBufferSize - (ptParameter->ulBufferSize % ulGranule);
+	if( ulChunkMax>ptParameter->ulDataByteSize )
+	{
+		ulChunkMax = ptParameter->ulDataByteSize;
+	}
+	if( ulChunkMax==0 && ptParameter->ulDataByteSize!=0 )
+	{
+		uprintf("! The fill buffer must have at least 0x%08x bytes.\n", ulGranule);
+		return NETX_CONSOLEAPP_RESULT_ERROR;
+	}
+
+	/* Build the data once. It is the same for all chunks. */
+	for(ulCnt=0; ulCnt<ulChunkMax; ++ulCnt)
+	{
+		ptParameter->pucBuffer[ulCnt] = ptParameter->aucPattern[ulCnt % ptParameter->ulPatternSize];
+	}
+
+	tResult = NETX_CONSOLEAPP_RESULT_OK;
+	ulOffset = 0;
+	while( tResult==NETX_CONSOLEAPP_RESULT_OK && ulOffset<ptParameter->ulDataByteSize )
+	{
+		ulChunkSize = ptParameter->ulDataByteSize - ulOffset;
+		if( ulChunkSize>ulChunkMax )
+		{
+			ulChunkSize = ulChunkMax;
+		}
+
+		tStep.tOperationMode = OPERATION_MODE_Flash;
+		tStep.uParameter.tFlash.ptDeviceDescription = ptParameter->ptDeviceDescription;
+		tStep.uParameter.tFlash.ulStartAdr = ptParameter->ulStartAdr + ulOffset;
+		tStep.uParameter.tFlash.ulDataByteSize = ulChunkSize;
+		tStep.uParameter.tFlash.pucData = ptParameter->pucBuffer;
+		tStep.uParameter.tFlash.pucCompressed = NULL;
+		tStep.uParameter.tFlash.ulCompressedSize = 0;
+		tResult = opMode_flash(&tStep);
+
+		/* Only the internal flash needs a separate verify, see opMode_eraseFlashVerify. */
+		if( tResult==NETX_CONSOLEAPP_RESULT_OK && ptParameter->ptDeviceDescription->tSourceTyp==BUS_IFlash )
+		{
+			tStep.tOperationMode = OPERATION_MODE_Verify;
+			tStep.uParameter.tVerify.ptDeviceDescription = ptParameter->ptDeviceDescription;
+			tStep.uParameter.tVerify.ulStartAdr = ptParameter->ulStartAdr + ulOffset;
+			tStep.uParameter.tVerify.ulEndAdr = ptParameter->ulStartAdr + ulOffset + ulChunkSize;
+			tStep.uParameter.tVerify.pucData = ptParameter->pucBuffer;
+			tStep.uParameter.tVerify.pucReport = NULL;
+			tStep.uParameter.tVerify.sizReport = 0;
+			tResult = opMode_verify(&tStep, ptConsoleParams);
+			if( tResult==NETX_CONSOLEAPP_RESULT_OK && ptConsoleParams->pvReturnMessage!=((void*)0) )
+			{
+				tResult = NETX_CONSOLEAPP_RESULT_ERROR;
+			}
+		}
+
+		if( tResult!=NETX_CONSOLEAPP_RESULT_OK )
+		{
+			uprintf("! Failed to fill the chunk at offset 0x%08x.\n", ulOffset);
+			break;
+		}
+
+		ulOffset += ulChunkSize;
+	}
+
+	/* Return the number of written bytes. */
+	ptConsoleParams->pvReturnMessage = (void*)ulOffset;
+
+	return tResult;
+}
+
+
+/* ------------------------------------- */
+
+
+/* Copy one erase block of the destination. The parts of the block outside
+ * of the destination area keep their contents.
+ */
+static NETX_CONSOLEAPP_RESULT_T copy_erase_block(CMD_PARAMETER_COPY_T *ptParameter, const DEVICE_DESCRIPTION_T *ptSrcDeviceDescription, unsigned long ulAdr, unsigned long *pulBlockStart, unsigned long *pulBlockEnd, NETX_CONSOLEAPP_PARAMETER_T *ptConsoleParams)
+{
+	NETX_CONSOLEAPP_RESULT_T tResult;
+	unsigned long ulBlockStart;
+	unsigned long ulBlockEnd;
+	unsigned long ulPartStart;
+	unsigned long ulPartEnd;
+	unsigned long ulDstEnd;
+	int iChanged;
+
+
+	tResult = get_erase_unit(ptParameter->ptDeviceDescription, ulAdr, &ulBlockStart, &ulBlockEnd);
+	if( tResult==NETX_CONSOLEAPP_RESULT_OK && (ulBlockEnd-ulBlockStart)>ptParameter->ulBufferSize )
+	{
+		uprintf("! The erase block [0x%08x, 0x%08x[ does not fit into the buffer.\n", ulBlockStart, ulBlockEnd);
+		tResult = NETX_CONSOLEAPP_RESULT_ERROR;
+	}
+	if( tResult==NETX_CONSOLEAPP_RESULT_OK )
+	{
+		*pulBlockStart = ulBlockStart;
+		*pulBlockEnd = ulBlockEnd;
+
+		tResult = read_area(ptParameter->ptDeviceDescription, ulBlockStart, ulBlockEnd, ptParameter->pucBuffer);
+		if( tResult==NETX_CONSOLEAPP_RESULT_OK )
+		{
+			ulDstEnd = ptParameter->ulDstAdr + ptParameter->ulDataByteSize;
+			ulPartStart = (ulBlockStart>ptParameter->ulDstAdr) ? ulBlockStart : ptParameter->ulDstAdr;
+			ulPartEnd = (ulBlockEnd<ulDstEnd) ? ulBlockEnd : ulDstEnd;
+			tResult = read_area(ptSrcDeviceDescription, ptParameter->ulSrcAdr + (ulPartStart - ptParameter->ulDstAdr), ptParameter->ulSrcAdr + (ulPartEnd - ptParameter->ulDstAdr), ptParameter->pucBuffer + (ulPartStart - ulBlockStart));
+		}
+		if( tResult==NETX_CONSOLEAPP_RESULT_OK )
+		{
+			tResult = rewrite_erase_block(ptParameter->ptDeviceDescription, ulBlockStart, ulBlockEnd, ptParameter->pucBuffer, ptConsoleParams, &iChanged);
+		}
+	}
+
+	return tResult;
+}
+
+
+static NETX_CONSOLEAPP_RESULT_T opMode_copy(tFlasherInputParameter *ptAppParams, NETX_CONSOLEAPP_PARAMETER_T *ptConsoleParams)
+{
+	NETX_CONSOLEAPP_RESULT_T tResult;
+	CMD_PARAMETER_COPY_T *ptParameter;
+	const DEVICE_DESCRIPTION_T *ptSrcDeviceDescription;
+	tFlasherInputParameter tStep;
+	unsigned long ulDstEnd;
+	unsigned long ulAdr;
+	unsigned long ulBlockStart;
+	unsigned long ulBlockEnd;
+	unsigned long ulChunkMax;
+	unsigned long ulChunkSize;
+	unsigned long ulOffset;
+	int iSameDevice;
+
+
+	/* Get a shortcut to the parameters. */
+	ptParameter = &(ptAppParams->uParameter.tCopy);
+	ptSrcDeviceDescription = ptParameter->ptSrcDeviceDescription;
+	if( ptSrcDeviceDescription==NULL )
+	{
+		ptSrcDeviceDescription = ptParameter->ptDeviceDescription;
+	}
+	iSameDevice = (ptSrcDeviceDescription==ptParameter->ptDeviceDescription) ? 1 : 0;
+
+	tResult = NETX_CONSOLEAPP_RESULT_OK;
+	ulDstEnd = ptParameter->ulDstAdr + ptParameter->ulDataByteSize;
+	if( ptParameter->ulDataByteSize==0 )
+	{
+		/* Nothing to do. */
+	}
+	else if( (ptParameter->ulFlags&COPY_FLAG_Erase)!=0 )
+	{
+		if( iSameDevice!=0 && ptParameter->ulDstAdr>ptParameter->ulSrcAdr )
+		{
+			/* Start with the last block, so the source below is still intact. */
+			ulAdr = ulDstEnd - 1U;
+			do
+			{
+				tResult = copy_erase_block(ptParameter, ptSrcDeviceDescription, ulAdr, &ulBlockStart, &ulBlockEnd, ptConsoleParams);
+				ulAdr = ulBlockStart - 1U;
+			} while( tResult==NETX_CONSOLEAPP_RESULT_OK && ulBlockStart>ptParameter->ulDstAdr );
+		}
+		else
+		{
+			ulAdr = ptParameter->ulDstAdr;
+			do
+			{
+				tResult = copy_erase_block(ptParameter, ptSrcDeviceDescription, ulAdr, &ulBlockStart, &ulBlockEnd, ptConsoleParams);
+				ulAdr = ulBlockEnd;
+			} while( tResult==NETX_CONSOLEAPP_RESULT_OK && ulAdr<ulDstEnd );
+		}
+	}
+	else if( iSameDevice!=0 && ptParameter->ulSrcAdr<ulDstEnd && ptParameter->ulDstAdr<(ptParameter->ulSrcAdr + ptParameter->ulDataByteSize) )
+	{
+		uprintf("! The areas overlap. This needs the erase mode.\n");
+		tResult = NETX_CONSOLEAPP_RESULT_ERROR;
+	}
+	else
+	{
+		/* Stream the data through the buffer. The netX 90 internal flash
+		 * needs 16 byte aligned chunks.
+		 */
+		tStep.ulParamVersion = ptAppParams->ulParamVersion;
+		ulChunkMax = ptParameter->ulBufferSize & ~(FILL_CHUNK_ALIGN-1U);
+		if( ulChunkMax==0 )
+		{
+			uprintf("! The buffer is too small.\n");
+			tResult = NETX_CONSOLEAPP_RESULT_ERROR;
+		}
+
+		ulOffset = 0;
+		while( tResult==NETX_CONSOLEAPP_RESULT_OK && ulOffset<ptParameter->ulDataByteSize )
+		{
+			ulChunkSize = ptParameter->ulDataByteSize - ulOffset;
+			if( ulChunkSize>ulChunkMax )
+			{
+				ulChunkSize = ulChunkMax;
+			}
+
+			tResult = read_area(ptSrcDeviceDescription, ptParameter->ulSrcAdr + ulOffset, ptParameter->ulSrcAdr + ulOffset + ulChunkSize, ptParameter->pucBuffer);
+			if( tResult==NETX_CONSOLEAPP_RESULT_OK )
+			{
+				tStep.tOperationMode = OPERATION_MODE_Flash;
+				tStep.uParameter.tFlash.ptDeviceDescription = ptParameter->ptDeviceDescription;
+				tStep.uParameter.tFlash.ulStartAdr = ptParameter->ulDstAdr + ulOffset;
+				tStep.uParameter.tFlash.ulDataByteSize = ulChunkSize;
+				tStep.uParameter.tFlash.pucData = ptParameter->pucBuffer;
+				tStep.uParameter.tFlash.pucCompressed = NULL;
+				tStep.uParameter.tFlash.ulCompressedSize = 0;
+				tResult = opMode_flash(&tStep);
+			}
+
+			/* Only the internal flash needs a separate verify, see opMode_eraseFlashVerify. */
+			if( tResult==NETX_CONSOLEAPP_RESULT_OK && ptParameter->ptDeviceDescription->tSourceTyp==BUS_IFlash )
+			{
+				tStep.tOperationMode = OPERATION_MODE_Verify;
+				tStep.uParameter.tVerify.ptDeviceDescription = ptParameter->ptDeviceDescription;
+				tStep.uParameter.tVerify.ulStartAdr = ptParameter->ulDstAdr + ulOffset;
+				tStep.uParameter.tVerify.ulEndAdr = ptParameter->ulDstAdr + ulOffset + ulChunkSize;
+				tStep.uParameter.tVerify.pucData = ptParameter->pucBuffer;
+				tStep.uParameter.tVerify.pucReport = NULL;
+				tStep.uParameter.tVerify.sizReport = 0;
+				tResult = opMode_verify(&tStep, ptConsoleParams);
+				if( tResult==NETX_CONSOLEAPP_RESULT_OK && ptConsoleParams->pvReturnMessage!=((void*)0) )
+				{
+					tResult = NETX_CONSOLEAPP_RESULT_ERROR;
+				}
+			}
+
+			if( tResult!=NETX_CONSOLEAPP_RESULT_OK )
+			{
+				uprintf("! Failed to copy the chunk at offset 0x%08x.\n", ulOffset);
+				break;
+			}
+
+			ulOffset += ulChunkSize;
+		}
+	}
+
+	ptConsoleParams->pvReturnMessage = (void*)((tResult==NETX_CONSOLEAPP_RESULT_OK) ? ptParameter->ulDataByteSize : 0);
+
+	return tResult;
+}
+
+
+/* ------------------------------------- */
+
+
+static NETX_CONSOLEAPP_RESULT_T opMode_spiMacroPlayer(tFlasherInputParameter *ptAppParams, NETX_CONSOLEAPP_PARAMETER_T *ptConsoleParams)
+{
+	NETX_CONSOLEAPP_RESULT_T tResult;
+	(void) ptConsoleParams; /* unused */
+
+	tResult = spi_macro_player(&(ptAppParams->uParameter.tSpiMacroPlayer));
+	return tResult;
+}
+
+
+/* ------------------------------------- */
+
+/* The batch which is running at the moment. All data of its entries stays
+ * in the buffer until the batch is finished.
+ */
+static const CMD_PARAMETER_BATCH_T *ptRunningBatch = NULL;
+
+
+/* An operation uses at most this many areas in the data buffer. */
+#define USED_AREAS_MAX 3
+
+/* Get the areas in the data buffer which are used by an operation.
+ * Returns the number of areas.
+ */
+static unsigned int get_used_areas(const tFlasherInputParameter *ptAppParams, const unsigned char **ppucUsedStart, const unsigned char **ppucUsedEnd)
+{
+	unsigned int uiUsed;
+#if CFG_INCLUDE_CHECKSUM!=0
+	const CMD_PARAMETER_CHECKSUM_T *ptChecksum;
+	unsigned long ulBlocks;
+#endif
+
+
+	uiUsed = 0;
+	switch( ptAppParams->tOperationMode )
+	{
+	case OPERATION_MODE_Flash:
+		ppucUsedStart[0] = ptAppParams->uParameter.tFlash.pucData;
+		ppucUsedEnd[0] = ppucUsedStart[0] + ptAppParams->uParameter.tFlash.ulDataByteSize;
+		uiUsed = 1;
+		break;
+
+	case OPERATION_MODE_EraseFlashVerify:
+		ppucUsedStart[0] = ptAppParams->uParameter.tEraseFlashVerify.pucData;
+		ppucUsedEnd[0] = ppucUsedStart[0] + ptAppParams->uParameter.tEraseFlashVerify.ulDataByteSize;
+		uiUsed = 1;
+		/* The extent list is parsed again when the data is written. */
+		if( (ptAppParams->uParameter.tEraseFlashVerify.ulFlags&ERASEFLASHVERIFY_FLAG_Sparse)!=0 )
+		{
+			ppucUsedStart[uiUsed] = ptAppParams->uParameter.tEraseFlashVerify.pucExtents;
+			ppucUsedEnd[uiUsed] = ppucUsedStart[uiUsed] + ptAppParams->uParameter.tEraseFlashVerify.ulExtentsSize;
+			++uiUsed;
+		}
+		if( ptAppParams->uParameter.tEraseFlashVerify.ulCompressedSize!=0 )
+		{
+			ppucUsedStart[uiUsed] = ptAppParams->uParameter.tEraseFlashVerify.pucCompressed;
+			ppucUsedEnd[uiUsed] = ppucUsedStart[uiUsed] + ptAppParams->uParameter.tEraseFlashVerify.ulCompressedSize;
+			++uiUsed;
+		}
+		break;
+
+	case OPERATION_MODE_GetEraseMap:
+		ppucUsedStart[0] = ptAppParams->uParameter.tGetEraseMap.pucBitmap;
+		ppucUsedEnd[0] = ppucUsedStart[0] + ptAppParams->uParameter.tGetEraseMap.ulBitmapSize;
+		uiUsed = 1;
+		break;
+
+	case OPERATION_MODE_Copy:
+		ppucUsedStart[0] = ptAppParams->uParameter.tCopy.pucBuffer;
+		ppucUsedEnd[0] = ppucUsedStart[0] + ptAppParams->uParameter.tCopy.ulBufferSize;
+		uiUsed = 1;
+		break;
+
+	case OPERATION_MODE_Fill:
+		ppucUsedStart[0] = ptAppParams->uParameter.tFill.pucBuffer;
+		ppucUsedEnd[0] = ppucUsedStart[0] + ptAppParams->uParameter.tFill.ulBufferSize;
+		uiUsed = 1;
+		break;
+
+	case OPERATION_MODE_Patch:
+		ppucUsedStart[0] = ptAppParams->uParameter.tPatch.pucPatch;
+		ppucUsedEnd[0] = ppucUsedStart[0] + ptAppParams->uParameter.tPatch.ulPatchSize;
+		ppucUsedStart[1] = ptAppParams->uParameter.tPatch.pucStaging;
+		ppucUsedEnd[1] = ppucUsedStart[1] + ptAppParams->uParameter.tPatch.ulStagingSize;
+		uiUsed = 2;
+		break;
+
+	case OPERATION_MODE_FlashStream:
+		ppucUsedStart[0] = ptAppParams->uParameter.tFlashStream.pucRing;
+		ppucUsedEnd[0] = ppucUsedStart[0] + ptAppParams->uParameter.tFlashStream.ulSlots * ptAppParams->uParameter.tFlashStream.ulSlotSize;
+		ppucUsedStart[1] = (const unsigned char*)ptAppParams->uParameter.tFlashStream.ptControl;
+		ppucUsedEnd[1] = ppucUsedStart[1] + sizeof(FLASH_STREAM_CONTROL_T);
+		uiUsed = 2;
+		break;
+
+	case OPERATION_MODE_Verify:
+		ppucUsedStart[0] = ptAppParams->uParameter.tVerify.pucData;
+		ppucUsedEnd[0] = ppucUsedStart[0] + (ptAppParams->uParameter.tVerify.ulEndAdr - ptAppParams->uParameter.tVerify.ulStartAdr);
+		uiUsed = 1;
+		if( ptAppParams->uParameter.tVerify.pucReport!=NULL )
+		{
+			ppucUsedStart[1] = ptAppParams->uParameter.tVerify.pucReport;
+			ppucUsedEnd[1] = ppucUsedStart[1] + ptAppParams->uParameter.tVerify.sizReport;
+			uiUsed = 2;
+		}
+		break;
+
+#if CFG_INCLUDE_CHECKSUM!=0
+	case OPERATION_MODE_Checksum:
+		ptChecksum = &(ptAppParams->uParameter.tChecksum);
+		if( ptChecksum->ulBlockSize!=0 )
+		{
+			ulBlocks = (ptChecksum->ulEndAdr - ptChecksum->ulStartAdr + ptChecksum->ulBlockSize - 1U) / ptChecksum->ulBlockSize;
+			if( (ptChecksum->ulFlags&CHECKSUM_FLAG_Tree)!=0 )
+			{
+				ulBlocks = checksum_tree_get_nodes(ulBlocks);
+			}
+			ppucUsedStart[0] = ptChecksum->pucBlockChecksums;
+			ppucUsedEnd[0] = ppucUsedStart[0] + ulBlocks * checksum_get_size(ptChecksum->tAlgorithm);
+			uiUsed = 1;
+		}
+		break;
+#endif
+
+	default:
+		break;
+	}
+
+	return uiUsed;
+}
+
+
+/* Get the used areas of the item ulIndex. The items are the operations
+ * and the parameter blocks and results of the running batch as the last
+ * item. Returns the number of areas.
+ */
+static unsigned int get_item_areas(const tFlasherInputParameter *ptOperations, unsigned long ulOperations, unsigned long ulIndex, const unsigned char **ppucUsedStart, const unsigned char **ppucUsedEnd)
+{
+	unsigned int uiUsed;
+
+
+	uiUsed = 0;
+	if( ulIndex<ulOperations )
+	{
+		uiUsed = get_used_areas(ptOperations + ulIndex, ppucUsedStart, ppucUsedEnd);
+	}
+	else if( ptRunningBatch!=NULL )
+	{
+		ppucUsedStart[0] = (const unsigned char*)ptRunningBatch->ptEntries;
+		ppucUsedEnd[0] = (const unsigned char*)(ptRunningBatch->ptEntries + ptRunningBatch->ulEntries);
+		ppucUsedStart[1] = (const unsigned char*)ptRunningBatch->pulResults;
+		ppucUsedEnd[1] = (const unsigned char*)(ptRunningBatch->pulResults + 2U*ptRunningBatch->ulEntries);
+		uiUsed = 2;
+	}
+
+	return uiUsed;
+}
+
+
+/* Get the size of the free area at pucFreeStart. It ends at the next used
+ * area of any item or at the end of the buffer.
+ */
+static size_t get_free_size(const tFlasherInputParameter *ptOperations, unsigned long ulOperations, unsigned char *pucFreeStart)
+{
+	const unsigned char *apucUsedStart[USED_AREAS_MAX];
+	const unsigned char *apucUsedEnd[USED_AREAS_MAX];
+	unsigned int uiUsed;
+	unsigned int uiCnt;
+	unsigned long ulIndex;
+	unsigned char *pucFreeEnd;
+
+
+	pucFreeEnd = flasher_version.pucBuffer_End;
+
+	/* A used area may be outside of the buffer. */
+	if( pucFreeStart<flasher_version.pucBuffer_Data )
+	{
+		pucFreeEnd = pucFreeStart;
+	}
+
+	for(ulIndex=0; ulIndex<=ulOperations; ++ulIndex)
+	{
+		uiUsed = get_item_areas(ptOperations, ulOperations, ulIndex, apucUsedStart, apucUsedEnd);
+		for(uiCnt=0; uiCnt<uiUsed; ++uiCnt)
+		{
+			if( apucUsedStart[uiCnt]<=pucFreeStart && apucUsedEnd[uiCnt]>pucFreeStart )
+			{
+				/* The candidate is in a used area. */
+				pucFreeEnd = pucFreeStart;
+			}
+			else if( apucUsedStart[uiCnt]>pucFreeStart && apucUsedStart[uiCnt]<pucFreeEnd )
+			{
+				pucFreeEnd = (unsigned char*)apucUsedStart[uiCnt];
+			}
+		}
+	}
+
+	return (pucFreeStart<pucFreeEnd) ? (size_t)(pucFreeEnd - pucFreeStart) : 0;
+}
+
+
+/* Give the largest free part of the data buffer to the SPI routines.
+ * The areas in the data buffer which are used by the operation are left
+ * out. In a batch the areas of all entries are left out, because the data
+ * of the following entries is already in the buffer.
+ */
+static void set_spi_segment_buffer(const tFlasherInputParameter *ptAppParams)
+{
+	const tFlasherInputParameter *ptOperations;
+	unsigned long ulOperations;
+	const unsigned char *apucUsedStart[USED_AREAS_MAX];
+	const unsigned char *apucUsedEnd[USED_AREAS_MAX];
+	unsigned int uiUsed;
+	unsigned int uiCnt;
+	unsigned long ulIndex;
+	unsigned char *pucFreeStart;
+	unsigned char *pucBestStart;
+	size_t sizFree;
+	size_t sizBest;
+
+
+	if( ptRunningBatch!=NULL )
+	{
+		ptOperations = ptRunningBatch->ptEntries;
+		ulOperations = ptRunningBatch->ulEntries;
+	}
+	else
+	{
+		ptOperations = ptAppParams;
+		ulOperations = 1;
+	}
+
+	/* Find the largest gap between the used areas. A gap starts at the
+	 * start of the buffer or at the end of a used area. The start is
+	 * aligned to a DWORD.
+	 */
+	pucBestStart = (unsigned char*)((((unsigned long)flasher_version.pucBuffer_Data) + 3U) & ~3U);
+	sizBest = get_free_size(ptOperations, ulOperations, pucBestStart);
+	for(ulIndex=0; ulIndex<=ulOperations; ++ulIndex)
+	{
+		uiUsed = get_item_areas(ptOperations, ulOperations, ulIndex, apucUsedStart, apucUsedEnd);
+		for(uiCnt=0; uiCnt<uiUsed; ++uiCnt)
+		{
+			pucFreeStart = (unsigned char*)((((unsigned long)apucUsedEnd[uiCnt]) + 3U) & ~3U);
+			sizFree = get_free_size(ptOperations, ulOperations, pucFreeStart);
+			if( sizFree>sizBest )
+			{
+				pucBestStart = pucFreeStart;
+				sizBest = sizFree;
+			}
+		}
+	}
+
+	spi_set_segment_buffer(pucBestStart, sizBest);
+}
+
+
+#define FLAG_STARTADR 1
+#define FLAG_ENDADR 2
+#define FLAG_SIZE 4
+#define FLAG_BUFFERADR 8
+#define FLAG_DEVICE 16
+
+#if 1
+static NETX_CONSOLEAPP_RESULT_T check_params(NETX_CONSOLEAPP_PARAMETER_T *ptConsoleParams)
+{
+	NETX_CONSOLEAPP_RESULT_T tResult;
+	tFlasherInputParameter *ptAppParams;
+	unsigned long ulParamVersion;
+	OPERATION_MODE_T tOpMode;
+	const DEVICE_DESCRIPTION_T *ptDeviceDescription;
+	unsigned long ulStartAdr;
+	unsigned long ulEndAdr       = 0; /* avoid 'uninitialized' warning */
+	unsigned long ulDataByteSize = 0; /* dito */
+	unsigned char *pucData;
+	unsigned long ulFlashSize;
+	unsigned long ulPars;
+	
+	/*  get application parameters */
+	ptAppParams = (tFlasherInputParameter*)ptConsoleParams->pvInitParams;
+
+	/*  check parameter version */
+	ulParamVersion = ptAppParams->ulParamVersion;
+	if( ulParamVersion!=FLASHER_INTERFACE_VERSION )
+	{
+		uprintf("! unknown parameter version: %04x.%04x. Expected %04x.%04x!\n", 
+			ulParamVersion>>16, ulParamVersion&0xffff, 
+			FLASHER_INTERFACE_VERSION>>16, FLASHER_INTERFACE_VERSION&0xffff);
+		return NETX_CONSOLEAPP_RESULT_ERROR;
+	}
+	
+	/* Extract and print the parameters for each mode */
+	tOpMode = ptAppParams->tOperationMode;
+	switch( tOpMode )
+	{
+	case OPERATION_MODE_Detect:
+		ulPars = 0;
+		uprintf(". Mode: Detect\n");
+		break;
+
+	case OPERATION_MODE_Flash:
+		ulPars = FLAG_STARTADR + FLAG_SIZE + FLAG_BUFFERADR + FLAG_DEVICE;
+		ulStartAdr          = ptAppParams->uParameter.tFlash.ulStartAdr;
+		ulDataByteSize      = ptAppParams->uParameter.tFlash.ulDataByteSize;
+		pucData             = ptAppParams->uParameter.tFlash.pucData;
+		ptDeviceDescription = ptAppParams->uParameter.tFlash.ptDeviceDescription;
+		uprintf(". Mode: Write to flash\n");
+		uprintf(". Start offset in flash: 0x%08x\n", ulStartAdr);
+		uprintf(". Data size:             0x%08x\n", ulDataByteSize);
+		uprintf(". Buffer address:        0x%08x\n", pucData);
+		if( ptAppParams->uParameter.tFlash.ulCompressedSize!=0 )
+		{
+			uprintf(". Compressed data:       0x%08x bytes at 0x%08x\n", ptAppParams->uParameter.tFlash.ulCompressedSize, ptAppParams->uParameter.tFlash.pucCompressed);
+		}
+		break;
+
+	case OPERATION_MODE_Erase:
+		ulPars = FLAG_STARTADR + FLAG_ENDADR + FLAG_DEVICE;
+		ulStartAdr          = ptAppParams->uParameter.tErase.ulStartAdr;
+		ulEndAdr            = ptAppParams->uParameter.tErase.ulEndAdr;
+		ptDeviceDescription = ptAppParams->uParameter.tErase.ptDeviceDescription;
+		uprintf(". Mode: Erase\n");
+		uprintf(". Flash offset [0x%08x, 0x%08x[\n", ulStartAdr, ulEndAdr);
+		break;
+
+	case OPERATION_MODE_Read:
+		ulPars = FLAG_STARTADR + FLAG_ENDADR + FLAG_BUFFERADR + FLAG_DEVICE;
+		ulStartAdr          = ptAppParams->uParameter.tRead.ulStartAdr;
+		ulEndAdr            = ptAppParams->uParameter.tRead.ulEndAdr;
+		pucData             = ptAppParams->uParameter.tRead.pucData;
+		ptDeviceDescription = ptAppParams->uParameter.tRead.ptDeviceDescription;
+		uprintf(". Mode: Read\n");
+		uprintf(". Flash offset [0x%08x, 0x%08x[\n", ulStartAdr, ulEndAdr);
+		uprintf(". Buffer address: 0x%08x\n", pucData);
+		if( ptAppParams->uParameter.tRead.ulCompressedMax!=0 )
+		{
+			uprintf(". Compressed buffer: 0x%08x bytes at 0x%08x\n", ptAppParams->uParameter.tRead.ulCompressedMax, ptAppParams->uParameter.tRead.pucCompressed);
+		}
+		break;
+		
+	case OPERATION_MODE_Verify:
+		ulPars = FLAG_STARTADR + FLAG_ENDADR + FLAG_BUFFERADR + FLAG_DEVICE;
+		ulStartAdr          = ptAppParams->uParameter.tVerify.ulStartAdr;
+		ulEndAdr            = ptAppParams->uParameter.tVerify.ulEndAdr;
+		pucData             = ptAppParams->uParameter.tVerify.pucData;
+		ptDeviceDescription = ptAppParams->uParameter.tVerify.ptDeviceDescription;
+		uprintf(". Mode: Verify\n");
+		uprintf(". Flash offset [0x%08x, 0x%08x[\n", ulStartAdr, ulEndAdr);
+		uprintf(". Buffer address: 0x%08x\n", pucData);
+		if( ptAppParams->uParameter.tVerify.pucReport!=NULL )
+		{
+			uprintf(". Report buffer: 0x%08x, 0x%08x bytes\n", ptAppParams->uParameter.tVerify.pucReport, ptAppParams->uParameter.tVerify.sizReport);
+		}
+		break;
+		
+	case OPERATION_MODE_Checksum:
+		ulPars = FLAG_STARTADR + FLAG_ENDADR + FLAG_DEVICE;
+		ulStartAdr          = ptAppParams->uParameter.tChecksum.ulStartAdr;
+		ulEndAdr            = ptAppParams->uParameter.tChecksum.ulEndAdr;
+		ptDeviceDescription = ptAppParams->uParameter.tChecksum.ptDeviceDescription;
+		uprintf(". Mode: Checksum (algorithm %d)\n", ptAppParams->uParameter.tChecksum.tAlgorithm);
+		uprintf(". Flash offset [0x%08x, 0x%08x[\n", ulStartAdr, ulEndAdr);
+		if( ptAppParams->uParameter.tChecksum.ulBlockSize!=0 )
+		{
+			uprintf(". Block size: 0x%08x\n", ptAppParams->uParameter.tChecksum.ulBlockSize);
+			uprintf(". Block checksums: 0x%08x\n", ptAppParams->uParameter.tChecksum.pucBlockChecksums);
+		}
+		if( (ptAppParams->uParameter.tChecksum.ulFlags&CHECKSUM_FLAG_Tree)!=0 )
+		{
+			uprintf(". Hash tree\n");
+			if( ptAppParams->uParameter.tChecksum.ulBlockSize==0 )
+			{
+				uprintf("! The hash tree needs a block size.\n");
+				return NETX_CONSOLEAPP_RESULT_ERROR;
+			}
+		}
+		break;
+		
+	case OPERATION_MODE_IsErased:
+		ulPars = FLAG_STARTADR + FLAG_ENDADR + FLAG_DEVICE;
+		ulStartAdr          = ptAppParams->uParameter.tIsErased.ulStartAdr;
+		ulEndAdr            = ptAppParams->uParameter.tIsErased.ulEndAdr;
+		ptDeviceDescription = ptAppParams->uParameter.tIsErased.ptDeviceDescription;
+		uprintf(". Mode: IsErased\n");
+		uprintf(". Flash offset [0x%08x, 0x%08x[\n", ulStartAdr, ulEndAdr);
+		break;
+
+	case OPERATION_MODE_GetEraseArea:
+		ulPars = FLAG_STARTADR + FLAG_ENDADR + FLAG_DEVICE;
+		ulStartAdr          = ptAppParams->uParameter.tGetEraseArea.ulStartAdr;
+		ulEndAdr            = ptAppParams->uParameter.tGetEraseArea.ulEndAdr;
+		ptDeviceDescription = ptAppParams->uParameter.tGetEraseArea.ptDeviceDescription;
+		uprintf(". Mode: Get Erase Area\n");
+		uprintf(". Flash offset [0x%08x, 0x%08x[\n", ulStartAdr, ulEndAdr);
+		break;
+
+	case OPERATION_MODE_GetBoardInfo:
+		ulPars = 0;
+		uprintf(".Mode: Get Board Info\n");
+		break;
+
+	case OPERATION_MODE_EasyErase:
+		ulPars = FLAG_STARTADR + FLAG_ENDADR + FLAG_DEVICE;
+		ulStartAdr          = ptAppParams->uParameter.tGetEraseArea.ulStartAdr;
+		ulEndAdr            = ptAppParams->uParameter.tGetEraseArea.ulEndAdr;
+		ptDeviceDescription = ptAppParams->uParameter.tGetEraseArea.ptDeviceDescription;
+		uprintf(". Mode: Get Erase Area\n");
+		uprintf(". Flash offset [0x%08x, 0x%08x[\n", ulStartAdr, ulEndAdr);
+		break;
+
+	case OPERATION_MODE_SpiMacroPlayer:
+		ulPars = 0;
+		/* NOTE: do not print the mode here or the user will get insane for big macros. */
+		break;
+
+	case OPERATION_MODE_Batch:
+		ulPars = 0;
+		uprintf(". Mode: Batch\n");
+		uprintf(". Entries: %d at 0x%08x\n", ptAppParams->uParameter.tBatch.ulEntries, ptAppParams->uParameter.tBatch.ptEntries);
+		uprintf(". Results: 0x%08x\n", ptAppParams->uParameter.tBatch.pulResults);
+		break;
+
+	case OPERATION_MODE_EraseFlashVerify:
+		ulPars = FLAG_STARTADR + FLAG_SIZE + FLAG_BUFFERADR + FLAG_DEVICE;
+		ulStartAdr          = ptAppParams->uParameter.tEraseFlashVerify.ulStartAdr;
+		ulDataByteSize      = ptAppParams->uParameter.tEraseFlashVerify.ulDataByteSize;
+		pucData             = ptAppParams->uParameter.tEraseFlashVerify.pucData;
+		ptDeviceDescription = ptAppParams->uParameter.tEraseFlashVerify.ptDeviceDescription;
+		uprintf(". Mode: Erase, flash and verify\n");
+		uprintf(". Start offset in flash: 0x%08x\n", ulStartAdr);
+		uprintf(". Data size:             0x%08x\n", ulDataByteSize);
+		uprintf(". Buffer address:        0x%08x\n", pucData);
+		uprintf(". Erase area [0x%08x, 0x%08x[\n", ptAppParams->uParameter.tEraseFlashVerify.ulEraseStartAdr, ptAppParams->uParameter.tEraseFlashVerify.ulEraseEndAdr);
+		if( ptAppParams->uParameter.tEraseFlashVerify.ulCompressedSize!=0 )
+		{
+			uprintf(". Compressed data:       0x%08x bytes at 0x%08x\n", ptAppParams->uParameter.tEraseFlashVerify.ulCompressedSize, ptAppParams->uParameter.tEraseFlashVerify.pucCompressed);
+		}
+		if( (ptAppParams->uParameter.tEraseFlashVerify.ulFlags&ERASEFLASHVERIFY_FLAG_Sparse)!=0 )
+		{
+			uprintf(". Extent list:           0x%08x bytes at 0x%08x\n", ptAppParams->uParameter.tEraseFlashVerify.ulExtentsSize, ptAppParams->uParameter.tEraseFlashVerify.pucExtents);
+		}
+		break;
+
+	case OPERATION_MODE_GetEraseMap:
+		ulPars = FLAG_STARTADR + FLAG_ENDADR + FLAG_BUFFERADR + FLAG_DEVICE;
+		ulStartAdr          = ptAppParams->uParameter.tGetEraseMap.ulStartAdr;
+		ulEndAdr            = ptAppParams->uParameter.tGetEraseMap.ulEndAdr;
+		pucData             = ptAppParams->uParameter.tGetEraseMap.pucBitmap;
+		ptDeviceDescription = ptAppParams->uParameter.tGetEraseMap.ptDeviceDescription;
+		uprintf(". Mode: Get erase map\n");
+		uprintf(". Flash offset [0x%08x, 0x%08x[\n", ulStartAdr, ulEndAdr);
+		uprintf(". Bitmap: 0x%08x bytes at 0x%08x\n", ptAppParams->uParameter.tGetEraseMap.ulBitmapSize, pucData);
+		break;
+
+	case OPERATION_MODE_Patch:
+		ulPars = FLAG_STARTADR + FLAG_SIZE + FLAG_BUFFERADR + FLAG_DEVICE;
+		ulStartAdr          = ptAppParams->uParameter.tPatch.ulStartAdr;
+		ulDataByteSize      = ptAppParams->uParameter.tPatch.ulDataByteSize;
+		pucData             = ptAppParams->uParameter.tPatch.pucStaging;
+		ptDeviceDescription = ptAppParams->uParameter.tPatch.ptDeviceDescription;
+		uprintf(". Mode: Patch\n");
+		uprintf(". Start offset in flash: 0x%08x\n", ulStartAdr);
+		uprintf(". Data size:             0x%08x\n", ulDataByteSize);
+		uprintf(". Delta:                 0x%08x bytes at 0x%08x\n", ptAppParams->uParameter.tPatch.ulPatchSize, ptAppParams->uParameter.tPatch.pucPatch);
+		uprintf(". Staging buffer:        0x%08x bytes at 0x%08x\n", ptAppParams->uParameter.tPatch.ulStagingSize, pucData);
+		break;
+
+	case OPERATION_MODE_Fill:
+		ulPars = FLAG_STARTADR + FLAG_SIZE + FLAG_BUFFERADR + FLAG_DEVICE;
+		ulStartAdr          = ptAppParams->uParameter.tFill.ulStartAdr;
+		ulDataByteSize      = ptAppParams->uParameter.tFill.ulDataByteSize;
+		pucData             = ptAppParams->uParameter.tFill.pucBuffer;
+		ptDeviceDescription = ptAppParams->uParameter.tFill.ptDeviceDescription;
+		uprintf(". Mode: Fill\n");
+		uprintf(". Start offset in flash: 0x%08x\n", ulStartAdr);
+		uprintf(". Data size:             0x%08x\n", ulDataByteSize);
+		uprintf(". Buffer:                0x%08x bytes at 0x%08x\n", ptAppParams->uParameter.tFill.ulBufferSize, pucData);
+		uprintf(". Pattern size:          %d\n", ptAppParams->uParameter.tFill.ulPatternSize);
+		if( ptAppParams->uParameter.tFill.ulPatternSize==0 || ptAppParams->uParameter.tFill.ulPatternSize>FILL_PATTERN_MAX )
+		{
+			uprintf("! The pattern size must be between 1 and %d.\n", FILL_PATTERN_MAX);
+			return NETX_CONSOLEAPP_RESULT_ERROR;
+		}
+		break;
+
+	case OPERATION_MODE_Copy:
+		ulPars = FLAG_STARTADR + FLAG_SIZE + FLAG_BUFFERADR + FLAG_DEVICE;
+		ulStartAdr          = ptAppParams->uParameter.tCopy.ulDstAdr;
+		ulDataByteSize      = ptAppParams->uParameter.tCopy.ulDataByteSize;
+		pucData             = ptAppParams->uParameter.tCopy.pucBuffer;
+		ptDeviceDescription = ptAppParams->uParameter.tCopy.ptDeviceDescription;
+		uprintf(". Mode: Copy\n");
+		uprintf(". Source offset:         0x%08x\n", ptAppParams->uParameter.tCopy.ulSrcAdr);
+		uprintf(". Destination offset:    0x%08x\n", ulStartAdr);
+		uprintf(". Data size:             0x%08x\n", ulDataByteSize);
+		uprintf(". Buffer:                0x%08x bytes at 0x%08x\n", ptAppParams->uParameter.tCopy.ulBufferSize, pucData);
+		uprintf(". Flags:                 0x%08x\n", ptAppParams->uParameter.tCopy.ulFlags);
+
+		/* The source device is checked here, the destination below. */
+		if( ptAppParams->uParameter.tCopy.ptSrcDeviceDescription!=NULL )
+		{
+			ptDeviceDescription = ptAppParams->uParameter.tCopy.ptSrcDeviceDescription;
+		}
+		tResult = check_device_description(ptDeviceDescription);
+		if( tResult!=NETX_CONSOLEAPP_RESULT_OK )
+		{
+			return tResult;
+		}
+		ulFlashSize = getFlashSize(ptDeviceDescription);
+		ptDeviceDescription = ptAppParams->uParameter.tCopy.ptDeviceDescription;
+		if( ptAppParams->uParameter.tCopy.ulSrcAdr>ulFlashSize || ulDataByteSize>(ulFlashSize - ptAppParams->uParameter.tCopy.ulSrcAdr) )
+		{
+			uprintf("! The source area exceeds the flash size.\n");
+			return NETX_CONSOLEAPP_RESULT_ERROR;
+		}
+		break;
+
+	case OPERATION_MODE_FlashStream:
+		ulPars = FLAG_STARTADR + FLAG_SIZE + FLAG_BUFFERADR + FLAG_DEVICE;
+		ulStartAdr          = ptAppParams->uParameter.tFlashStream.ulStartAdr;
+		ulDataByteSize      = ptAppParams->uParameter.tFlashStream.ulDataByteSize;
+		pucData             = ptAppParams->uParameter.tFlashStream.pucRing;
+		ptDeviceDescription = ptAppParams->uParameter.tFlashStream.ptDeviceDescription;
+		uprintf(". Mode: Flash stream\n");
+		uprintf(". Start offset in flash: 0x%08x\n", ulStartAdr);
+		uprintf(". Data size:             0x%08x\n", ulDataByteSize);
+		uprintf(". Ring buffer:           0x%08x, %d slots of 0x%08x bytes\n", pucData, ptAppParams->uParameter.tFlashStream.ulSlots, ptAppParams->uParameter.tFlashStream.ulSlotSize);
+		if( ptAppParams->uParameter.tFlashStream.ulSlots==0 || ptAppParams->uParameter.tFlashStream.ulSlotSize==0 )
+		{
+			uprintf("! The ring buffer has no slots.\n");
+			return NETX_CONSOLEAPP_RESULT_ERROR;
+		}
+		break;
+
+	default:
+		ulPars = 0;
+		uprintf("! unknown operation mode: %d\n", tOpMode);
+		return NETX_CONSOLEAPP_RESULT_ERROR;
+		break;
+	}
+	
+	/* If the mode requires a device description, check if it is correct
+		and if the offsets are within the size */
+	if (ulPars & FLAG_DEVICE)
+	{
+		tResult = check_device_description(ptDeviceDescription);
+		if (tResult != NETX_CONSOLEAPP_RESULT_OK)
+		{
+			return tResult;
+		}
+		else
+		{
+			ulFlashSize = getFlashSize(ptDeviceDescription);
+			uprintf(". Flash size: 0x%08x\n", ulFlashSize);
+			
+			if ((ulPars & FLAG_STARTADR) && ulStartAdr >= ulFlashSize)
+			{
+				uprintf("! Start offset exceeds flash size.\n");
+				return NETX_CONSOLEAPP_RESULT_ERROR;
+			}
+			
+			if ((ulPars & FLAG_ENDADR) && ulEndAdr > ulFlashSize
+				&& ( tOpMode != OPERATION_MODE_GetEraseArea && ulEndAdr != 0xffffffffU))
+			{
+				uprintf("! End offset exceeds flash size.\n");
+				return NETX_CONSOLEAPP_RESULT_ERROR;
+			}
+			
+			if ((ulPars & FLAG_SIZE) && ulDataByteSize > ulFlashSize)
+			{
+				uprintf("! Data size exceeds flash size.\n");
+				return NETX_CONSOLEAPP_RESULT_ERROR;
+			}
+		}
 	}
 	
 	if ((ulPars & FLAG_STARTADR) && (ulPars & FLAG_ENDADR) && (ulStartAdr > ulEndAdr))
@@ -1017,10 +2639,10 @@ static NETX_CONSOLEAPP_RESULT_T check_params(NETX_CONSOLEAPP_PARAMETER_T *ptCons
 		ptDeviceDescription = ptAppParams->uParameter.tVerify.ptDeviceDescription;
 		break;
 		
-#if CFG_INCLUDE_SHA1!=0
+#if CFG_INCLUDE_CHECKSUM!=0
 	case OPERATION_MODE_Checksum:
 		ulPars = FLAG_STARTADR + FLAG_ENDADR + FLAG_DEVICE;
-		pszMode = "Calculate SHA1 checksum";
+		pszMode = "Calculate checksum";
 		ulStartAdr          = ptAppParams->uParameter.tChecksum.ulStartAdr;
 		ulEndAdr            = ptAppParams->uParameter.tChecksum.ulEndAdr;
 		ptDeviceDescription = ptAppParams->uParameter.tChecksum.ptDeviceDescription;
@@ -1119,6 +2741,181 @@ static NETX_CONSOLEAPP_RESULT_T check_params(NETX_CONSOLEAPP_PARAMETER_T *ptCons
 
 #endif
 
+/* ------------------------------------- */
+
+
+static NETX_CONSOLEAPP_RESULT_T opMode_batch(tFlasherInputParameter *ptAppParams, NETX_CONSOLEAPP_PARAMETER_T *ptConsoleParams);
+
+/* Check the parameters and run one operation. */
+static NETX_CONSOLEAPP_RESULT_T execute_operation(NETX_CONSOLEAPP_PARAMETER_T *ptConsoleParams)
+{
+	NETX_CONSOLEAPP_RESULT_T tResult;
+	tFlasherInputParameter *ptAppParams;
+
+
+	ptAppParams = (tFlasherInputParameter*)ptConsoleParams->pvInitParams;
+
+	tResult = check_params(ptConsoleParams);
+	if (tResult == NETX_CONSOLEAPP_RESULT_OK)
+	{
+		set_spi_segment_buffer(ptAppParams);
+
+		/*  run operation */
+		switch( ptAppParams->tOperationMode )
+		{
+		case OPERATION_MODE_Detect:
+			tResult = opMode_detect(ptAppParams);
+			break;
+
+		case OPERATION_MODE_Flash:
+			tResult = opMode_flash(ptAppParams);
+			break;
+
+		case OPERATION_MODE_Erase:
+			tResult = opMode_erase(ptAppParams, ptConsoleParams);
+			break;
+
+		case OPERATION_MODE_Read:
+			tResult = opMode_read(ptAppParams);
+			break;
+
+		case OPERATION_MODE_Verify:
+			tResult = opMode_verify(ptAppParams, ptConsoleParams);
+			break;
+
+		case OPERATION_MODE_Checksum:
+#if CFG_INCLUDE_CHECKSUM!=0
+			tResult = opMode_checksum(ptAppParams);
+#else
+			uprintf("Error: the checksum command is not supported by this build.\n");
+			tResult = NETX_CONSOLEAPP_RESULT_ERROR;
+#endif
+			break;
+
+		case OPERATION_MODE_IsErased:
+			tResult = opMode_isErased(ptAppParams, ptConsoleParams);
+			break;
+
+		case OPERATION_MODE_GetEraseArea:
+			tResult = opMode_getEraseArea(ptAppParams);
+			break;
+
+		case OPERATION_MODE_GetBoardInfo:
+			tResult = opMode_getBoardInfo(ptAppParams, ptConsoleParams);
+			break;
+
+		case OPERATION_MODE_EasyErase:
+			tResult = opMode_easyErase(ptAppParams, ptConsoleParams);
+			break;
+
+		case OPERATION_MODE_SpiMacroPlayer:
+			tResult = opMode_spiMacroPlayer(ptAppParams, ptConsoleParams);
+			break;
+
+		case OPERATION_MODE_EraseFlashVerify:
+			tResult = opMode_eraseFlashVerify(ptAppParams, ptConsoleParams);
+			break;
+
+		case OPERATION_MODE_Batch:
+			tResult = opMode_batch(ptAppParams, ptConsoleParams);
+			break;
+
+		case OPERATION_MODE_FlashStream:
+			tResult = opMode_flashStream(ptAppParams, ptConsoleParams);
+			break;
+
+		case OPERATION_MODE_GetEraseMap:
+			tResult = opMode_getEraseMap(ptAppParams, ptConsoleParams);
+			break;
+
+		case OPERATION_MODE_Patch:
+			tResult = opMode_patch(ptAppParams, ptConsoleParams);
+			break;
+
+		case OPERATION_MODE_Fill:
+			tResult = opMode_fill(ptAppParams, ptConsoleParams);
+			break;
+
+		case OPERATION_MODE_Copy:
+			tResult = opMode_copy(ptAppParams, ptConsoleParams);
+			break;
+		}
+	}
+
+	return tResult;
+}
+
+
+static NETX_CONSOLEAPP_RESULT_T opMode_batch(tFlasherInputParameter *ptAppParams, NETX_CONSOLEAPP_PARAMETER_T *ptConsoleParams)
+{
+	NETX_CONSOLEAPP_RESULT_T tResult;
+	NETX_CONSOLEAPP_RESULT_T tEntryResult;
+	CMD_PARAMETER_BATCH_T *ptParameter;
+	NETX_CONSOLEAPP_PARAMETER_T tEntryParams;
+	tFlasherInputParameter *ptEntry;
+	unsigned long *pulResult;
+	unsigned long ulCnt;
+	unsigned long ulExecuted;
+
+
+	/* Get a shortcut to the parameters. */
+	ptParameter = &(ptAppParams->uParameter.tBatch);
+
+	/* Mark all entries as not executed. */
+	pulResult = ptParameter->pulResults;
+	for(ulCnt=0; ulCnt<2U*ptParameter->ulEntries; ++ulCnt)
+	{
+		pulResult[ulCnt] = BATCH_RESULT_NotExecuted;
+	}
+
+	/* Keep the data of all entries and the results out of the segment buffer. */
+	ptRunningBatch = ptParameter;
+
+	tResult = NETX_CONSOLEAPP_RESULT_OK;
+	ulExecuted = 0;
+	for(ulCnt=0; ulCnt<ptParameter->ulEntries; ++ulCnt)
+	{
+		ptEntry = ptParameter->ptEntries + ulCnt;
+		uprintf("# Batch entry %d of %d\n", ulCnt + 1U, ptParameter->ulEntries);
+
+		tEntryParams.ulReturnValue = 0;
+		tEntryParams.pvInitParams = (void*)ptEntry;
+		tEntryParams.pvReturnMessage = (void*)0;
+
+		if( ptEntry->tOperationMode==OPERATION_MODE_Batch )
+		{
+			uprintf("! A batch can not contain another batch.\n");
+			tEntryResult = NETX_CONSOLEAPP_RESULT_ERROR;
+		}
+		else
+		{
+			tEntryResult = execute_operation(&tEntryParams);
+		}
+		++ulExecuted;
+
+		pulResult[2U*ulCnt]      = (unsigned long)tEntryResult;
+		pulResult[2U*ulCnt + 1U] = (unsigned long)tEntryParams.pvReturnMessage;
+
+		if( tEntryResult!=NETX_CONSOLEAPP_RESULT_OK )
+		{
+			tResult = NETX_CONSOLEAPP_RESULT_ERROR;
+			if( (ptParameter->ulFlags&BATCH_FLAG_ContinueOnError)==0 )
+			{
+				uprintf("! Batch entry %d failed, stopping.\n", ulCnt + 1U);
+				break;
+			}
+		}
+	}
+
+	ptRunningBatch = NULL;
+
+	/* Return the number of executed entries. */
+	ptConsoleParams->pvReturnMessage = (void*)ulExecuted;
+
+	return tResult;
+}
+
+
 NETX_CONSOLEAPP_RESULT_T netx_consoleapp_main(NETX_CONSOLEAPP_PARAMETER_T *ptTestParam)
 {
 	NETX_CONSOLEAPP_RESULT_T tResult;
@@ -1159,62 +2956,7 @@ NETX_CONSOLEAPP_RESULT_T netx_consoleapp_main(NETX_CONSOLEAPP_PARAMETER_T *ptTes
 			uprintf(". Init parameter:  0x%08x\n", (unsigned long)ptTestParam->pvInitParams);
 			uprintf("\n");
 		}
-		tResult = check_params(ptTestParam);
-		if (tResult == NETX_CONSOLEAPP_RESULT_OK)
-		{
-			/*  run operation */
-			switch( tOpMode )
-			{
-			case OPERATION_MODE_Detect:
-				tResult = opMode_detect(ptAppParams);
-				break;
-
-			case OPERATION_MODE_Flash:
-				tResult = opMode_flash(ptAppParams);
-				break;
-
-			case OPERATION_MODE_Erase:
-				tResult = opMode_erase(ptAppParams);
-				break;
-
-			case OPERATION_MODE_Read:
-				tResult = opMode_read(ptAppParams);
-				break;
-				
-			case OPERATION_MODE_Verify:
-				tResult = opMode_verify(ptAppParams, ptTestParam);
-				break;
-				
-			case OPERATION_MODE_Checksum:
-#if CFG_INCLUDE_SHA1!=0
-				tResult = opMode_checksum(ptAppParams);
-#else
-				uprintf("Error: the checksum command is not supported by this build.\n");
-				tResult = NETX_CONSOLEAPP_RESULT_ERROR;
-#endif
-				break;
-				
-			case OPERATION_MODE_IsErased:
-				tResult = opMode_isErased(ptAppParams, ptTestParam);
-				break;
-
-			case OPERATION_MODE_GetEraseArea:
-				tResult = opMode_getEraseArea(ptAppParams);
-				break;
-
-			case OPERATION_MODE_GetBoardInfo:
-				tResult = opMode_getBoardInfo(ptAppParams, ptTestParam);
-				break;
-
-			case OPERATION_MODE_EasyErase:
-				tResult = opMode_easyErase(ptAppParams, ptTestParam);
-				break;
-
-			case OPERATION_MODE_SpiMacroPlayer:
-				tResult = opMode_spiMacroPlayer(ptAppParams, ptTestParam);
-				break;
-			}
-		}
+		tResult = execute_operation(ptTestParam);
 	}
 
 	if( tResult==NETX_CONSOLEAPP_RESULT_OK )
@@ -0,0 +1,327 @@
+/***************************************************************************
+ *   Copyright (C) 2019 by Hilscher GmbH                                   *
+ *   cthelen@hilscher.com                                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program. If not, see                          *
+ *   <https://www.gnu.org/licenses/>.                                      *
+ ***************************************************************************/
+
+#include "mem_check.h"
+
+
+/*
+ * These are the compare and blank check loops for the verify and isErased
+ * operations of all buses.
+ *
+ * The inner loops work on aligned 32 bit words and process 4 words per
+ * iteration. The result of all 4 words is combined before the branch, so
+ * the loop has only one conditional jump per 16 bytes. If a block contains
+ * a difference, the exact position is searched byte by byte in this block.
+ * The unaligned head and the tail are checked byte by byte.
+ */
+
+
+typedef union
+{
+	const unsigned char *puc;
+	const unsigned long *pul;
+	unsigned long ul;
+} MEM_CHECK_ADR_T;
+
+
+#define MEM_CHECK_WORD_SIZE sizeof(unsigned long)
+#define MEM_CHECK_WORD_MASK (MEM_CHECK_WORD_SIZE-1U)
+#define MEM_CHECK_BLOCK_SIZE (4U*MEM_CHECK_WORD_SIZE)
+
+
+/*! Find the first difference in 2 memory areas.
+ *
+ * \param pucA       Pointer to the first area.
+ * \param pucB       Pointer to the second area.
+ * \param sizLength  Number of bytes to compare.
+ * \return The offset of the first byte which differs. This is sizLength if both areas are equal.
+ */
+size_t mem_check_first_difference(const unsigned char *pucA, const unsigned char *pucB, size_t sizLength)
+{
+	MEM_CHECK_ADR_T tA;
+	MEM_CHECK_ADR_T tB;
+	const unsigned char *pucEnd;
+	const unsigned char *pucBlockEnd;
+	unsigned long ulDiff;
+
+
+	tA.puc = pucA;
+	tB.puc = pucB;
+	pucEnd = pucA + sizLength;
+
+	/* The word loop is only possible if both areas have the same alignment. */
+	if( ((tA.ul^tB.ul)&MEM_CHECK_WORD_MASK)==0 )
+	{
+		/* Compare the unaligned head byte by byte. */
+		while( tA.puc<pucEnd && (tA.ul&MEM_CHECK_WORD_MASK)!=0 )
+		{
+			if( *tA.puc!=*tB.puc )
+			{
+				return (size_t)(tA.puc - pucA);
+			}
+			++tA.puc;
+			++tB.puc;
+		}
+
+		/* Compare complete blocks of 4 words. */
+		pucBlockEnd = tA.puc + (((size_t)(pucEnd - tA.puc)) & ~(MEM_CHECK_BLOCK_SIZE-1U));
+		while( tA.puc<pucBlockEnd )
+		{
+			ulDiff  = tA.pul[0] ^ tB.pul[0];
+			ulDiff |= tA.pul[1] ^ tB.pul[1];
+			ulDiff |= tA.pul[2] ^ tB.pul[2];
+			ulDiff |= tA.pul[3] ^ tB.pul[3];
+			if( ulDiff!=0 )
+			{
+				/* Search the difference in this block below. */
+				pucEnd = tA.puc + MEM_CHECK_BLOCK_SIZE;
+				break;
+			}
+			tA.puc += MEM_CHECK_BLOCK_SIZE;
+			tB.puc += MEM_CHECK_BLOCK_SIZE;
+		}
+	}
+
+	/* Compare the tail or the block with the difference byte by byte. */
+	while( tA.puc<pucEnd )
+	{
+		if( *tA.puc!=*tB.puc )
+		{
+			break;
+		}
+		++tA.puc;
+		++tB.puc;
+	}
+
+	return (size_t)(tA.puc - pucA);
+}
+
+
+
+/*! Compare 2 memory areas.
+ *
+ * \param pucA       Pointer to the first area.
+ * \param pucB       Pointer to the second area.
+ * \param sizLength  Number of bytes to compare.
+ * \return 1 if both areas are equal, 0 if not.
+ */
+int mem_check_is_equal(const unsigned char *pucA, const unsigned char *pucB, size_t sizLength)
+{
+	return (mem_check_first_difference(pucA, pucB, sizLength)==sizLength) ? 1 : 0;
+}
+
+
+
+/*! Find the first byte in a memory area which is not equal to a pattern.
+ *
+ * \param pucData    Pointer to the area.
+ * \param sizLength  Number of bytes to check.
+ * \param ucPattern  The expected value of all bytes.
+ * \return The offset of the first byte which is not equal to the pattern. This is sizLength if all bytes match.
+ */
+size_t mem_check_first_not_pattern(const unsigned char *pucData, size_t sizLength, unsigned char ucPattern)
+{
+	MEM_CHECK_ADR_T tCnt;
+	const unsigned char *pucEnd;
+	const unsigned char *pucBlockEnd;
+	unsigned long ulPattern;
+	unsigned long ulDiff;
+
+
+	tCnt.puc = pucData;
+	pucEnd = pucData + sizLength;
+
+	/* Check the unaligned head byte by byte. */
+	while( tCnt.puc<pucEnd && (tCnt.ul&MEM_CHECK_WORD_MASK)!=0 )
+	{
+		if( *tCnt.puc!=ucPattern )
+		{
+			return (size_t)(tCnt.puc - pucData);
+		}
+		++tCnt.puc;
+	}
+
+	/* Repeat the pattern in all bytes of a word. */
+	ulPattern = (~0UL / 0xffU) * ucPattern;
+
+	/* Check complete blocks of 4 words. */
+	pucBlockEnd = tCnt.puc + (((size_t)(pucEnd - tCnt.puc)) & ~(MEM_CHECK_BLOCK_SIZE-1U));
+	while( tCnt.puc<pucBlockEnd )
+	{
+		ulDiff  = tCnt.pul[0] ^ ulPattern;
+		ulDiff |= tCnt.pul[1] ^ ulPattern;
+		ulDiff |= tCnt.pul[2] ^ ulPattern;
+		ulDiff |= tCnt.pul[3] ^ ulPattern;
+		if( ulDiff!=0 )
+		{
+			/* Search the difference in this block below. */
+			pucEnd = tCnt.puc + MEM_CHECK_BLOCK_SIZE;
+			break;
+		}
+		tCnt.puc += MEM_CHECK_BLOCK_SIZE;
+	}
+
+	/* Check the tail or the block with the difference byte by byte. */
+	while( tCnt.puc<pucEnd )
+	{
+		if( *tCnt.puc!=ucPattern )
+		{
+			break;
+		}
+		++tCnt.puc;
+	}
+
+	return (size_t)(tCnt.puc - pucData);
+}
+
+
+
+/*! Check if all bytes in a memory area are equal to a pattern.
+ *
+ * \param pucData    Pointer to the area.
+ * \param sizLength  Number of bytes to check.
+ * \param ucPattern  The expected value of all bytes.
+ * \return 1 if all bytes match the pattern, 0 if not.
+ */
+int mem_check_is_pattern(const unsigned char *pucData, size_t sizLength, unsigned char ucPattern)
+{
+	return (mem_check_first_not_pattern(pucData, sizLength, ucPattern)==sizLength) ? 1 : 0;
+}
+
+
+
+/*! Initialize a verify report.
+ *
+ * \param ptReport   The report.
+ * \param pucBuffer  Pointer to the report buffer. It must be aligned to 4 bytes.
+ * \param sizBuffer  Size of the report buffer in bytes.
+ * \return 0 on success, -1 if the buffer is not aligned or too small for one range.
+ */
+int mem_check_report_init(MEM_CHECK_REPORT_T *ptReport, unsigned char *pucBuffer, size_t sizBuffer)
+{
+	int iResult;
+	size_t sizMaxRanges;
+
+
+	iResult = -1;
+
+	sizMaxRanges = 0;
+	if( sizBuffer>=sizeof(unsigned long) )
+	{
+		sizMaxRanges = (sizBuffer - sizeof(unsigned long)) / (2U*sizeof(unsigned long));
+	}
+
+	if( (((unsigned long)pucBuffer)&MEM_CHECK_WORD_MASK)==0 && sizMaxRanges!=0 )
+	{
+		ptReport->pulBuffer = (unsigned long*)pucBuffer;
+		ptReport->sizMaxRanges = sizMaxRanges;
+		ptReport->sizRanges = 0;
+
+		/* The report is not valid until it is finalized. */
+		ptReport->pulBuffer[0] = MEM_CHECK_REPORT_INVALID;
+
+		iResult = 0;
+	}
+
+	return iResult;
+}
+
+
+
+/*! Add a range to the verify report.
+ *
+ * A range which starts at the end of the last one is merged with it.
+ *
+ * \param ptReport  The report.
+ * \param ulStart   Start offset of the range.
+ * \param ulEnd     End offset of the range (offset of the last byte + 1).
+ */
+void mem_check_report_add(MEM_CHECK_REPORT_T *ptReport, unsigned long ulStart, unsigned long ulEnd)
+{
+	unsigned long *pulRange;
+
+
+	pulRange = ptReport->pulBuffer + 1U + 2U*ptReport->sizRanges;
+	if( ptReport->sizRanges!=0 && (pulRange[-1]==ulStart || ptReport->sizRanges==ptReport->sizMaxRanges) )
+	{
+		/* Extend the last range. */
+		pulRange[-1] = ulEnd;
+	}
+	else
+	{
+		pulRange[0] = ulStart;
+		pulRange[1] = ulEnd;
+		++ptReport->sizRanges;
+	}
+}
+
+
+
+/*! Add all differences of 2 memory areas to the verify report.
+ *
+ * \param ptReport   The report.
+ * \param ulOffset   The offset of the areas in the device. This is the base for the ranges in the report.
+ * \param pucA       Pointer to the first area.
+ * \param pucB       Pointer to the second area.
+ * \param sizLength  Number of bytes to compare.
+ * \return 0 if both areas are equal, 1 if differences were found.
+ */
+int mem_check_report_differences(MEM_CHECK_REPORT_T *ptReport, unsigned long ulOffset, const unsigned char *pucA, const unsigned char *pucB, size_t sizLength)
+{
+	int iFound;
+	size_t sizStart;
+	size_t sizEnd;
+
+
+	iFound = 0;
+	sizStart = 0;
+	while( sizStart<sizLength )
+	{
+		sizStart += mem_check_first_difference(pucA + sizStart, pucB + sizStart, sizLength - sizStart);
+		if( sizStart>=sizLength )
+		{
+			break;
+		}
+
+		/* Find the end of the difference. */
+		sizEnd = sizStart + 1U;
+		while( sizEnd<sizLength && pucA[sizEnd]!=pucB[sizEnd] )
+		{
+			++sizEnd;
+		}
+
+		mem_check_report_add(ptReport, ulOffset + sizStart, ulOffset + sizEnd);
+		iFound = 1;
+
+		sizStart = sizEnd;
+	}
+
+	return iFound;
+}
+
+
+
+/*! Mark the verify report as complete.
+ *
+ * \param ptReport  The report.
+ */
+void mem_check_report_finalize(MEM_CHECK_REPORT_T *ptReport)
+{
+	ptReport->pulBuffer[0] = ptReport->sizRanges;
+}
@@ -0,0 +1,58 @@
+/***************************************************************************
+ *   Copyright (C) 2019 by Hilscher GmbH                                   *
+ *   cthelen@hilscher.com                                                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Library General Public License as       *
+ *   published by the Free Software Foundation; either version 2 of the    *
+ *   License, or (at your option) any later version.                       *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this program. If not, see                          *
+ *   <https://www.gnu.org/licenses/>.                                      *
+ ***************************************************************************/
+
+#ifndef __MEM_CHECK_H__
+#define __MEM_CHECK_H__
+
+#include <stddef.h>
+
+
+/* The value of an erased byte in NOR flashes. */
+#define MEM_CHECK_ERASED_VALUE 0xffU
+
+
+/* The verify report is a list of 32 bit values in the report buffer:
+ *   [0]     number of ranges or MEM_CHECK_REPORT_INVALID if the check did not finish
+ *   [1+2*n] start offset of range n
+ *   [2+2*n] end offset of range n (offset of the last different byte + 1)
+ * If there are more ranges than fit into the buffer, the last range is
+ * extended to cover all remaining differences.
+ */
+#define MEM_CHECK_REPORT_INVALID 0xffffffffU
+
+typedef struct MEM_CHECK_REPORT_STRUCT
+{
+	unsigned long *pulBuffer;
+	size_t sizMaxRanges;
+	size_t sizRanges;
+} MEM_CHECK_REPORT_T;
+
+
+size_t mem_check_first_difference(const unsigned char *pucA, const unsigned char *pucB, size_t sizLength);
+int mem_check_is_equal(const unsigned char *pucA, const unsigned char *pucB, size_t sizLength);
+size_t mem_check_first_not_pattern(const unsigned char *pucData, size_t sizLength, unsigned char ucPattern);
+int mem_check_is_pattern(const unsigned char *pucData, size_t sizLength, unsigned char ucPattern);
+
+int mem_check_report_init(MEM_CHECK_REPORT_T *ptReport, unsigned char *pucBuffer, size_t sizBuffer);
+void mem_check_report_add(MEM_CHECK_REPORT_T *ptReport, unsigned long ulStart, unsigned long ulEnd);
+int mem_check_report_differences(MEM_CHECK_REPORT_T *ptReport, unsigned long ulOffset, const unsigned char *pucA, const unsigned char *pucB, size_t sizLength);
+void mem_check_report_finalize(MEM_CHECK_REPORT_T *ptReport);
+
+
+#endif  /* __MEM_CHECK_H__ */
@@ -562,13 +562,13 @@ const SPIFLASH_ATTRIBUTES_T *sfdp_detect(FLASHER_SPI_FLASH_T *ptFlash)
 					uprintf("<SerialFlash name=\"%s\" size=\"%d\" clock=\"%d\">\n", tSfdpAttributes.acName, tSfdpAttributes.ulSize, tSfdpAttributes.ulClock);
 					uprintf("\t<Description>SFDP flash</Description>\n");
 					uprintf("\t<Note>This flash was auto-detected with SFDP</Note>\n");
-					uprintf("\t<Layout pageSize=\"%d\" sectorPages=\"%d\" mode=\"linear\" />\n", tSfdpAttributes.ulPageSize, tSfdpAttributes.ulSectorPages, spi_flash_get_adr_mode_name(tSfdpAttributes.tAdrMode));
+					uprintf("\t<Layout pageSize=\"%d\" sectorPages=\"%d\" mode=\"linear\" />\n", tSfdpAttributes.ulPageSize, tSfdpAttributes.ulSectorPages);
 					uprintf("\t<Read readArrayCommand=\"0x%02x\" ignoreBytes=\"%d\" />\n", tSfdpAttributes.ucReadOpcode, tSfdpAttributes.ucReadOpcodeDCBytes);
-					uprintf("\t<Write writeEnableCommand=\"0x%02x\" pageProgramCommand=\"0x%02x\" bufferFillCommand=\"0x%02x\" bufferWriteCommand=\"0x%02x\" eraseAndPageProgramCommand=\"0x%02x\" />\n", tSfdpAttributes.ucWriteEnableOpcode, tSfdpAttributes.ucPageProgOpcode, tSfdpAttributes.ucBufferFill, tSfdpAttributes.ucBufferWriteOpcode, tSfdpAttributes.ucEraseAndPageProgOpcode);
+					uprintf("\t<Write writeEnableCommand=\"0x%02x\" pageProgramCommand=\"0x%02x\" bufferFillCommand=\"0x%02x\" bufferWriteCommand=\"0x%02x\" buffer2FillCommand=\"0x%02x\" buffer2WriteCommand=\"0x%02x\" eraseAndPageProgramCommand=\"0x%02x\" />\n", tSfdpAttributes.ucWriteEnableOpcode, tSfdpAttributes.ucPageProgOpcode, tSfdpAttributes.ucBufferFill, tSfdpAttributes.ucBufferWriteOpcode, tSfdpAttributes.ucBuffer2Fill, tSfdpAttributes.ucBuffer2WriteOpcode, tSfdpAttributes.ucEraseAndPageProgOpcode);
 					uprintf("\t<Erase erasePageCommand=\"0x%02x\" eraseSectorCommand=\"0x%02x\" eraseChipCommand=\"", tSfdpAttributes.ucErasePageOpcode, tSfdpAttributes.ucEraseSectorOpcode);
 					hexdump_line(tSfdpAttributes.aucEraseChipCmd, tSfdpAttributes.ucEraseChipCmdLen);
 					uprintf("\" />\n");
-					uprintf("\t<Status readStatusCommand=\"0x%02x\" statusReadyMask=\"0x%02x\" statusReadyValue=\"0x%02x\" />\n", tSfdpAttributes.ucReadStatusOpcode, tSfdpAttributes.ucStatusReadyMask, tSfdpAttributes.ucStatusReadyValue);
+					uprintf("\t<Status readStatusCommand=\"0x%02x\" statusReadyMask=\"0x%02x\" statusReadyValue=\"0x%02x\" errorStatusCommand=\"0x%02x\" errorStatusMask=\"0x%02x\" clearErrorCommand=\"0x%02x\" />\n", tSfdpAttributes.ucReadStatusOpcode, tSfdpAttributes.ucStatusReadyMask, tSfdpAttributes.ucStatusReadyValue, tSfdpAttributes.ucErrorStatusOpcode, tSfdpAttributes.ucErrorStatusMask, tSfdpAttributes.ucClearErrorOpcode);
 					uprintf("\t<Init0 command=\"");
 					hexdump_line(tSfdpAttributes.aucInitCmd0, tSfdpAttributes.ucInitCmd0_length);
 					uprintf("\" />\n");
@@ -92,6 +92,20 @@
 
 #define SPANSION_CMD_BUFFERPROG               0x29U
 
+#define SPANSION_CMD_UNLOCKBYPASS_CYCLE0      0xAAU
+#define SPANSION_CMD_UNLOCKBYPASS_CYCLE1      0x55U
+#define SPANSION_CMD_UNLOCKBYPASS_CYCLE2      0x20U
+#define SPANSION_ADR_UNLOCKBYPASS_CYCLE0      0x555U
+#define SPANSION_ADR_UNLOCKBYPASS_CYCLE1      0x2AAU
+#define SPANSION_ADR_UNLOCKBYPASS_CYCLE2      0x555U
+
+#define SPANSION_CMD_UNLOCKBYPASS_PROGRAM     0xA0U
+
+#define SPANSION_CMD_UNLOCKBYPASS_RESET_CYCLE0 0x90U
+#define SPANSION_CMD_UNLOCKBYPASS_RESET_CYCLE1 0x00U
+#define SPANSION_ADR_UNLOCKBYPASS_RESET_CYCLE0 0x000U
+#define SPANSION_ADR_UNLOCKBYPASS_RESET_CYCLE1 0x000U
+
 #define SPANSION_CMD_ERASE_CYCLE0             0xAAU
 #define SPANSION_CMD_ERASE_CYCLE1             0x55U
 #define SPANSION_CMD_ERASE_CYCLE2             0x80U
@@ -108,6 +122,9 @@
 
 #define SPANSION_CMD_SECTORERASE_CYCLE_5      0x30U
 
+/* Queue at most this number of sectors in one erase cycle. This keeps the progress bar moving. */
+#define SPANSION_MAX_QUEUED_SECTORS           16U
+
 #define SPANSION_CMD_ERASEPROG_SUSPEND        0xB0U
 #define SPANSION_CMD_ERASEPROG_RESUME         0x30U
 
@@ -154,6 +171,7 @@ static FLASH_ERRORS_E FlashNormalWrite(const FLASH_DEVICE_T *ptFlashDev, unsigne
 
 static FLASH_ERRORS_E FlashReset      (const FLASH_DEVICE_T *ptFlashDev, unsigned long ulSector);
 static FLASH_ERRORS_E FlashErase      (const FLASH_DEVICE_T *ptFlashDev, unsigned long ulSector);
+static FLASH_ERRORS_E FlashEraseSectors(const FLASH_DEVICE_T *ptFlashDev, unsigned long ulFirstSector, unsigned long ulSectorCnt, unsigned long *pulErasedCnt);
 static FLASH_ERRORS_E FlashEraseAll   (const FLASH_DEVICE_T *ptFlashDev);
 static FLASH_ERRORS_E FlashProgram    (const FLASH_DEVICE_T *ptFlashDev, unsigned long ulStartOffset, unsigned long ulLength, const void* pvData);
 static FLASH_ERRORS_E FlashLock       (const FLASH_DEVICE_T *ptFlashDev, unsigned long ulSector);
@@ -164,6 +182,7 @@ static const FLASH_FUNCTIONS_T s_tSpansionFuncs =
 {
 	FlashReset,
 	FlashErase,
+	FlashEraseSectors,
 	FlashEraseAll,
 	FlashProgram,
 	FlashLock,
@@ -186,6 +205,19 @@ static const FLASH_COMMAND_BLOCK_T s_atErasePrefix[] =
 	{SPANSION_ADR_ERASE_CYCLE4, SPANSION_CMD_ERASE_CYCLE4},
 };
 
+static const FLASH_COMMAND_BLOCK_T s_atUnlockBypassEntry[] =
+{
+	{SPANSION_ADR_UNLOCKBYPASS_CYCLE0, SPANSION_CMD_UNLOCKBYPASS_CYCLE0},
+	{SPANSION_ADR_UNLOCKBYPASS_CYCLE1, SPANSION_CMD_UNLOCKBYPASS_CYCLE1},
+	{SPANSION_ADR_UNLOCKBYPASS_CYCLE2, SPANSION_CMD_UNLOCKBYPASS_CYCLE2}
+};
+
+static const FLASH_COMMAND_BLOCK_T s_atUnlockBypassExit[] =
+{
+	{SPANSION_ADR_UNLOCKBYPASS_RESET_CYCLE0, SPANSION_CMD_UNLOCKBYPASS_RESET_CYCLE0},
+	{SPANSION_ADR_UNLOCKBYPASS_RESET_CYCLE1, SPANSION_CMD_UNLOCKBYPASS_RESET_CYCLE1}
+};
+
 static const FLASH_COMMAND_BLOCK_T s_atPPBEntry[] =
 {
 	{SPANSION_ADR_PPB_ENTRY_CYCLE0, SPANSION_CMD_PPB_ENTRY_CYCLE0},
@@ -209,7 +241,7 @@ static volatile unsigned char *get_flash_address(const FLASH_DEVICE_T *ptFlashDe
 
 
 	pucAddress  = ptFlashDev->pucFlashBase;
-	pucAddress += ptFlashDev->atSectors[ulSector].ulOffset;
+	pucAddress += cfi_get_sector_offset(ptFlashDev, ulSector);
 	pucAddress += ulOffset;
 
 	return pucAddress;
@@ -700,6 +732,93 @@ static FLASH_ERRORS_E FlashErase(const FLASH_DEVICE_T *ptFlashDev, unsigned long
 	return tResult;
 }
 
+/*! Check if the sector erase timeout window is closed
+*
+*   DQ3 is set as soon as the erase cycle started. The device does not
+*   accept more sector erase commands then.
+*
+*   \param   ptFlashDev       Pointer to the FLASH control Block
+*   \param   ulSector         A sector which is part of the erase cycle
+*
+*   \return  1 if at least one device started the erase cycle, 0 if not
+*/
+static int is_erase_window_closed(const FLASH_DEVICE_T *ptFlashDev, unsigned long ulSector)
+{
+	unsigned long ulMask;
+
+
+	/* Check DQ3 of all devices. */
+	ulMask = DQ3;
+	if( ptFlashDev->fPaired!=0 )
+	{
+		if( ptFlashDev->tBits==BUS_WIDTH_16Bit )
+		{
+			ulMask |= DQ3 << 8U;
+		}
+		else if( ptFlashDev->tBits==BUS_WIDTH_32Bit )
+		{
+			ulMask |= DQ3 << 16U;
+		}
+	}
+
+	return ((read_flash_data(ptFlashDev, ulSector, 0) & ulMask)!=0) ? 1 : 0;
+}
+
+/*! Erase consecutive flash sectors in one erase cycle
+*
+*   The sector erase commands for all sectors are queued in the sector
+*   erase timeout window. DQ3 is checked before and after each additional
+*   command. If the window closed, the last command might be lost and the
+*   queue stops before this sector. The caller continues with the
+*   remaining sectors.
+*
+*   \param   ptFlashDev       Pointer to the FLASH control Block
+*   \param   ulFirstSector    First sector to erase
+*   \param   ulSectorCnt      Number of sectors to erase
+*   \param   pulErasedCnt     Returns the number of erased sectors
+*
+*   \return  eFLASH_NO_ERROR  on success
+*/
+static FLASH_ERRORS_E FlashEraseSectors(const FLASH_DEVICE_T *ptFlashDev, unsigned long ulFirstSector, unsigned long ulSectorCnt, unsigned long *pulErasedCnt)
+{
+	FLASH_ERRORS_E tResult;
+	unsigned long ulQueued;
+
+
+	DEBUGMSG(ZONE_FUNCTION, ("+FlashEraseSectors(): ptFlashDev=0x%08x, ulFirstSector=%d, ulSectorCnt=%d\n", ptFlashDev, ulFirstSector, ulSectorCnt));
+
+	FlashWriteCommandSequence(ptFlashDev, s_atErasePrefix, ARRAYSIZE(s_atErasePrefix));
+	FlashWriteCommand(ptFlashDev, ulFirstSector, 0, SPANSION_CMD_SECTORERASE_CYCLE_5);
+	ulQueued = 1;
+
+	while( ulQueued<ulSectorCnt && ulQueued<SPANSION_MAX_QUEUED_SECTORS )
+	{
+		if( is_erase_window_closed(ptFlashDev, ulFirstSector)!=0 )
+		{
+			break;
+		}
+
+		FlashWriteCommand(ptFlashDev, ulFirstSector + ulQueued, 0, SPANSION_CMD_SECTORERASE_CYCLE_5);
+
+		/* The window might have closed during the last command. Erase this sector in the next cycle. */
+		if( is_erase_window_closed(ptFlashDev, ulFirstSector)!=0 )
+		{
+			break;
+		}
+		++ulQueued;
+	}
+	DEBUGMSG(ZONE_VERBOSE, (".FlashEraseSectors(): queued %d sectors\n", ulQueued));
+
+	tResult = FlashWaitForEraseDone(ptFlashDev, ulFirstSector);
+
+	FlashReset(ptFlashDev, ulFirstSector);
+
+	*pulErasedCnt = (tResult==eFLASH_NO_ERROR) ? ulQueued : 0;
+
+	DEBUGMSG(ZONE_FUNCTION, ("-FlashEraseSectors(): tResult=%d\n", tResult));
+	return tResult;
+}
+
 /*! Erase whole flash
 *
 *   \param   ptFlashDev       Pointer to the FLASH control Block
@@ -727,10 +846,15 @@ static FLASH_ERRORS_E FlashEraseAll(const FLASH_DEVICE_T *ptFlashDev)
 
 /*! Programs flash using single byte/word/dword accesses
 *
+*   The device is in the unlock bypass mode during the write. Each element
+*   needs only the program command and the data then instead of the full
+*   unlock sequence.
+*
 *   \param   ptFlashDev       Pointer to the FLASH control Block
-*   \param   ulStartOffset    Offset to start writing at
-*   \param   ulLength         Length of data to write
-*   \param   pvData           Data pointer
+*   \param   ulSector         Sector of the first element
+*   \param   ulOffset         Offset of the first element in the sector
+*   \param   pucData          Data pointer
+*   \param   ulWriteSize      Length of data to write
 *
 *   \return  eFLASH_NO_ERROR  on success
 */
@@ -751,11 +875,11 @@ static FLASH_ERRORS_E FlashNormalWrite(const FLASH_DEVICE_T *ptFlashDev, unsigne
 	ulEndOffset  = ulOffset + ulWriteSize;
 	ulLastData   = 0;
 	
+	FlashWriteCommandSequence(ptFlashDev, s_atUnlockBypassEntry, ARRAYSIZE(s_atUnlockBypassEntry));
+
 	while(ulOffset < ulEndOffset)
 	{
-		FlashWriteCommand(ptFlashDev, 0, SPANSION_ADR_PROGRAM_CYCLE0, SPANSION_CMD_PROGRAM_CYCLE0);
-		FlashWriteCommand(ptFlashDev, 0, SPANSION_ADR_PROGRAM_CYCLE1, SPANSION_CMD_PROGRAM_CYCLE1);
-		FlashWriteCommand(ptFlashDev, 0, SPANSION_ADR_PROGRAM_CYCLE2, SPANSION_CMD_PROGRAM_CYCLE2);
+		FlashWriteCommand(ptFlashDev, 0, 0, SPANSION_CMD_UNLOCKBYPASS_PROGRAM);
 		
 		ulLastOffset = ulOffset;
 		
@@ -792,10 +916,27 @@ static FLASH_ERRORS_E FlashNormalWrite(const FLASH_DEVICE_T *ptFlashDev, unsigne
 		}
 	}
 
+	/* Leave the unlock bypass mode. */
+	FlashWriteCommandSequence(ptFlashDev, s_atUnlockBypassExit, ARRAYSIZE(s_atUnlockBypassExit));
+
 	DEBUGMSG(ZONE_FUNCTION, ("-FlashNormalWrite(): eRet=%d\n", eRet));
 	return eRet;
 }
 
+/*! Programs flash with the write buffer
+*
+*   A write buffer command must not cross a write buffer page. A start in
+*   the middle of a page gets a short write up to the end of the page. All
+*   following writes use the complete buffer.
+*
+*   \param   ptFlashDev       Pointer to the FLASH control Block
+*   \param   pucSource        Data pointer
+*   \param   ulLength         Length of data to write
+*   \param   ulCurrentSector  Sector of the first element
+*   \param   ulCurrentOffset  Offset of the first element in the sector
+*
+*   \return  eFLASH_NO_ERROR  on success
+*/
 static FLASH_ERRORS_E FlashBufferedWrite(const FLASH_DEVICE_T *ptFlashDev, const unsigned char *pucSource, unsigned long ulLength, unsigned long ulCurrentSector, unsigned long ulCurrentOffset)
 {
 	FLASH_ERRORS_E tResult;
@@ -803,6 +944,7 @@ static FLASH_ERRORS_E FlashBufferedWrite(const FLASH_DEVICE_T *ptFlashDev, const
 	unsigned int uiWriteElements;
 	unsigned long ulDeviceBufferSize;
 	unsigned long ulSectorBytesLeft;
+	unsigned long ulSectorSize;
 	unsigned long ulLastData;
 	unsigned long ulLastOffset;
 	CADR_T tSrc;
@@ -827,19 +969,22 @@ static FLASH_ERRORS_E FlashBufferedWrite(const FLASH_DEVICE_T *ptFlashDev, const
 		DEBUGMSG(ZONE_FUNCTION, (". write buffer size for all devices: 0x%08x bytes\n", ulDeviceBufferSize));
 	}
 
+	/* All sectors of a region have the same size. Get it again after each sector wrap. */
+	ulSectorSize = cfi_get_sector_size(ptFlashDev, ulCurrentSector);
+
 	while(ulLength>0)
 	{
 		uiWriteElements = 0;
 
-		/* Limit the write size to the buffer size. */
-		ulWriteSize = ulLength;
-		if(ulWriteSize>ulDeviceBufferSize)
+		/* Write up to the end of the write buffer page. The buffer size is a power of 2. */
+		ulWriteSize = ulDeviceBufferSize - (ulCurrentOffset & (ulDeviceBufferSize - 1U));
+		if(ulWriteSize>ulLength)
 		{
-			ulWriteSize = ulDeviceBufferSize;
+			ulWriteSize = ulLength;
 		}
 
 		/* Limit the write size to the end of the sector. */
-		ulSectorBytesLeft = ptFlashDev->atSectors[ulCurrentSector].ulSize - ulCurrentOffset;
+		ulSectorBytesLeft = ulSectorSize - ulCurrentOffset;
 		if(ulWriteSize>ulSectorBytesLeft)
 		{
 			ulWriteSize = ulSectorBytesLeft;
@@ -936,10 +1081,11 @@ static FLASH_ERRORS_E FlashBufferedWrite(const FLASH_DEVICE_T *ptFlashDev, const
 		}
 
 		/* sector wrap around */    
-		if(ulCurrentOffset == ptFlashDev->atSectors[ulCurrentSector].ulSize)
+		if(ulCurrentOffset == ulSectorSize)
 		{
 			++ulCurrentSector;
 			ulCurrentOffset = 0;
+			ulSectorSize = cfi_get_sector_size(ptFlashDev, ulCurrentSector);
 		}
 	}
 
@@ -961,9 +1107,8 @@ static FLASH_ERRORS_E FlashProgram(const FLASH_DEVICE_T *ptFlashDev, unsigned lo
 {
 	unsigned long  ulCurrentSector;
 	unsigned long  ulCurrentOffset;
+	SECTOR_INFO_T tSector;
 	const unsigned char *pucSource;
-	unsigned long ulDeviceBufferSize;
-	unsigned long ulOffsetMod;
 	FLASH_ERRORS_E tResult;
 
 
@@ -975,8 +1120,8 @@ static FLASH_ERRORS_E FlashProgram(const FLASH_DEVICE_T *ptFlashDev, unsigned lo
 	pucSource = (const unsigned char*)pvData;
 
 	/* Determine the start sector and offset inside the sector */
-	ulCurrentSector = cfi_find_matching_sector_index(ptFlashDev, ulStartOffset);
-	ulCurrentOffset = ulStartOffset - ptFlashDev->atSectors[ulCurrentSector].ulOffset;
+	ulCurrentSector = cfi_find_matching_sector(ptFlashDev, ulStartOffset, &tSector);
+	ulCurrentOffset = ulStartOffset - tSector.ulOffset;
 	
 	FlashReset(ptFlashDev, 0);
 
@@ -996,45 +1141,9 @@ static FLASH_ERRORS_E FlashProgram(const FLASH_DEVICE_T *ptFlashDev, unsigned lo
 	}
 	else
 	{
-		/* check if the offset is aligned to the write buffer size (a power of 2) */
-		ulDeviceBufferSize = ptFlashDev->ulMaxBufferWriteSize;
-		ulOffsetMod = ulCurrentOffset & (ulDeviceBufferSize - 1);
-
-		DEBUGMSG(ZONE_VERBOSE, (". ulDeviceBufferSize = 0x%08x\n", ulDeviceBufferSize));
-		DEBUGMSG(ZONE_VERBOSE, (". ulOffsetMod        = 0x%08x\n", ulOffsetMod));
-		
-		if( ulOffsetMod!=0 )
-		{
-			/* get the maximum size for the normal write operation (only write until buffered write can be used) */
-			unsigned long ulUnbufferedWriteSize = ulDeviceBufferSize - ulOffsetMod;
-			DEBUGMSG(ZONE_VERBOSE, (". ulUnbufferedWriteSize = 0x%08x\n", ulUnbufferedWriteSize));
-			
-			/* limit the write size to the requested chunk */
-			if( ulUnbufferedWriteSize>ulLength )
-			{
-				ulUnbufferedWriteSize = ulLength;
-				DEBUGMSG(ZONE_VERBOSE, (". ulUnbufferedWriteSize adjusted to 0x%08x\n", ulUnbufferedWriteSize));
-			}
-			tResult = FlashNormalWrite(ptFlashDev, ulCurrentSector, ulCurrentOffset, pucSource, ulUnbufferedWriteSize);
-			if(tResult==eFLASH_NO_ERROR)
-			{
-				ulCurrentOffset += ulUnbufferedWriteSize;
-				pucSource       += ulUnbufferedWriteSize;
-				ulLength        -= ulUnbufferedWriteSize;
-
-				/* Check for new sector wraparound */
-				if(ulCurrentOffset >= ptFlashDev->atSectors[ulCurrentSector].ulSize)
-				{
-					ulCurrentOffset = ptFlashDev->atSectors[ulCurrentSector].ulSize - ulCurrentOffset;
-					++ulCurrentSector;
-				}
-			}
-		}
-
-		if( tResult==eFLASH_NO_ERROR )
-		{
-			tResult = FlashBufferedWrite(ptFlashDev, pucSource, ulLength, ulCurrentSector, ulCurrentOffset);
-		}
+		/* A misaligned start is handled with a short buffer write. */
+		DEBUGMSG(ZONE_VERBOSE, (".FlashProgram(): using buffered writes\n"));
+		tResult = FlashBufferedWrite(ptFlashDev, pucSource, ulLength, ulCurrentSector, ulCurrentOffset);
 	}
 	
 
@@ -1086,7 +1195,7 @@ FLASH_ERRORS_E FlashUnlock(const FLASH_DEVICE_T *ptFlashDev)
 	while( ulSector<ptFlashDev->ulSectorCnt )
 	{
 		/* get sector address */
-		pbReadAddr = ptFlashDev->pucFlashBase + ptFlashDev->atSectors[ulSector].ulOffset;
+		pbReadAddr = ptFlashDev->pucFlashBase + cfi_get_sector_offset(ptFlashDev, ulSector);
 
 		/* get protection info */
 		ulProtectionBit = *pbReadAddr;
@@ -168,21 +168,22 @@ static unsigned long getDeviceAddress(const FLASHER_SPI_FLASH_T *ptFlash, unsign
 }
 
 
-/*! read_status
-    read the status register
+/*! read_register
+    read a one byte register of the device
 
-    \param   ptFls              Pointer to FLASH Control Block
-    \param   ulLinearAddress    linear address
+    \param   ptFlash            Pointer to FLASH Control Block
+    \param   ucOpcode           opcode to read the register
+    \param   pucValue           receives the register value
 
-    \return  RX_OK              status successfully returned
+    \return  RX_OK              register successfully read
 */
-static int read_status(const FLASHER_SPI_FLASH_T *ptFlash, unsigned char *pucStatus)
+static int read_register(const FLASHER_SPI_FLASH_T *ptFlash, unsigned char ucOpcode, unsigned char *pucValue)
 {
 	int iResult;
 	const FLASHER_SPI_CFG_T *ptSpiDev;
 
 
-	DEBUGMSG(ZONE_FUNCTION, ("+read_status(): ptFlash=0x%08x, pucStatus=0x%08x\n", ptFlash, pucStatus));
+	DEBUGMSG(ZONE_FUNCTION, ("+read_register(): ptFlash=0x%08x, ucOpcode=0x%02x, pucValue=0x%08x\n", ptFlash, ucOpcode, pucValue));
 
 	/* get spi device */
 	ptSpiDev = &ptFlash->tSpiDev;
@@ -191,19 +192,19 @@ static int read_status(const FLASHER_SPI_FLASH_T *ptFlash, unsigned char *pucSta
 	ptSpiDev->pfnSelect(ptSpiDev, 1);
 
 	/* send command */
-	iResult = ptSpiDev->pfnSendData(ptSpiDev, &(ptFlash->tAttributes.ucReadStatusOpcode), 1);
+	iResult = ptSpiDev->pfnSendData(ptSpiDev, &ucOpcode, 1);
 	if( iResult!=0 )
 	{
-		//uprintf("ERROR: read_status: HalSPI_ExchangeByte failed with %d.\n", iResult);
+		//uprintf("ERROR: read_register: HalSPI_ExchangeByte failed with %d.\n", iResult);
 		DBG_CALL_FAILED_VAL("pfnSendData", iResult)
 	}
 	else
 	{
 		/*  receive status byte */
-		iResult = ptSpiDev->pfnReceiveData(ptSpiDev, pucStatus, 1);
+		iResult = ptSpiDev->pfnReceiveData(ptSpiDev, pucValue, 1);
 		if( iResult!=0 )
 		{
-			//uprintf("ERROR: read_status: Drv_SpiReceive failed with %d.\n", iResult);
+			//uprintf("ERROR: read_register: Drv_SpiReceive failed with %d.\n", iResult);
 			DBG_CALL_FAILED_VAL("pfnReceiveData", iResult)
 		}
 	}
@@ -216,16 +217,33 @@ static int read_status(const FLASHER_SPI_FLASH_T *ptFlash, unsigned char *pucSta
 		iResult = ptSpiDev->pfnSendIdle(ptSpiDev, 1);
 		if( iResult!=0 )
 		{
-			//uprintf("ERROR: read_status: SendIdles failed with %d.\n", iResult);
+			//uprintf("ERROR: read_register: SendIdles failed with %d.\n", iResult);
 			DBG_CALL_FAILED_VAL("pfnSendIdle", iResult)
 		}
 	}
 
-	DEBUGMSG(ZONE_FUNCTION, ("-read_status(): iResult=%d, *pucStatus=0x%02x\n", iResult, *pucStatus));
+	DEBUGMSG(ZONE_FUNCTION, ("-read_register(): iResult=%d, *pucValue=0x%02x\n", iResult, *pucValue));
 	return iResult;
 }
 
 
+/*! read_status
+    read the status register with the ready bits
+
+    The error bits of some devices are in a separate register. They are
+    read with check_error_status.
+
+    \param   ptFlash            Pointer to FLASH Control Block
+    \param   pucStatus          receives the status register value
+
+    \return  RX_OK              status successfully returned
+*/
+static int read_status(const FLASHER_SPI_FLASH_T *ptFlash, unsigned char *pucStatus)
+{
+	return read_register(ptFlash, ptFlash->tAttributes.ucReadStatusOpcode, pucStatus);
+}
+
+
 #if CFG_DEBUGMSG!=0
 static int print_status(const FLASHER_SPI_FLASH_T *ptFlash)
 {
@@ -522,6 +540,65 @@ static int write_enable(const FLASHER_SPI_FLASH_T *ptFlash)
 }
 
 
+/*! check_error_status
+*   check the error bits of the running or last erase or program operation
+*
+*   \param   ptFlash           Pointer to flash Control Block
+*   \param   ucStatus          The value of the status register. It is used
+*                              if the error bits are in the status register.
+*   \return  iResult           =0 success, SPI_FLASH_STATUS_ERROR if the
+*                              device reported an error, other values for
+*                              communication errors                          */
+static int check_error_status(const FLASHER_SPI_FLASH_T *ptFlash, unsigned char ucStatus)
+{
+	unsigned char ucOpcode;
+	int iResult;
+
+
+	DEBUGMSG(ZONE_FUNCTION, ("+check_error_status(): ptFlash=0x%08x, ucStatus=0x%02x\n", ptFlash, ucStatus));
+
+	iResult = 0;
+
+	/* Does the device report errors at all? */
+	ucOpcode = ptFlash->tAttributes.ucErrorStatusOpcode;
+	if( ucOpcode!=0 && ptFlash->tAttributes.ucErrorStatusMask!=0 )
+	{
+		/* Read the error bits only if they are not in the status register. */
+		if( ucOpcode!=ptFlash->tAttributes.ucReadStatusOpcode )
+		{
+			iResult = read_register(ptFlash, ucOpcode, &ucStatus);
+		}
+		if( iResult!=0 )
+		{
+			DBG_CALL_FAILED_VAL("read_register", iResult)
+		}
+		else if( (ucStatus&ptFlash->tAttributes.ucErrorStatusMask)!=0 )
+		{
+			DBG_ERROR_VAL("the device reported an error: 0x%02x", ucStatus)
+
+			/* Some devices block all further operations until the error bits are cleared. */
+			ucOpcode = ptFlash->tAttributes.ucClearErrorOpcode;
+			if( ucOpcode!=0 )
+			{
+				iResult = send_simple_cmd(ptFlash, &ucOpcode, 1);
+				if( iResult!=0 )
+				{
+					DBG_CALL_FAILED_VAL("send_simple_cmd", iResult)
+				}
+			}
+
+			if( iResult==0 )
+			{
+				iResult = SPI_FLASH_STATUS_ERROR;
+			}
+		}
+	}
+
+	DEBUGMSG(ZONE_FUNCTION, ("-check_error_status(): iResult=%d.\n", iResult));
+	return iResult;
+}
+
+
 /*! wait_for_ready
 *   wait for the flash to finish a write operation
 *               
@@ -546,6 +623,16 @@ static int wait_for_ready(const FLASHER_SPI_FLASH_T *ptFlash)
 			break;
 		}
 
+		/* Did the device report a failed erase or program operation? Some
+		 * devices stay busy after an error until the error bits are cleared,
+		 * so this must be checked while polling.
+		 */
+		iResult = check_error_status(ptFlash, ucStatus);
+		if( iResult!=0 )
+		{
+			break;
+		}
+
 		/* get relevant bits */
 		ucStatus &= ptFlash->tAttributes.ucStatusReadyMask;
 
@@ -1142,18 +1229,19 @@ int Drv_SpiWriteFlashPages(const FLASHER_SPI_FLASH_T *ptFlash, unsigned long ulO
 }
 #endif
 
-/*! Drv_SpiReadFlash
-*   Reads a byte block from a FLASH
+/*! Drv_SpiReadFlashStart
+*   Starts a continuous read from a FLASH
 *
-*   \param   ptFls    Pointer to FLASH Control Block
-*   \param   ulOffs   Offset within the FLASH to write data from
-*   \param   pabDest  Pointer to Destination the read data that shall be written to
-*   \param   ulNum    Number of data in multiples of bytes to write
+*   The slave stays selected after this function. Get the data with
+*   Drv_SpiReadFlashContinue and finish the read with Drv_SpiReadFlashStop.
 *
-*   \return  RX_OK    Programming successful
+*   \param   ptFlash          Pointer to FLASH Control Block
+*   \param   ulLinearAddress  Offset within the FLASH to read data from
+*
+*   \return  0 on success, the slave is deselected in case of an error
 */
 
-int Drv_SpiReadFlash(const FLASHER_SPI_FLASH_T *ptFlash, unsigned long ulLinearAddress, unsigned char *pucData, size_t sizData)
+int Drv_SpiReadFlashStart(const FLASHER_SPI_FLASH_T *ptFlash, unsigned long ulLinearAddress)
 {
 	int           iResult;
 	unsigned long ulDeviceAddress;
@@ -1161,7 +1249,7 @@ int Drv_SpiReadFlash(const FLASHER_SPI_FLASH_T *ptFlash, unsigned long ulLinearA
 	const FLASHER_SPI_CFG_T *ptSpiDev;
 
 
-	DEBUGMSG(ZONE_FUNCTION, ("+Drv_SpiReadFlash(): ptFlash=0x%08x, ulLinearAddress=0x%08x, pucData=0x%08x, sizData=%d\n", ptFlash, ulLinearAddress, pucData, sizData));
+	DEBUGMSG(ZONE_FUNCTION, ("+Drv_SpiReadFlashStart(): ptFlash=0x%08x, ulLinearAddress=0x%08x\n", ptFlash, ulLinearAddress));
 
 	/* get spi device */
 	ptSpiDev = &ptFlash->tSpiDev;
@@ -1173,7 +1261,6 @@ int Drv_SpiReadFlash(const FLASHER_SPI_FLASH_T *ptFlash, unsigned long ulLinearA
 	iResult = ptSpiDev->pfnSendIdle(ptSpiDev, 1);
 	if( iResult!=0 )
 	{
-		//uprintf("ERROR: Drv_SpiReadFlash: HalSPI_SendIdles failed with %d.\n", iResult);
 		DBG_CALL_FAILED_VAL("SendIdle", iResult);
 	}
 	else
@@ -1195,7 +1282,6 @@ int Drv_SpiReadFlash(const FLASHER_SPI_FLASH_T *ptFlash, unsigned long ulLinearA
 		iResult = ptSpiDev->pfnSendData(ptSpiDev, abCmd, 4);
 		if( iResult!=0 )
 		{
-			//uprintf("ERROR: Drv_SpiReadFlash: HalSPI_BlockIo failed with %d.\n", iResult);
 			DBG_CALL_FAILED_VAL("SendData", iResult);
 		}
 		else
@@ -1204,33 +1290,111 @@ int Drv_SpiReadFlash(const FLASHER_SPI_FLASH_T *ptFlash, unsigned long ulLinearA
 			iResult = ptSpiDev->pfnSendIdle(ptSpiDev, ptFlash->tAttributes.ucReadOpcodeDCBytes);
 			if( iResult!=0 )
 			{
-				//uprintf("ERROR: Drv_SpiReadFlash: HalSPI_SendIdles failed with %d.\n", iResult);
 				DBG_CALL_FAILED_VAL("SendIdle", iResult);
 			}
-			else
-			{
-				/* receive the data */
-				iResult = ptSpiDev->pfnReceiveData(ptSpiDev, pucData, sizData);
-				if( iResult!=0 )
-				{
-					//uprintf("ERROR: Drv_SpiReadFlash: HalSPI_BlockIo failed with %d.\n", iResult);
-					DBG_CALL_FAILED_VAL("ReceiveData", iResult);
-				}
-			}
 		}
 
-		/* deselect slave */
-		ptSpiDev->pfnSelect(ptSpiDev, 0);
+		if( iResult!=0 )
+		{
+			/* deselect slave */
+			ptSpiDev->pfnSelect(ptSpiDev, 0);
+		}
+	}
 
-		/* send 1 idlebyte */
+	DEBUGMSG(ZONE_FUNCTION, ("-Drv_SpiReadFlashStart(): iResult=%d.\n", iResult));
+	return iResult;
+}
+
+
+/*! Drv_SpiReadFlashContinue
+*   Reads the next bytes of a continuous read
+*
+*   \param   ptFlash  Pointer to FLASH Control Block
+*   \param   pucData  Pointer to Destination the read data that shall be written to
+*   \param   sizData  Number of bytes to read
+*
+*   \return  0 on success
+*/
+
+int Drv_SpiReadFlashContinue(const FLASHER_SPI_FLASH_T *ptFlash, unsigned char *pucData, size_t sizData)
+{
+	int iResult;
+	const FLASHER_SPI_CFG_T *ptSpiDev;
+
+
+	/* get spi device */
+	ptSpiDev = &ptFlash->tSpiDev;
+
+	/* receive the data */
+	iResult = ptSpiDev->pfnReceiveData(ptSpiDev, pucData, sizData);
+	if( iResult!=0 )
+	{
+		DBG_CALL_FAILED_VAL("ReceiveData", iResult);
+	}
+
+	return iResult;
+}
+
+
+/*! Drv_SpiReadFlashStop
+*   Finishes a continuous read
+*
+*   \param   ptFlash  Pointer to FLASH Control Block
+*
+*   \return  0 on success
+*/
+
+int Drv_SpiReadFlashStop(const FLASHER_SPI_FLASH_T *ptFlash)
+{
+	int iResult;
+	const FLASHER_SPI_CFG_T *ptSpiDev;
+
+
+	/* get spi device */
+	ptSpiDev = &ptFlash->tSpiDev;
+
+	/* deselect slave */
+	ptSpiDev->pfnSelect(ptSpiDev, 0);
+
+	/* send 1 idlebyte */
+	iResult = ptSpiDev->pfnSendIdle(ptSpiDev, 1);
+	if( iResult!=0 )
+	{
+		DBG_CALL_FAILED_VAL("SendIdle", iResult);
+	}
+
+	return iResult;
+}
+
+
+/*! Drv_SpiReadFlash
+*   Reads a byte block from a FLASH
+*
+*   \param   ptFls    Pointer to FLASH Control Block
+*   \param   ulOffs   Offset within the FLASH to write data from
+*   \param   pabDest  Pointer to Destination the read data that shall be written to
+*   \param   ulNum    Number of data in multiples of bytes to write
+*
+*   \return  RX_OK    Programming successful
+*/
+
+int Drv_SpiReadFlash(const FLASHER_SPI_FLASH_T *ptFlash, unsigned long ulLinearAddress, unsigned char *pucData, size_t sizData)
+{
+	int iResult;
+	int iResultStop;
+
+
+	DEBUGMSG(ZONE_FUNCTION, ("+Drv_SpiReadFlash(): ptFlash=0x%08x, ulLinearAddress=0x%08x, pucData=0x%08x, sizData=%d\n", ptFlash, ulLinearAddress, pucData, sizData));
+
+	iResult = Drv_SpiReadFlashStart(ptFlash, ulLinearAddress);
+	if( iResult==0 )
+	{
+		iResult = Drv_SpiReadFlashContinue(ptFlash, pucData, sizData);
+
+		iResultStop = Drv_SpiReadFlashStop(ptFlash);
 		if( iResult==0 )
 		{
-			iResult = ptSpiDev->pfnSendIdle(ptSpiDev, 1);
-			if( iResult!=0 )
-			{
-				//uprintf("ERROR: send_simple_cmd: HalSPI_SendIdles failed with %d.\n", iResult);
-				DBG_CALL_FAILED_VAL("SendIdle", iResult);
-			}
+			iResult = iResultStop;
 		}
 	}
 
@@ -1474,15 +1638,23 @@ static int write_single_opcode(const FLASHER_SPI_FLASH_T *ptFlash, unsigned long
 }
 
 
-static int write_via_buffer(const FLASHER_SPI_FLASH_T *ptFlash, unsigned long ulLinearAddress, const unsigned char *pabBuffer)
+/*! fill_buffer
+*   Transfer one page of data into one of the SRAM buffers of the device.
+*   This does not touch the flash array, so it can be done while the device
+*   is still busy programming the other buffer.
+*
+*   \param   ptFlash           Pointer to flash Control Block
+*   \param   ucFillOpcode      opcode to fill the selected buffer
+*   \param   pabBuffer         data for one page
+*   \return  iResult           =0 success, <>0 error                         */
+static int fill_buffer(const FLASHER_SPI_FLASH_T *ptFlash, unsigned char ucFillOpcode, const unsigned char *pabBuffer)
 {
 	int             iResult;
-	unsigned long   ulDeviceAddress;
 	unsigned char   aucCmd[4];
 	const FLASHER_SPI_CFG_T *ptSpiDev;
 
 
-	DEBUGMSG(ZONE_FUNCTION, ("+write_via_buffer(): ptFlash=0x%08x, ulLinearAddress=0x%08x, pabBuffer=0x%08x\n", ptFlash, ulLinearAddress, pabBuffer));
+	DEBUGMSG(ZONE_FUNCTION, ("+fill_buffer(): ptFlash=0x%08x, ucFillOpcode=0x%02x, pabBuffer=0x%08x\n", ptFlash, ucFillOpcode, pabBuffer));
 
 	/* get spi device */
 	ptSpiDev = &ptFlash->tSpiDev;
@@ -1493,7 +1665,7 @@ static int write_via_buffer(const FLASHER_SPI_FLASH_T *ptFlash, unsigned long ul
 	/* send command */
 
 	/* first byte of the command is the write Opcode */
-	aucCmd[0] = ptFlash->tAttributes.ucBufferFill;
+	aucCmd[0] = ucFillOpcode;
 	/* byte 1-3 is the byte offset in the buffer */
 	aucCmd[1] = 0U;
 	aucCmd[2] = 0U;
@@ -1502,7 +1674,7 @@ static int write_via_buffer(const FLASHER_SPI_FLASH_T *ptFlash, unsigned long ul
 	iResult = ptSpiDev->pfnSendData(ptSpiDev, aucCmd, 4);
 	if( iResult!=0 )
 	{
-		//uprintf("ERROR: write_via_buffer: HalSPI_BlockIo failed with %d.\n", iResult);
+		//uprintf("ERROR: fill_buffer: HalSPI_BlockIo failed with %d.\n", iResult);
 		DBG_CALL_FAILED_VAL("pfnSendData", iResult);
 	}
 	else
@@ -1511,7 +1683,7 @@ static int write_via_buffer(const FLASHER_SPI_FLASH_T *ptFlash, unsigned long ul
 		iResult = ptSpiDev->pfnSendData(ptSpiDev, pabBuffer, ptFlash->tAttributes.ulPageSize);
 		if( iResult!=0 )
 		{
-			//uprintf("ERROR: write_via_buffer: HalSPI_BlockIo failed with %d.\n", iResult);
+			//uprintf("ERROR: fill_buffer: HalSPI_BlockIo failed with %d.\n", iResult);
 			DBG_CALL_FAILED_VAL("pfnSendData", iResult);
 		}
 	}
@@ -1524,72 +1696,106 @@ static int write_via_buffer(const FLASHER_SPI_FLASH_T *ptFlash, unsigned long ul
 		iResult = ptSpiDev->pfnSendIdle(ptSpiDev, 1);
 		if( iResult!=0 )
 		{
-			//uprintf("ERROR: write_via_buffer: HalSPI_SendIdles failed with %d.\n", iResult);
+			//uprintf("ERROR: fill_buffer: HalSPI_SendIdles failed with %d.\n", iResult);
 			DBG_CALL_FAILED_VAL("pfnSendIdle", iResult);
 		}
-		else
+	}
+
+	DEBUGMSG(ZONE_FUNCTION, ("-fill_buffer(): iResult=%d.\n", iResult));
+	return iResult;
+}
+
+
+/*! start_buffer_write
+*   Start programming one of the SRAM buffers to the main memory.
+*   This function does not wait for the operation to finish.
+*
+*   \param   ptFlash           Pointer to flash Control Block
+*   \param   ucWriteOpcode     opcode to write the selected buffer to the flash
+*   \param   ulLinearAddress   linear address of the page
+*   \return  iResult           =0 success, <>0 error                         */
+static int start_buffer_write(const FLASHER_SPI_FLASH_T *ptFlash, unsigned char ucWriteOpcode, unsigned long ulLinearAddress)
+{
+	int             iResult;
+	unsigned long   ulDeviceAddress;
+	unsigned char   aucCmd[4];
+	const FLASHER_SPI_CFG_T *ptSpiDev;
+
+
+	DEBUGMSG(ZONE_FUNCTION, ("+start_buffer_write(): ptFlash=0x%08x, ucWriteOpcode=0x%02x, ulLinearAddress=0x%08x\n", ptFlash, ucWriteOpcode, ulLinearAddress));
+
+	/* get spi device */
+	ptSpiDev = &ptFlash->tSpiDev;
+
+	/* unlock write operations */
+	iResult = write_enable(ptFlash);
+	if( iResult!=0 )
+	{
+		//uprintf("ERROR: start_buffer_write: write_enable failed with %d.\n", iResult);
+		DBG_CALL_FAILED_VAL("write_enable", iResult);
+	}
+	else
+	{
+		/* select slave */
+		ptSpiDev->pfnSelect(ptSpiDev, 1);
+
+		/* write buffer to main memory */
+
+		/* translate the address to the device format */
+		ulDeviceAddress = getDeviceAddress(ptFlash, ulLinearAddress);
+
+		/* first byte of the command is the write bOpcode */
+		aucCmd[0] = ucWriteOpcode;
+		/* byte 1-3 is the address */
+		aucCmd[1] = (unsigned char)((ulDeviceAddress>>16U)&0xffU);
+		aucCmd[2] = (unsigned char)((ulDeviceAddress>> 8U)&0xffU);
+		aucCmd[3] = (unsigned char)( ulDeviceAddress      &0xffU);
+
+		iResult = ptSpiDev->pfnSendData(ptSpiDev, aucCmd, 4);
+		if( iResult!=0 )
+		{
+			//uprintf("ERROR: start_buffer_write: HalSPI_BlockIo failed with %d.\n", iResult);
+			DBG_CALL_FAILED_VAL("pfnSendData", iResult);
+		}
+
+		/* deselect slave */
+		ptSpiDev->pfnSelect(ptSpiDev, 0);
+
+		if( iResult==0 )
 		{
-			/* unlock write operations */
-			iResult = write_enable(ptFlash);
+			iResult = ptSpiDev->pfnSendIdle(ptSpiDev, 1);
 			if( iResult!=0 )
 			{
-				//uprintf("ERROR: write_via_buffer: write_enable failed with %d.\n", iResult);
-				DBG_CALL_FAILED_VAL("write_enable", iResult);
+				//uprintf("ERROR: start_buffer_write: HalSPI_SendIdles failed with %d.\n", iResult);
+				DBG_CALL_FAILED_VAL("pfnSendIdle", iResult);
 			}
-			else
-			{
-#if 0
-				iResult = print_status(ptFlash);
-				if( iResult!=0 )
-				{
-#endif
-					/* select slave */
-					ptSpiDev->pfnSelect(ptSpiDev, 1);
+		}
+	}
 
-					/* write buffer to main memory */
+	DEBUGMSG(ZONE_FUNCTION, ("-start_buffer_write(): iResult=%d.\n", iResult));
+	return iResult;
+}
 
-					/* translate the address to the device format */
-					ulDeviceAddress = getDeviceAddress(ptFlash, ulLinearAddress);
 
-					/* first byte of the command is the write bOpcode */
-					aucCmd[0] = ptFlash->tAttributes.ucBufferWriteOpcode;
-					/* byte 1-3 is the address */
-					aucCmd[1] = (unsigned char)((ulDeviceAddress>>16U)&0xffU);
-					aucCmd[2] = (unsigned char)((ulDeviceAddress>> 8U)&0xffU);
-					aucCmd[3] = (unsigned char)( ulDeviceAddress      &0xffU);
+static int write_via_buffer(const FLASHER_SPI_FLASH_T *ptFlash, unsigned long ulLinearAddress, const unsigned char *pabBuffer)
+{
+	int iResult;
 
-					iResult = ptSpiDev->pfnSendData(ptSpiDev, aucCmd, 4);
-					if( iResult!=0 )
-					{
-						//uprintf("ERROR: write_via_buffer: HalSPI_BlockIo failed with %d.\n", iResult);
-						DBG_CALL_FAILED_VAL("pfnSendData", iResult);
-					}
 
-					/* deselect slave */
-					ptSpiDev->pfnSelect(ptSpiDev, 0);
+	DEBUGMSG(ZONE_FUNCTION, ("+write_via_buffer(): ptFlash=0x%08x, ulLinearAddress=0x%08x, pabBuffer=0x%08x\n", ptFlash, ulLinearAddress, pabBuffer));
 
-					if( iResult==0 )
-					{
-						iResult = ptSpiDev->pfnSendIdle(ptSpiDev, 1);
-						if( iResult!=0 )
-						{
-							//uprintf("ERROR: write_via_buffer: HalSPI_SendIdles failed with %d.\n", iResult);
-							DBG_CALL_FAILED_VAL("pfnSendIdle", iResult);
-						}
-						else
-						{
-							/* wait until the write operation is finished */
-							iResult = wait_for_ready(ptFlash);
-							if( iResult!=0 )
-							{
-								//uprintf("ERROR: write_via_buffer: wait_for_ready failed with %d.\n", iResult);
-								DBG_CALL_FAILED_VAL("wait_for_ready", iResult);
-							}
-						}
-					}
-#if 0
-				}
-#endif
+	iResult = fill_buffer(ptFlash, ptFlash->tAttributes.ucBufferFill, pabBuffer);
+	if( iResult==0 )
+	{
+		iResult = start_buffer_write(ptFlash, ptFlash->tAttributes.ucBufferWriteOpcode, ulLinearAddress);
+		if( iResult==0 )
+		{
+			/* wait until the write operation is finished */
+			iResult = wait_for_ready(ptFlash);
+			if( iResult!=0 )
+			{
+				//uprintf("ERROR: write_via_buffer: wait_for_ready failed with %d.\n", iResult);
+				DBG_CALL_FAILED_VAL("wait_for_ready", iResult);
 			}
 		}
 	}
@@ -1599,6 +1805,103 @@ static int write_via_buffer(const FLASHER_SPI_FLASH_T *ptFlash, unsigned long ul
 }
 
 
+/*! write_via_dual_buffer
+*   Write a sequence of pages with alternating SRAM buffers.
+*   The next page is transferred to the free buffer while the device is still
+*   programming the other one. The device is only polled before the next
+*   buffer-to-main-memory command.
+*
+*   \param   ptFlash           Pointer to flash Control Block
+*   \param   ulLinearAddress   linear address of the first page
+*   \param   pabBuffer         data for all pages
+*   \param   ulPages           number of pages to write
+*   \return  iResult           =0 success, <>0 error                         */
+static int write_via_dual_buffer(const FLASHER_SPI_FLASH_T *ptFlash, unsigned long ulLinearAddress, const unsigned char *pabBuffer, unsigned long ulPages)
+{
+	int iResult;
+	int iWaitResult;
+	int iBusy;
+	unsigned int uiBuffer;
+	unsigned long ulPageSize;
+	unsigned char ucFillOpcode;
+	unsigned char ucWriteOpcode;
+
+
+	DEBUGMSG(ZONE_FUNCTION, ("+write_via_dual_buffer(): ptFlash=0x%08x, ulLinearAddress=0x%08x, pabBuffer=0x%08x, ulPages=%d\n", ptFlash, ulLinearAddress, pabBuffer, ulPages));
+
+	ulPageSize = ptFlash->tAttributes.ulPageSize;
+
+	iResult = 0;
+	iBusy = 0;
+	uiBuffer = 0;
+	while( ulPages!=0 )
+	{
+		if( uiBuffer==0 )
+		{
+			ucFillOpcode = ptFlash->tAttributes.ucBufferFill;
+			ucWriteOpcode = ptFlash->tAttributes.ucBufferWriteOpcode;
+		}
+		else
+		{
+			ucFillOpcode = ptFlash->tAttributes.ucBuffer2Fill;
+			ucWriteOpcode = ptFlash->tAttributes.ucBuffer2WriteOpcode;
+		}
+
+		/* Load the free buffer while the device programs the other one. */
+		iResult = fill_buffer(ptFlash, ucFillOpcode, pabBuffer);
+		if( iResult!=0 )
+		{
+			DBG_CALL_FAILED_VAL("fill_buffer", iResult);
+			break;
+		}
+
+		/* Wait until the previous page is programmed. */
+		if( iBusy!=0 )
+		{
+			iBusy = 0;
+			iResult = wait_for_ready(ptFlash);
+			if( iResult!=0 )
+			{
+				DBG_CALL_FAILED_VAL("wait_for_ready", iResult);
+				break;
+			}
+		}
+
+		iResult = start_buffer_write(ptFlash, ucWriteOpcode, ulLinearAddress);
+		if( iResult!=0 )
+		{
+			DBG_CALL_FAILED_VAL("start_buffer_write", iResult);
+			break;
+		}
+		iBusy = 1;
+
+		/* Switch to the other buffer. */
+		uiBuffer ^= 1U;
+
+		ulLinearAddress += ulPageSize;
+		pabBuffer += ulPageSize;
+		--ulPages;
+	}
+
+	/* Do not leave with a running write operation. */
+	if( iBusy!=0 )
+	{
+		iWaitResult = wait_for_ready(ptFlash);
+		if( iWaitResult!=0 )
+		{
+			DBG_CALL_FAILED_VAL("wait_for_ready", iWaitResult);
+			if( iResult==0 )
+			{
+				iResult = iWaitResult;
+			}
+		}
+	}
+
+	DEBUGMSG(ZONE_FUNCTION, ("-write_via_dual_buffer(): iResult=%d.\n", iResult));
+	return iResult;
+}
+
+
 int Drv_SpiWritePage(const FLASHER_SPI_FLASH_T *ptFlash, unsigned long ulLinearAddress, const unsigned char *pucData, size_t sizData)
 {
 	int iResult;
@@ -1649,6 +1952,70 @@ int Drv_SpiWritePage(const FLASHER_SPI_FLASH_T *ptFlash, unsigned long ulLinearA
 }
 
 
+/*! Drv_SpiWritePages
+*   Write a sequence of complete pages.
+*   Devices with two SRAM buffers use them alternately, all other devices
+*   write one page after the other.
+*
+*   \param   ptFlash           Pointer to flash Control Block
+*   \param   ulLinearAddress   linear address of the first page, must be page aligned
+*   \param   pucData           data to write
+*   \param   sizData           number of bytes to write, must be a multiple of the page size
+*   \return  iResult           =0 success, <>0 error                         */
+int Drv_SpiWritePages(const FLASHER_SPI_FLASH_T *ptFlash, unsigned long ulLinearAddress, const unsigned char *pucData, size_t sizData)
+{
+	int iResult;
+	size_t sizPage;
+
+
+	DEBUGMSG(ZONE_FUNCTION, ("+Drv_SpiWritePages(): ptFlash=0x%08x, ulLinearAddress=0x%08x, pucData=0x%08x, sizData=0x%08x\n", ptFlash, ulLinearAddress, pucData, sizData));
+
+	sizPage = ptFlash->tAttributes.ulPageSize;
+	if( (ulLinearAddress%sizPage)!=0 || (sizData%sizPage)!=0 )
+	{
+		DBG_ERROR("startaddress or size is not page aligned.");
+		iResult = -1;
+	}
+	else if( ptFlash->tAttributes.ucPageProgOpcode==0 &&
+	         ptFlash->tAttributes.ucBufferFill!=0 && ptFlash->tAttributes.ucBufferWriteOpcode!=0 &&
+	         ptFlash->tAttributes.ucBuffer2Fill!=0 && ptFlash->tAttributes.ucBuffer2WriteOpcode!=0 )
+	{
+		iResult = write_via_dual_buffer(ptFlash, ulLinearAddress, pucData, sizData/sizPage);
+	}
+	else
+	{
+		iResult = 0;
+		while( sizData!=0 )
+		{
+			iResult = Drv_SpiWritePage(ptFlash, ulLinearAddress, pucData, sizPage);
+			if( iResult!=0 )
+			{
+				break;
+			}
+			ulLinearAddress += sizPage;
+			pucData += sizPage;
+			sizData -= sizPage;
+		}
+	}
+
+	DEBUGMSG(ZONE_FUNCTION, ("-Drv_SpiWritePages(): iResult=%d.\n", iResult));
+	return iResult;
+}
+
+
+/*! Drv_SpiHasErrorStatus
+*   Check if the device reports failed erase and program operations in a
+*   status register. The result of an erase operation can be trusted without
+*   reading back the complete area in this case.
+*
+*   \param   ptFlash           Pointer to flash Control Block
+*   \return  !=0 if the device reports errors, 0 if not                    */
+int Drv_SpiHasErrorStatus(const FLASHER_SPI_FLASH_T *ptFlash)
+{
+	return ( ptFlash->tAttributes.ucErrorStatusOpcode!=0 && ptFlash->tAttributes.ucErrorStatusMask!=0 );
+}
+
+
 typedef struct ADR_MODE_NAME_STRUCT
 {
 	SPIFLASH_ADR_T tAdrMode;
@@ -57,6 +57,9 @@ typedef struct FLASHER_SPI_FLASH_STRUCT
 	unsigned int uiSectorAdrShift;          /**< @brief bit shift for one sector, 0 means no page / byte split.                    */
 } FLASHER_SPI_FLASH_T;
 
+/* The device reported a failed erase or program operation in its status. */
+#define SPI_FLASH_STATUS_ERROR -2
+
 /*-----------------------------------*/
 
 int Drv_SpiInitializeFlash        (const FLASHER_SPI_CONFIGURATION_T *ptSpiCfg, FLASHER_SPI_FLASH_T *ptFlash, char *pcBufferEnd);
@@ -66,11 +69,17 @@ int Drv_SpiEraseFlashMultiSectors (const FLASHER_SPI_FLASH_T *ptFlash, unsigned
 int Drv_SpiEraseFlashComplete     (const FLASHER_SPI_FLASH_T *ptFlash);
 int Drv_SpiWriteFlashPages        (const FLASHER_SPI_FLASH_T *ptFlash, unsigned long ulOffs, const unsigned char *pabSrc, unsigned long ulNum);
 int Drv_SpiReadFlash              (const FLASHER_SPI_FLASH_T *ptFlash, unsigned long ulLinearAddress, unsigned char       *pucData, size_t sizData);
+int Drv_SpiReadFlashStart         (const FLASHER_SPI_FLASH_T *ptFlash, unsigned long ulLinearAddress);
+int Drv_SpiReadFlashContinue      (const FLASHER_SPI_FLASH_T *ptFlash, unsigned char       *pucData, size_t sizData);
+int Drv_SpiReadFlashStop          (const FLASHER_SPI_FLASH_T *ptFlash);
 int Drv_SpiEraseAndWritePage      (const FLASHER_SPI_FLASH_T *ptFlash, unsigned long ulLinearAddress, const unsigned char *pucData, size_t sizData);
 int Drv_SpiWritePage              (const FLASHER_SPI_FLASH_T *ptFlash, unsigned long ulLinearAddress, const unsigned char *pucData, size_t sizData);
+int Drv_SpiWritePages             (const FLASHER_SPI_FLASH_T *ptFlash, unsigned long ulLinearAddress, const unsigned char *pucData, size_t sizData);
 
 const char *spi_flash_get_adr_mode_name(SPIFLASH_ADR_T tAdrMode);
 
+int Drv_SpiHasErrorStatus         (const FLASHER_SPI_FLASH_T *ptFlash);
+
 int board_get_spi_driver(const FLASHER_SPI_CONFIGURATION_T *ptSpiCfg, FLASHER_SPI_CFG_T *ptSpiDev);
 
 #endif
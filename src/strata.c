@@ -21,6 +21,9 @@
 
 #include "strata.h"
 #include <string.h>
+#include "delay.h"
+#include "mem_check.h"
+#include "uprintf.h"
 
 
 /* Data bits to read indicating the status of an FLASH operation. */
@@ -32,6 +35,7 @@
 #define DRV_INTEL_SR2_PRG_SUS (0x04)  /* Program suspended */
 #define DRV_INTEL_SR1_DEV_PRT (0x02)  /* Sector locked */
 #define DRV_INTEL_SR0_RES     (0x01)  /* reset */
+#define DRV_INTEL_SR0_BEFP    (0x01)  /* BEFP buffer busy */
 
 #define MFGCODE_INTEL           0x89  /* Intel's flash manufacturing code. */
 
@@ -52,11 +56,18 @@
 #define READ_ARRAY                    0xFF
 #define SET_BLOCK_LOCK_CONFIRM	0x01
 #define CLEAR_BLOCK_LOCK_CONFIRM	0xD0
+#define BEFP_SETUP                    0x80
+#define BEFP_CONFIRM                  0xD0
+#define BEFP_EXIT                     0xFFFFFFFFU  /* all ones written outside of the block */
+
+/* Wait this long after the BEFP setup before checking the status. */
+#define BEFP_SETUP_DELAY_US           5
 
 
 static FLASH_ERRORS_E FlashWaitStatusDone (const FLASH_DEVICE_T *ptFlashDev, unsigned long ulSector);
 static void           FlashWriteCommand   (const FLASH_DEVICE_T *ptFlashDev, unsigned long ulSector, unsigned long ulOffset, unsigned long ulCmd);
 static int            FlashIsset          (const FLASH_DEVICE_T *ptFlashDev, unsigned long ulSector, unsigned long ulOffset, unsigned long ulCmd);
+static int            FlashIsClear        (const FLASH_DEVICE_T *ptFlashDev, unsigned long ulSector, unsigned long ulOffset, unsigned long ulCmd);
 
 
 static FLASH_ERRORS_E FlashReset(const FLASH_DEVICE_T *ptFlashDev, unsigned long ulSector);
@@ -70,15 +81,17 @@ static const FLASH_FUNCTIONS_T s_tIntelStrataFuncs =
 {
   FlashReset,
   FlashErase,
+  NULL,
   FlashEraseAll,
   FlashProgram,
   FlashLock,
   FlashUnlock
 };
 
-int IntelIdentifyFlash(FLASH_DEVICE_T *ptFlashDev)
+int IntelIdentifyFlash(FLASH_DEVICE_T *ptFlashDev, const PARFLASH_CONFIGURATION_T *ptCfg)
 {
   int fRet = FALSE;
+  const CFI_EXTQUERY_HEADER_T *ptExtQry;
 
   /* try to identify Strata Flash */
   FlashWriteCommand(ptFlashDev, 0, 0, READ_IDENT_CMD);
@@ -95,6 +108,29 @@ int IntelIdentifyFlash(FLASH_DEVICE_T *ptFlashDev)
     fRet = TRUE;  
   }
 
+  /* BEFP is opt-in. It came with the primary extended query V1.4 (P30 and
+     newer), older parts like the J3 do not have it. It needs a 16 bit
+     device, a write buffer and a second block to exit the mode.
+   */
+  ptFlashDev->fBufferedEFP = FALSE;
+  if( fRet==TRUE && (ptCfg->ulFlags & PARFLASH_FLAG_BEFP)!=0 )
+  {
+    ptExtQry = &(ptFlashDev->tPriExtQuery.tHeader);
+    if( ptFlashDev->fPriExtQueryValid!=0 &&
+        (ptExtQry->bMajorVer>'1' || (ptExtQry->bMajorVer=='1' && ptExtQry->bMinorVer>='4')) &&
+        ptFlashDev->tBits!=BUS_WIDTH_8Bit &&
+        ptFlashDev->ulMaxBufferWriteSize>1 &&
+        ptFlashDev->ulSectorCnt>1 )
+    {
+      uprintf(". Using Buffered Enhanced Factory Programming for blank blocks.\n");
+      ptFlashDev->fBufferedEFP = TRUE;
+    }
+    else
+    {
+      uprintf(". Buffered Enhanced Factory Programming is not supported.\n");
+    }
+  }
+
   return fRet;
 }
 
@@ -163,6 +199,125 @@ static FLASH_ERRORS_E FlashEraseAll(const FLASH_DEVICE_T *ptFlashDev)
 }
 
 
+/*! Program a blank area in one block with Buffered Enhanced Factory Programming
+*
+*   BEFP streams one complete buffer after the other. It waits only until
+*   the device accepted the last buffer and checks the status once at the
+*   end. The last buffer is padded with 0xff. The area must start at a
+*   buffer boundary and all complete buffers must be erased.
+*
+*   \param   ptFlashDev       Pointer to the FLASH control Block
+*   \param   ulSector         The block to program
+*   \param   ulOffset         Offset in the block, aligned to the buffer size
+*   \param   pucData          Data pointer
+*   \param   ulLength         Length of data to write, must not cross the block
+*
+*   \return  eFLASH_NO_ERROR  on success, eFLASH_ABORTED if the device did not enter BEFP
+*/
+static FLASH_ERRORS_E FlashProgramBEFP(const FLASH_DEVICE_T *ptFlashDev, unsigned long ulSector, unsigned long ulOffset, const unsigned char *pucData, unsigned long ulLength)
+{
+  FLASH_ERRORS_E eRet = eFLASH_NO_ERROR;
+  FLASH_ERRORS_E eStatus;
+  unsigned long  ulMaxBuffer;
+  unsigned long  ulWriteSize;
+  unsigned long  ulExitSector;
+  VADR_T tWriteAdr;
+  VADR_T tPadEndAdr;
+  CADR_T tSrcEndAdr;
+  CADR_T tSrcAdr;
+
+
+  ulMaxBuffer = ptFlashDev->ulMaxBufferWriteSize;
+  if(ptFlashDev->fPaired)
+    ulMaxBuffer *= 2;
+
+  /* Leave BEFP with a write to another block. */
+  ulExitSector = ulSector + 1;
+  if(ulExitSector >= ptFlashDev->ulSectorCnt)
+    ulExitSector = ulSector - 1;
+
+  FlashWriteCommand(ptFlashDev, ulSector, ulOffset, BEFP_SETUP);
+  FlashWriteCommand(ptFlashDev, ulSector, ulOffset, BEFP_CONFIRM);
+  delay_us(BEFP_SETUP_DELAY_US);
+
+  /* SR7 stays clear as long as the device is in BEFP. */
+  if(!FlashIsClear(ptFlashDev, ulSector, 0, DRV_INTEL_SR7_WRT))
+  {
+    /* The setup failed, e.g. no VPPH or the block is locked. */
+    FlashWaitStatusDone(ptFlashDev, ulSector);
+    FlashWriteCommand(ptFlashDev, ulSector, 0, CLEAR_STATUS_REGISTER);
+    FlashReset(ptFlashDev, ulSector);
+    return eFLASH_ABORTED;
+  }
+
+  tWriteAdr.puc = ptFlashDev->pucFlashBase + cfi_get_sector_offset(ptFlashDev, ulSector) + ulOffset;
+  tSrcAdr.puc = pucData;
+
+  while(ulLength > 0)
+  {
+    /* Wait until the buffer is free. The device left BEFP if SR7 is set. */
+    while(!FlashIsClear(ptFlashDev, ulSector, 0, DRV_INTEL_SR0_BEFP))
+    {
+      if(!FlashIsClear(ptFlashDev, ulSector, 0, DRV_INTEL_SR7_WRT))
+      {
+        eRet = eFLASH_DEVICE_FAILED;
+        break;
+      }
+    }
+    if(eFLASH_NO_ERROR != eRet)
+      break;
+
+    ulWriteSize = ulLength;
+    if(ulWriteSize > ulMaxBuffer)
+      ulWriteSize = ulMaxBuffer;
+
+    /* fill the complete buffer, the rest is padded with 0xff */
+    tSrcEndAdr.puc = tSrcAdr.puc + ulWriteSize;
+    tPadEndAdr.puc = tWriteAdr.puc + ulMaxBuffer;
+    while(tWriteAdr.puc != tPadEndAdr.puc)
+    {
+      switch(ptFlashDev->tBits)
+      {
+      case BUS_WIDTH_8Bit:
+        *tWriteAdr.puc++ = (tSrcAdr.puc != tSrcEndAdr.puc) ? *tSrcAdr.puc++ : 0xffU;
+        break;
+
+      case BUS_WIDTH_16Bit:
+        *tWriteAdr.pus++ = (tSrcAdr.puc != tSrcEndAdr.puc) ? *tSrcAdr.pus++ : 0xffffU;
+        break;
+
+      case BUS_WIDTH_32Bit:
+        *tWriteAdr.pul++ = (tSrcAdr.puc != tSrcEndAdr.puc) ? *tSrcAdr.pul++ : 0xffffffffU;
+        break;
+      }
+    }
+
+    ulLength -= ulWriteSize;
+  }
+
+  if(eFLASH_NO_ERROR == eRet)
+  {
+    /* Wait until the last buffer is programmed. */
+    while(!FlashIsClear(ptFlashDev, ulSector, 0, DRV_INTEL_SR0_BEFP) &&
+          FlashIsClear(ptFlashDev, ulSector, 0, DRV_INTEL_SR7_WRT))
+      ;
+
+    FlashWriteCommand(ptFlashDev, ulExitSector, 0, BEFP_EXIT);
+  }
+
+  /* Full Status Check, keep an early exit as an error */
+  eStatus = FlashWaitStatusDone(ptFlashDev, ulSector);
+  if(eFLASH_NO_ERROR == eRet)
+    eRet = eStatus;
+  if(eFLASH_NO_ERROR != eRet)
+    FlashWriteCommand(ptFlashDev, ulSector, 0, CLEAR_STATUS_REGISTER);
+
+  FlashReset(ptFlashDev, ulSector);
+
+  return eRet;
+}
+
+
 /*! Program flash
 *
 *   \param   ptFlashDev       Pointer to the FLASH control Block
@@ -177,22 +332,29 @@ static FLASH_ERRORS_E FlashProgram(const FLASH_DEVICE_T *ptFlashDev, unsigned lo
   FLASH_ERRORS_E eRet             = eFLASH_NO_ERROR;
   unsigned long  ulCurrentSector;
   unsigned long  ulCurrentOffset;   
+  SECTOR_INFO_T  tSector;
   VADR_T tWriteAdr;
   CADR_T tSrcEndAdr;
   CADR_T tSrcAdr;
+  int fUseBEFP;
+  int fCheckBEFP;
   tSrcAdr.puc = (const unsigned char*)pvData;
 
   /* Determine the start sector and offset inside the sector */
-  ulCurrentSector = cfi_find_matching_sector_index(ptFlashDev, ulStartOffset);
+  ulCurrentSector = cfi_find_matching_sector(ptFlashDev, ulStartOffset, &tSector);
   if (ulCurrentSector == 0xffffffffU)
   {
     return eFLASH_INVALID_PARAMETER;
   }
-  ulCurrentOffset = ulStartOffset - ptFlashDev->atSectors[ulCurrentSector].ulOffset;
+  ulCurrentOffset = ulStartOffset - tSector.ulOffset;
 
   FlashWriteCommand(ptFlashDev, ulCurrentSector, 0, CLEAR_STATUS_REGISTER);
   FlashReset(ptFlashDev, ulCurrentSector);
 
+  /* Check for BEFP at the start and at each new block. The flash is in read array mode there. */
+  fUseBEFP = ptFlashDev->fBufferedEFP;
+  fCheckBEFP = TRUE;
+
   while(ulLength > 0)
   {
     /* determine number of bytes to write */
@@ -203,14 +365,55 @@ static FLASH_ERRORS_E FlashProgram(const FLASH_DEVICE_T *ptFlashDev, unsigned lo
     if(ptFlashDev->fPaired)
       ulMaxBuffer *= 2;
 
+    if(fUseBEFP && fCheckBEFP && (ulCurrentOffset & (ulMaxBuffer - 1)) == 0)
+    {
+      fCheckBEFP = FALSE;
+
+      ulWriteSize = tSector.ulSize - ulCurrentOffset;
+      if(ulWriteSize > ulLength)
+        ulWriteSize = ulLength;
+
+      /* BEFP writes complete buffers, so all of them must be blank. */
+      if(mem_check_is_pattern(ptFlashDev->pucFlashBase + tSector.ulOffset + ulCurrentOffset, (ulWriteSize + ulMaxBuffer - 1) & ~(ulMaxBuffer - 1), 0xffU))
+      {
+        eRet = FlashProgramBEFP(ptFlashDev, ulCurrentSector, ulCurrentOffset, tSrcAdr.puc, ulWriteSize);
+        if(eFLASH_ABORTED == eRet)
+        {
+          /* Fall back to buffered programming for the rest of the data. */
+          fUseBEFP = FALSE;
+          eRet = eFLASH_NO_ERROR;
+        }
+        else if(eFLASH_NO_ERROR != eRet)
+        {
+          break;
+        }
+        else
+        {
+          tSrcAdr.puc     += ulWriteSize;
+          ulCurrentOffset += ulWriteSize;
+          ulLength        -= ulWriteSize;
+
+          /* wrap around */
+          if(ulCurrentOffset == tSector.ulSize)
+          {
+            ulCurrentOffset = 0;
+            ++ulCurrentSector;
+            cfi_get_sector(ptFlashDev, ulCurrentSector, &tSector);
+            fCheckBEFP = TRUE;
+          }
+          continue;
+        }
+      }
+    }
+
     if(ulLength > ulMaxBuffer)
       ulWriteSize = ulMaxBuffer;
     else
       ulWriteSize = ulLength;
 
-    if((ulCurrentOffset + ulWriteSize) > ptFlashDev->atSectors[ulCurrentSector].ulSize)
+    if((ulCurrentOffset + ulWriteSize) > tSector.ulSize)
     {
-      ulWriteSize = ptFlashDev->atSectors[ulCurrentSector].ulSize - ulCurrentOffset;
+      ulWriteSize = tSector.ulSize - ulCurrentOffset;
     }
 
     /* send write buffer command */
@@ -236,7 +439,7 @@ static FLASH_ERRORS_E FlashProgram(const FLASH_DEVICE_T *ptFlashDev, unsigned lo
        
     /* fill the buffer */ 
     tWriteAdr.puc = ptFlashDev->pucFlashBase + 
-                                   ptFlashDev->atSectors[ulCurrentSector].ulOffset + 
+                                   tSector.ulOffset + 
                                    ulCurrentOffset;
                                                                       
     tSrcEndAdr.puc = tSrcAdr.puc + ulWriteSize;
@@ -271,12 +474,14 @@ static FLASH_ERRORS_E FlashProgram(const FLASH_DEVICE_T *ptFlashDev, unsigned lo
     }
 
     /* wrap around */
-    if(ulCurrentOffset == ptFlashDev->atSectors[ulCurrentSector].ulSize)    
+    if(ulCurrentOffset == tSector.ulSize)    
     {
       FlashWriteCommand(ptFlashDev, ulCurrentSector, 0, READ_ARRAY);
 
       ulCurrentOffset = 0;
       ++ulCurrentSector;
+      cfi_get_sector(ptFlashDev, ulCurrentSector, &tSector);
+      fCheckBEFP = TRUE;
     }
   }
 
@@ -342,7 +547,7 @@ void FlashWriteCommand(const FLASH_DEVICE_T *ptFlashDev, unsigned long ulSector,
 	} uAdr;
 
 
-	uAdr.puc = ptFlashDev->pucFlashBase + ptFlashDev->atSectors[ulSector].ulOffset + ulOffset;
+	uAdr.puc = ptFlashDev->pucFlashBase + cfi_get_sector_offset(ptFlashDev, ulSector) + ulOffset;
 
 	switch( ptFlashDev->tBits )
 	{
@@ -384,7 +589,7 @@ void FlashWriteCommand(const FLASH_DEVICE_T *ptFlashDev, unsigned long ulSector,
 int FlashIsset(const FLASH_DEVICE_T *ptFlashDev, unsigned long ulSector, unsigned long ulOffset, unsigned long ulCmd)
 {
   int iRet = FALSE;
-  volatile void* pvReadAddr = ptFlashDev->pucFlashBase + ptFlashDev->atSectors[ulSector].ulOffset + ulOffset;
+  volatile void* pvReadAddr = ptFlashDev->pucFlashBase + cfi_get_sector_offset(ptFlashDev, ulSector) + ulOffset;
   
   switch(ptFlashDev->tBits)
   {
@@ -425,6 +630,59 @@ int FlashIsset(const FLASH_DEVICE_T *ptFlashDev, unsigned long ulSector, unsigne
   return iRet;
 }
 
+/*! Checks if a given flag (bCmd) is clear on all FLASH devices
+*
+*   \param   ptFlashDev  Pointer to the FLASH control Block
+*   \param   ulSector    FLASH sector number
+*   \param   ulOffset    Offset address in the actual FLASH sector
+*   \param   bCmd        Flag value to be checked
+*
+*   \return  TRUE        if the flag is clear
+*/
+static int FlashIsClear(const FLASH_DEVICE_T *ptFlashDev, unsigned long ulSector, unsigned long ulOffset, unsigned long ulCmd)
+{
+  int iRet = FALSE;
+  volatile void* pvReadAddr = ptFlashDev->pucFlashBase + cfi_get_sector_offset(ptFlashDev, ulSector) + ulOffset;
+  
+  switch(ptFlashDev->tBits)
+  {
+  case BUS_WIDTH_8Bit:
+    {
+      unsigned char ucValue       = *(volatile unsigned char*)pvReadAddr;
+      if ((ucValue & (unsigned char) ulCmd) == 0)
+        iRet = TRUE;
+    }
+    break;
+  case BUS_WIDTH_16Bit:
+    {
+      unsigned short usValue    = *(volatile unsigned short*)pvReadAddr;
+      unsigned short usCheckCmd = (unsigned short) ulCmd;
+
+      if(ptFlashDev->fPaired)
+        usCheckCmd |= (unsigned short)(ulCmd << 8);
+
+      if((usValue & usCheckCmd) == 0)
+        iRet = TRUE;
+    }
+    break;
+
+  case BUS_WIDTH_32Bit:
+    {
+      unsigned long ulValue    = *(volatile unsigned long*)pvReadAddr;
+      unsigned long ulCheckCmd = ulCmd;
+
+      if(ptFlashDev->fPaired)
+        ulCheckCmd |= ulCmd << 16;
+
+      if((ulValue & ulCheckCmd) == 0)
+        iRet = TRUE;
+    }
+    break;
+  }
+
+  return iRet;
+}
+
 /*! Wait until FLASH has accepted a state change
 *
 *   \param   ptFlashDev  Pointer to the FLASH control Block
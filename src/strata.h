@@ -24,7 +24,7 @@
 #ifndef __STRATA_H__
 #define __STRATA_H__
        
-int IntelIdentifyFlash(FLASH_DEVICE_T *ptFlashDev);
+int IntelIdentifyFlash(FLASH_DEVICE_T *ptFlashDev, const PARFLASH_CONFIGURATION_T *ptCfg);
 
 #endif  /* __STRATA_H__ */
 
@@ -52,6 +52,39 @@ OPERATION_MODE_GetEraseArea      = ${OPERATION_MODE_GetEraseArea}     -- Expand
 OPERATION_MODE_GetBoardInfo      = ${OPERATION_MODE_GetBoardInfo}     -- Get bus and unit information.
 OPERATION_MODE_EasyErase         = ${OPERATION_MODE_EasyErase}     -- A combination of GetEraseArea, IsErased and Erase.
 OPERATION_MODE_SpiMacroPlayer    = ${OPERATION_MODE_SpiMacroPlayer}    -- A debug mode to send commands to a SPI flash.
+OPERATION_MODE_EraseFlashVerify  = ${OPERATION_MODE_EraseFlashVerify}    -- Erase if necessary, flash and verify in one call.
+OPERATION_MODE_Batch             = ${OPERATION_MODE_Batch}    -- Execute a list of operations.
+OPERATION_MODE_FlashStream       = ${OPERATION_MODE_FlashStream}    -- Flash data from a ring buffer which is filled while the flasher runs.
+OPERATION_MODE_GetEraseMap       = ${OPERATION_MODE_GetEraseMap}    -- Get a bitmap of the erase units which are not erased.
+OPERATION_MODE_Patch             = ${OPERATION_MODE_Patch}    -- Rebuild an area from its current contents and a delta.
+OPERATION_MODE_Fill              = ${OPERATION_MODE_Fill}    -- Write a repeating pattern to an area.
+OPERATION_MODE_Copy              = ${OPERATION_MODE_Copy}    -- Copy an area inside a device or to another device.
+
+
+ERASEFLASHVERIFY_RESULT_Ok              = ${ERASEFLASHVERIFY_RESULT_Ok}
+ERASEFLASHVERIFY_RESULT_EraseFailed     = ${ERASEFLASHVERIFY_RESULT_EraseFailed}
+ERASEFLASHVERIFY_RESULT_FlashFailed     = ${ERASEFLASHVERIFY_RESULT_FlashFailed}
+ERASEFLASHVERIFY_RESULT_VerifyFailed    = ${ERASEFLASHVERIFY_RESULT_VerifyFailed}
+ERASEFLASHVERIFY_FLAG_TrustEraseStatus  = ${ERASEFLASHVERIFY_FLAG_TrustEraseStatus}
+ERASEFLASHVERIFY_FLAG_Sparse            = ${ERASEFLASHVERIFY_FLAG_Sparse}
+
+BATCH_FLAG_ContinueOnError       = ${BATCH_FLAG_ContinueOnError}
+BATCH_RESULT_NotExecuted         = ${BATCH_RESULT_NotExecuted}
+SIZEOF_FLASHER_PARAMETER         = ${SIZEOF_tFlasherInputParameter_STRUCT}
+
+PATCH_OP_Copy                    = ${PATCH_OP_Copy}
+PATCH_OP_Literal                 = ${PATCH_OP_Literal}
+FILL_PATTERN_MAX                 = ${FILL_PATTERN_MAX}
+COPY_FLAG_Erase                  = ${COPY_FLAG_Erase}
+PARFLASH_FLAG_BEFP               = ${PARFLASH_FLAG_BEFP}     -- Program blank blocks with Buffered Enhanced Factory Programming.
+
+
+CHECKSUM_ALGORITHM_SHA1          = ${CHECKSUM_ALGORITHM_SHA1}     -- SHA1, 20 bytes
+CHECKSUM_ALGORITHM_CRC32         = ${CHECKSUM_ALGORITHM_CRC32}     -- CRC32 like zlib, 4 bytes big endian
+CHECKSUM_ALGORITHM_CRC32C        = ${CHECKSUM_ALGORITHM_CRC32C}     -- CRC32C (Castagnoli), 4 bytes big endian
+
+CHECKSUM_FLAG_Tree               = ${CHECKSUM_FLAG_Tree}     -- The block checksums are the leaves of a hash tree.
+CHECKSUM_TREE_NODE_PREFIX        = ${CHECKSUM_TREE_NODE_PREFIX}     -- The prefix of the inner nodes of a hash tree.
 
 
 MSK_SQI_CFG_IDLE_IO1_OE          = ${MSK_SQI_CFG_IDLE_IO1_OE}
@@ -269,6 +302,13 @@ function download(tPlugin, strPrefix, fnCallbackProgress)
 
 	local aAttr = get_flasher_binary_attributes(strFlasherBin)
 	aAttr.strBinaryName = strFlasherBin
+
+	-- The flashers for the netX 90 are built without SHA1.
+	if iChiptype==romloader.ROMLOADER_CHIPTYP_NETX90_MPW or iChiptype==romloader.ROMLOADER_CHIPTYP_NETX90 or iChiptype==romloader.ROMLOADER_CHIPTYP_NETX90B or iChiptype==romloader.ROMLOADER_CHIPTYP_NETX90C or iChiptype==romloader.ROMLOADER_CHIPTYP_NETX90D then
+		aAttr.tHashAlgorithm = CHECKSUM_ALGORITHM_CRC32
+	else
+		aAttr.tHashAlgorithm = CHECKSUM_ALGORITHM_SHA1
+	end
 	
 	print(string.format("downloading to 0x%08x", aAttr.ulLoadAddress))
 	write_image(tPlugin, aAttr.ulLoadAddress, strFlasherBin, fnCallbackProgress)
@@ -439,6 +479,12 @@ function detect(tPlugin, aAttr, tBus, ulUnit, ulChipSelect, fnCallbackMessage, f
 		local ulAllowedBusWidths = atParameter.ulAllowedBusWidths
 		ulAllowedBusWidths = ulAllowedBusWidths or 0
 		
+		-- Buffered Enhanced Factory Programming is opt-in. It is only used if the flash supports it.
+		local ulFlags = 0
+		if atParameter.fBufferedEFP==true then
+			ulFlags = ulFlags + PARFLASH_FLAG_BEFP
+		end
+		
 		aulParameter =
 		{
 			OPERATION_MODE_Detect,                -- operation mode: detect
@@ -446,7 +492,7 @@ function detect(tPlugin, aAttr, tBus, ulUnit, ulChipSelect, fnCallbackMessage, f
 			ulUnit,                               -- unit
 			ulChipSelect,                         -- chip select
 			ulAllowedBusWidths,                   -- the allowed bus widths
-			0,                                    -- reserved
+			ulFlags,                              -- flags
 			0,                                    -- reserved
 			0,                                    -- reserved
 			0,                                    -- reserved
@@ -675,31 +721,90 @@ end
 ---------------------------------------------------------------------------------
 
 -- Writes data which has been loaded into the buffer at ulDataAddress to ulStartAddr in the flash.
-function flash(tPlugin, aAttr, ulStartAdr, ulDataByteSize, ulDataAddress, fnCallbackMessage, fnCallbackProgress)
+-- If ulCompressedSize is set, the buffer at ulCompressedAddress holds an
+-- LZ4 block which is unpacked to ulDataAddress before flashing.
+function flash(tPlugin, aAttr, ulStartAdr, ulDataByteSize, ulDataAddress, fnCallbackMessage, fnCallbackProgress, ulCompressedAddress, ulCompressedSize)
 	local aulParameter =
 	{
 		OPERATION_MODE_Flash,
 		aAttr.ulDeviceDesc,
 		ulStartAdr,
 		ulDataByteSize,
-		ulDataAddress
+		ulDataAddress,
+		ulCompressedAddress or 0,
+		ulCompressedSize or 0
 	}
 	local ulValue = callFlasher(tPlugin, aAttr, aulParameter, fnCallbackMessage, fnCallbackProgress)
 	return ulValue == 0
 end
 
+-- Erases the area [ulEraseStart, ulEraseEnd[ if it is not empty, writes the
+-- data in the buffer at ulDataAddress to ulStartAdr and verifies it. All
+-- this is done in one call. Set ulEraseStart and ulEraseEnd to 0 to skip
+-- the erase.
+-- If ulCompressedSize is set, the data is unpacked from the LZ4 block at
+-- ulCompressedAddress to ulDataAddress first.
+-- If ulExtentsAddress is set, the data is a list of extents (see
+-- buildSparseExtents). The flasher builds the data at ulDataAddress from
+-- it, writes only the extents and verifies the complete area.
+-- Returns true if all steps were successful, the result code of the flasher
+-- (one of the ERASEFLASHVERIFY_RESULT_* values) and true if the area was
+-- erased.
+function eraseFlashVerify(tPlugin, aAttr, ulStartAdr, ulDataByteSize, ulDataAddress, ulEraseStart, ulEraseEnd, fnCallbackMessage, fnCallbackProgress, ulCompressedAddress, ulCompressedSize, ulExtentsAddress, ulExtentsSize)
+	local ulFlags = 0
+	if TRUST_ERASE_STATUS==true then
+		ulFlags = ulFlags + ERASEFLASHVERIFY_FLAG_TrustEraseStatus
+	end
+	if ulExtentsAddress~=nil then
+		ulFlags = ulFlags + ERASEFLASHVERIFY_FLAG_Sparse
+	end
+	
+	local aulParameter =
+	{
+		OPERATION_MODE_EraseFlashVerify,
+		aAttr.ulDeviceDesc,
+		ulStartAdr,
+		ulDataByteSize,
+		ulDataAddress,
+		ulEraseStart,
+		ulEraseEnd,
+		ulFlags,
+		ERASEFLASHVERIFY_RESULT_EraseFailed,   -- result, set by the flasher
+		0,                                     -- erased flag, set by the flasher
+		ulCompressedAddress or 0,
+		ulCompressedSize or 0,
+		ulExtentsAddress or 0,
+		ulExtentsSize or 0
+	}
+	local ulValue = callFlasher(tPlugin, aAttr, aulParameter, fnCallbackMessage, fnCallbackProgress)
+	local tResult = tPlugin:read_data32(aAttr.ulParameter+0x30)
+	local fErased = (tPlugin:read_data32(aAttr.ulParameter+0x34)~=0)
+	
+	return (ulValue==0 and tResult==ERASEFLASHVERIFY_RESULT_Ok), tResult, fErased
+end
+
 -- Reads data from flash to RAM
-function read(tPlugin, aAttr, ulFlashStartOffset, ulFlashEndOffset, ulBufferAddress, fnCallbackMessage, fnCallbackProgress)
+-- If ulCompressedMax is set, the flasher packs the data as an LZ4 block to
+-- ulCompressedAddress. The second return value is the size of the block. It
+-- is 0 if the block did not fit, then the data is at ulBufferAddress.
+function read(tPlugin, aAttr, ulFlashStartOffset, ulFlashEndOffset, ulBufferAddress, fnCallbackMessage, fnCallbackProgress, ulCompressedAddress, ulCompressedMax)
 	local aulParameter =
 	{
 		OPERATION_MODE_Read,
 		aAttr.ulDeviceDesc,
 		ulFlashStartOffset,
 		ulFlashEndOffset,
-		ulBufferAddress
+		ulBufferAddress,
+		ulCompressedAddress or 0,
+		ulCompressedMax or 0,
+		0                                      -- compressed size, set by the flasher
 	}
 	local ulValue = callFlasher(tPlugin, aAttr, aulParameter, fnCallbackMessage, fnCallbackProgress)
-	return ulValue == 0
+	local ulCompressedSize = 0
+	if ulValue==0 and ulCompressedMax~=nil and ulCompressedMax~=0 then
+		ulCompressedSize = tPlugin:read_data32(aAttr.ulParameter+0x2c)
+	end
+	return ulValue == 0, ulCompressedSize
 end
 
 
@@ -712,7 +817,9 @@ function verify(tPlugin, aAttr, ulFlashStartOffset, ulFlashEndOffset, ulBufferAd
 		aAttr.ulDeviceDesc,
 		ulFlashStartOffset,
 		ulFlashEndOffset,
-		ulBufferAddress
+		ulBufferAddress,
+		0,                                     -- no report buffer, stop at the first difference
+		0
 	}
 	local ulValue = callFlasher(tPlugin, aAttr, aulParameter, fnCallbackMessage, fnCallbackProgress)
 	
@@ -725,26 +832,301 @@ function verify(tPlugin, aAttr, ulFlashStartOffset, ulFlashEndOffset, ulBufferAd
 end
 
 
--- Computes the SHA1 hash over data in the flash.
-function hash(tPlugin, aAttr, ulFlashStartOffset, ulFlashEndOffset, fnCallbackMessage, fnCallbackProgress)
+-- Compares data in flash to RAM and collects all differences.
+-- The flasher writes a list of the different areas to the report buffer at
+-- ulReportAddress. The address must be aligned to 4 bytes.
+-- Returns true if the data is equal and a list of the different areas as
+-- {ulStart, ulEnd} pairs. The list is nil if an error occurred.
+-- If the report buffer is too small, the last area covers all remaining
+-- differences.
+function verify_report(tPlugin, aAttr, ulFlashStartOffset, ulFlashEndOffset, ulBufferAddress, ulReportAddress, ulReportSize, fnCallbackMessage, fnCallbackProgress)
+	local atRanges = nil
+	local aulParameter =
+	{
+		OPERATION_MODE_Verify,
+		aAttr.ulDeviceDesc,
+		ulFlashStartOffset,
+		ulFlashEndOffset,
+		ulBufferAddress,
+		ulReportAddress,
+		ulReportSize
+	}
+	callFlasher(tPlugin, aAttr, aulParameter, fnCallbackMessage, fnCallbackProgress)
+	
+	-- The number of areas is 0xffffffff if the verify did not finish.
+	local ulRanges = tPlugin:read_data32(ulReportAddress)
+	if ulRanges~=0xffffffff then
+		atRanges = {}
+		for uiCnt=0,ulRanges-1 do
+			local ulStart = tPlugin:read_data32(ulReportAddress + 4 + 8*uiCnt)
+			local ulEnd = tPlugin:read_data32(ulReportAddress + 8 + 8*uiCnt)
+			table.insert(atRanges, {ulStart, ulEnd})
+		end
+	end
+	
+	return (atRanges~=nil and #atRanges==0), atRanges
+end
+
+
+-- The algorithm used by hash, hashArea and hashData.
+-- The CRC algorithms are a lot faster than SHA1 on the netX. They are good
+-- enough to check if the data in the flash matches a file.
+-- HASH_ALGORITHM = nil selects the algorithm by the chip type. This is SHA1
+-- if the flasher for the chip has it and CRC32 otherwise. Set it to one of
+-- the CHECKSUM_ALGORITHM_* values to force an algorithm.
+HASH_ALGORITHM = nil
+
+local atHashAlgorithms = {
+	[CHECKSUM_ALGORITHM_SHA1]   = { strName="SHA1",   sizHash=20 },
+	[CHECKSUM_ALGORITHM_CRC32]  = { strName="CRC32",  sizHash=4, ulPolynomial=0xedb88320 },
+	[CHECKSUM_ALGORITHM_CRC32C] = { strName="CRC32C", sizHash=4, ulPolynomial=0x82f63b78 },
+}
+
+-- Returns the default hash algorithm for the flasher in aAttr.
+-- Without aAttr the default is SHA1.
+function getHashAlgorithm(aAttr)
+	return HASH_ALGORITHM or (aAttr and aAttr.tHashAlgorithm) or CHECKSUM_ALGORITHM_SHA1
+end
+
+-- Returns the name of a hash algorithm. The default is getHashAlgorithm().
+function getHashName(tAlgorithm)
+	local tAttr = atHashAlgorithms[tAlgorithm or getHashAlgorithm()]
+	return tAttr and tAttr.strName or "unknown"
+end
+
+
+-- Computes the hash over data in the flash.
+-- tAlgorithm is optional, the default is getHashAlgorithm(aAttr).
+function hash(tPlugin, aAttr, ulFlashStartOffset, ulFlashEndOffset, fnCallbackMessage, fnCallbackProgress, tAlgorithm)
 	local strHashBin = nil
+	tAlgorithm = tAlgorithm or getHashAlgorithm(aAttr)
+	local tAttr = atHashAlgorithms[tAlgorithm]
+	if tAttr==nil then
+		return false, nil
+	end
+	
 	local aulParameter =
 	{
 		OPERATION_MODE_Checksum,
 		aAttr.ulDeviceDesc,
 		ulFlashStartOffset,
 		ulFlashEndOffset,
+		tAlgorithm,
+		0,              -- no block checksums
+		0,
+		0, 0, 0, 0, 0,  -- the checksum
+		0               -- no flags
 	}
 	local ulValue = callFlasher(tPlugin, aAttr, aulParameter, fnCallbackMessage, fnCallbackProgress)
 	
 	if ulValue==0 then
-		strHashBin = read_image(tPlugin, aAttr.ulParameter+0x20, 20, fnCallbackProgress)
+		strHashBin = read_image(tPlugin, aAttr.ulParameter+0x2c, tAttr.sizHash, fnCallbackProgress)
 	end
 	
 	return ulValue == 0, strHashBin
 end
 
 
+-- Computes one hash for each block of ulBlockSize bytes in the flash.
+-- The last block may be shorter. The flasher writes the hashes to the RAM
+-- at ulBufferAddress, which must have room for all of them.
+-- tAlgorithm is optional, the default is getHashAlgorithm(aAttr).
+-- Returns true and a list with the binary hash of each block or false.
+function hash_blocks(tPlugin, aAttr, ulFlashStartOffset, ulFlashEndOffset, ulBlockSize, ulBufferAddress, fnCallbackMessage, fnCallbackProgress, tAlgorithm)
+	local astrHashBin = nil
+	tAlgorithm = tAlgorithm or getHashAlgorithm(aAttr)
+	local tAttr = atHashAlgorithms[tAlgorithm]
+	if tAttr==nil or ulBlockSize==0 then
+		return false, nil
+	end
+	
+	local aulParameter =
+	{
+		OPERATION_MODE_Checksum,
+		aAttr.ulDeviceDesc,
+		ulFlashStartOffset,
+		ulFlashEndOffset,
+		tAlgorithm,
+		ulBlockSize,
+		ulBufferAddress,
+		0, 0, 0, 0, 0,  -- the checksum
+		0               -- no flags
+	}
+	local ulValue = callFlasher(tPlugin, aAttr, aulParameter, fnCallbackMessage, fnCallbackProgress)
+	
+	if ulValue==0 then
+		local ulBlocks = math.ceil((ulFlashEndOffset - ulFlashStartOffset) / ulBlockSize)
+		local strHashes = read_image(tPlugin, ulBufferAddress, ulBlocks * tAttr.sizHash, fnCallbackProgress)
+		astrHashBin = {}
+		for uiCnt=0,ulBlocks-1 do
+			table.insert(astrHashBin, strHashes:sub(uiCnt*tAttr.sizHash+1, (uiCnt+1)*tAttr.sizHash))
+		end
+	end
+	
+	return ulValue == 0, astrHashBin
+end
+
+
+-- Returns the number of nodes in a hash tree with ulLeaves leaves.
+-- Each level has half the nodes of the level below, rounded up.
+function getTreeNodes(ulLeaves)
+	local ulNodes = ulLeaves
+	while ulLeaves>1 do
+		ulLeaves = math.ceil(ulLeaves / 2)
+		ulNodes = ulNodes + ulLeaves
+	end
+	return ulNodes
+end
+
+
+-- Computes a hash tree over data in the flash. The leaves are the hashes
+-- of the blocks with ulLeafSize bytes like in hash_blocks. The flasher
+-- writes all nodes of the tree to the RAM at ulBufferAddress, which must
+-- have room for getTreeNodes(leaves) hashes.
+-- tAlgorithm is optional, the default is getHashAlgorithm(aAttr).
+-- Returns true, the binary root and a list with all nodes starting with
+-- the leaves, or false.
+function hash_tree(tPlugin, aAttr, ulFlashStartOffset, ulFlashEndOffset, ulLeafSize, ulBufferAddress, fnCallbackMessage, fnCallbackProgress, tAlgorithm)
+	local strRootBin = nil
+	local astrNodeBin = nil
+	tAlgorithm = tAlgorithm or getHashAlgorithm(aAttr)
+	local tAttr = atHashAlgorithms[tAlgorithm]
+	if tAttr==nil or ulLeafSize==0 then
+		return false, nil
+	end
+	
+	local aulParameter =
+	{
+		OPERATION_MODE_Checksum,
+		aAttr.ulDeviceDesc,
+		ulFlashStartOffset,
+		ulFlashEndOffset,
+		tAlgorithm,
+		ulLeafSize,
+		ulBufferAddress,
+		0, 0, 0, 0, 0,  -- the root
+		CHECKSUM_FLAG_Tree
+	}
+	local ulValue = callFlasher(tPlugin, aAttr, aulParameter, fnCallbackMessage, fnCallbackProgress)
+	
+	if ulValue==0 then
+		strRootBin = read_image(tPlugin, aAttr.ulParameter+0x2c, tAttr.sizHash, fnCallbackProgress)
+		local ulNodes = getTreeNodes(math.ceil((ulFlashEndOffset - ulFlashStartOffset) / ulLeafSize))
+		astrNodeBin = {}
+		if ulNodes>0 then
+			local strNodes = read_image(tPlugin, ulBufferAddress, ulNodes * tAttr.sizHash, fnCallbackProgress)
+			for uiCnt=0,ulNodes-1 do
+				table.insert(astrNodeBin, strNodes:sub(uiCnt*tAttr.sizHash+1, (uiCnt+1)*tAttr.sizHash))
+			end
+		end
+	end
+	
+	return ulValue == 0, strRootBin, astrNodeBin
+end
+
+
+-- The CRC tables are built once for each polynomial.
+local atCrcTables = {}
+
+local function crc32_get_table(ulPolynomial)
+	local aulTable = atCrcTables[ulPolynomial]
+	if aulTable==nil then
+		aulTable = {}
+		for ulCnt=0,255 do
+			local ulCrc = ulCnt
+			for ulBit=1,8 do
+				if bit.band(ulCrc, 1)==1 then
+					ulCrc = bit.bxor(bit.rshift(ulCrc, 1), ulPolynomial)
+				else
+					ulCrc = bit.rshift(ulCrc, 1)
+				end
+			end
+			aulTable[ulCnt] = ulCrc
+		end
+		atCrcTables[ulPolynomial] = aulTable
+	end
+	
+	return aulTable
+end
+
+
+local function crc32(strData, ulPolynomial)
+	local aulTable = crc32_get_table(ulPolynomial)
+	
+	local ulCrc = 0xffffffff
+	for iCnt=1,strData:len() do
+		ulCrc = bit.bxor(bit.rshift(ulCrc, 8), aulTable[bit.band(bit.bxor(ulCrc, strData:byte(iCnt)), 0xff)])
+	end
+	ulCrc = bit.bnot(ulCrc)
+	
+	return string.char(
+		bit.band(bit.rshift(ulCrc, 24), 0xff),
+		bit.band(bit.rshift(ulCrc, 16), 0xff),
+		bit.band(bit.rshift(ulCrc, 8), 0xff),
+		bit.band(ulCrc, 0xff)
+	)
+end
+
+
+-- Computes the hash over a string on the PC side.
+-- The result can be compared with the result of hash or hashArea.
+-- tAlgorithm is optional, the default is getHashAlgorithm().
+function hashData(strData, tAlgorithm)
+	local strHashBin = nil
+	tAlgorithm = tAlgorithm or getHashAlgorithm()
+	local tAttr = atHashAlgorithms[tAlgorithm]
+	
+	if tAlgorithm==CHECKSUM_ALGORITHM_SHA1 then
+		require("mhash")
+		local mh = mhash.mhash_state()
+		mh:init(mhash.MHASH_SHA1)
+		mh:hash(strData)
+		strHashBin = mh:hash_end()
+	elseif tAttr~=nil then
+		strHashBin = crc32(strData, tAttr.ulPolynomial)
+	end
+	
+	return strHashBin
+end
+
+
+-- Computes the hash tree over a string on the PC side.
+-- The result can be compared with the result of hash_tree or hashTreeArea.
+-- tAlgorithm is optional, the default is getHashAlgorithm().
+-- Returns the binary root and a list with all nodes starting with the leaves.
+function hashTreeData(strData, ulLeafSize, tAlgorithm)
+	local astrNodeBin = {}
+	
+	-- The leaves.
+	local ulOffset = 0
+	while ulOffset<strData:len() do
+		table.insert(astrNodeBin, hashData(strData:sub(ulOffset+1, ulOffset+ulLeafSize), tAlgorithm))
+		ulOffset = ulOffset + ulLeafSize
+	end
+	
+	if #astrNodeBin==0 then
+		return hashData("", tAlgorithm), astrNodeBin
+	end
+	
+	-- The levels up to the root. An odd node moves up unchanged.
+	local uiLevel = 1
+	local uiLevelEnd = #astrNodeBin
+	while uiLevelEnd-uiLevel>0 do
+		for uiCnt=uiLevel,uiLevelEnd,2 do
+			if uiCnt<uiLevelEnd then
+				table.insert(astrNodeBin, hashData(string.char(CHECKSUM_TREE_NODE_PREFIX) .. astrNodeBin[uiCnt] .. astrNodeBin[uiCnt+1], tAlgorithm))
+			else
+				table.insert(astrNodeBin, astrNodeBin[uiCnt])
+			end
+		end
+		uiLevel = uiLevelEnd + 1
+		uiLevelEnd = #astrNodeBin
+	end
+	
+	return astrNodeBin[#astrNodeBin], astrNodeBin
+end
+
+
 
 -- Determines the smallest interval of sectors which has to be
 -- erased in order to erase ulStartAdr to ulEndAdr-1.
@@ -818,7 +1200,10 @@ end
 -- Erase an area in the flash.
 -- The start and end addresses must be aligned to sector boundaries as
 -- set by getEraseArea.
+-- The second return value is true if the device checked the erase
+-- operation with its own error status bits.
 function erase(tPlugin, aAttr, ulEraseStart, ulEraseEnd, fnCallbackMessage, fnCallbackProgress)
+	local fTrusted = false
 	local aulParameter =
 	{
 		OPERATION_MODE_Erase,                          -- operation mode: erase
@@ -827,13 +1212,20 @@ function erase(tPlugin, aAttr, ulEraseStart, ulEraseEnd, fnCallbackMessage, fnCa
 		ulEraseEnd
 	}
 	local ulValue = callFlasher(tPlugin, aAttr, aulParameter, fnCallbackMessage, fnCallbackProgress)
-	return ulValue == 0
+	if ulValue==0 then
+		fTrusted = (tPlugin:read_data32(aAttr.ulParameter+0x08)==1)
+	end
+	return ulValue == 0, fTrusted
 end
 
 
 
 -- Easy erase.
 -- A combination of GetEraseArea, IsErased and Erase.
+-- Only the erase blocks which are not empty are erased. The return message
+-- at ulParameter+0x08 is 0xff if nothing was erased. Otherwise it is the
+-- return message of the last erase, i.e. 1 if the device checked the erase
+-- with its error status bits and 0 if not.
 -- NOTE: This is an equivalent of the eraseArea function (see below) for
 --       environments without scripting capabilities. This function exists
 --       just for the sake of a complete API.
@@ -852,6 +1244,148 @@ end
 
 
 
+
+-----------------------------------------------------------------------------
+--                    Batch execution
+-----------------------------------------------------------------------------
+
+-- Create an empty batch. Add operations with batch_add and run all of them
+-- with one call of the flasher with batch_run.
+function batch_create()
+	return {}
+end
+
+
+-- Add an operation to a batch.
+-- aulParams is the same list of parameters which is passed to callFlasher,
+-- starting with the operation mode.
+function batch_add(tBatch, aulParams)
+	table.insert(tBatch, aulParams)
+end
+
+
+-- Run all operations of a batch.
+-- The parameter blocks and the results are placed at the start of the data
+-- buffer. The operations in the batch must not use this part of the buffer.
+-- The batch stops at the first failed operation unless fContinueOnError is
+-- true.
+-- Returns true if all operations succeeded and a list with one entry for
+-- each operation: { fOk, ulReturnMessage }, or nil if the operation was not
+-- executed.
+function batch_run(tPlugin, aAttr, tBatch, fContinueOnError, fnCallbackMessage, fnCallbackProgress)
+	local sizEntries = #tBatch
+	local ulEntriesAdr = aAttr.ulBufferAdr
+	local ulResultsAdr = ulEntriesAdr + sizEntries * SIZEOF_FLASHER_PARAMETER
+	local sizDwords = SIZEOF_FLASHER_PARAMETER / 4
+
+	-- Build all parameter blocks. Each block starts with the parameter
+	-- version and is padded to the size of the structure.
+	local aulEntries = {}
+	for _, aulParams in ipairs(tBatch) do
+		local aulEntry = { FLASHER_INTERFACE_VERSION }
+		for _, ulValue in ipairs(aulParams) do
+			table.insert(aulEntry, ulValue)
+		end
+		if #aulEntry>sizDwords then
+			error("Too many parameters for a batch entry.")
+		end
+		while #aulEntry<sizDwords do
+			table.insert(aulEntry, 0)
+		end
+		for _, ulValue in ipairs(aulEntry) do
+			table.insert(aulEntries, ulValue)
+		end
+	end
+	set_parameterblock(tPlugin, ulEntriesAdr, aulEntries, fnCallbackProgress)
+
+	local ulFlags = 0
+	if fContinueOnError==true then
+		ulFlags = BATCH_FLAG_ContinueOnError
+	end
+
+	local aulParameter =
+	{
+		OPERATION_MODE_Batch,
+		ulEntriesAdr,
+		sizEntries,
+		ulFlags,
+		ulResultsAdr
+	}
+	local ulValue = callFlasher(tPlugin, aAttr, aulParameter, fnCallbackMessage, fnCallbackProgress)
+
+	local atResults = {}
+	for uiCnt=1,sizEntries do
+		local ulAdr = ulResultsAdr + (uiCnt-1)*8
+		local ulResult = tPlugin:read_data32(ulAdr)
+		if ulResult==BATCH_RESULT_NotExecuted then
+			atResults[uiCnt] = nil
+		else
+			atResults[uiCnt] = { fOk=(ulResult==0), ulReturnMessage=tPlugin:read_data32(ulAdr+4) }
+		end
+	end
+
+	return ulValue==0, atResults
+end
+
+
+-- Find the erase units in [ulStartAdr, ulEndAdr[ which are not empty.
+-- The area is expanded to the erase block borders and checked in one pass.
+-- The bitmap is placed in the data buffer.
+-- Returns the expanded area, the size of a unit, a list with one entry per
+-- unit which is true if the unit is not empty, and the number of these
+-- units. Returns nil on error.
+function getEraseMap(tPlugin, aAttr, ulStartAdr, ulEndAdr, fnCallbackMessage, fnCallbackProgress)
+	local aulParameter =
+	{
+		OPERATION_MODE_GetEraseMap,
+		aAttr.ulDeviceDesc,
+		ulStartAdr,
+		ulEndAdr,
+		aAttr.ulBufferAdr,
+		aAttr.ulBufferLen,
+		0,                                     -- unit size, set by the flasher
+		0,                                     -- number of units, set by the flasher
+		0                                      -- number of dirty units, set by the flasher
+	}
+	local ulValue = callFlasher(tPlugin, aAttr, aulParameter, fnCallbackMessage, fnCallbackProgress)
+	if ulValue~=0 then
+		return nil
+	end
+
+	local ulMapStart   = tPlugin:read_data32(aAttr.ulParameter+0x18)
+	local ulMapEnd     = tPlugin:read_data32(aAttr.ulParameter+0x1c)
+	local ulUnitSize   = tPlugin:read_data32(aAttr.ulParameter+0x28)
+	local ulUnits      = tPlugin:read_data32(aAttr.ulParameter+0x2c)
+	local ulDirtyUnits = tPlugin:read_data32(aAttr.ulParameter+0x30)
+
+	-- Read the bitmap only if there is something in it.
+	local strBitmap = ""
+	if ulDirtyUnits~=0 then
+		strBitmap = read_image(tPlugin, aAttr.ulBufferAdr, math.floor((ulUnits+7)/8), fnCallbackProgress)
+		if strBitmap==nil then
+			return nil
+		end
+	end
+
+	local atDirty = {}
+	for uiCnt=0,ulUnits-1 do
+		local ucByte = strBitmap:byte(math.floor(uiCnt/8)+1) or 0
+		atDirty[uiCnt+1] = (math.floor(ucByte / 2^(uiCnt%8)) % 2)==1
+	end
+
+	return ulMapStart, ulMapEnd, ulUnitSize, atDirty, ulDirtyUnits
+end
+
+
+
+-----------------------------------------------------------------------------
+-- Skip the check after the erase in eraseArea if the device reported no
+-- errors in its status register. This is only possible for flashes with
+-- error status bits in the SPI flash table. The default is to read back
+-- the complete area.
+TRUST_ERASE_STATUS = false
+
+
 -----------------------------------------------------------------------------
 -- erase an area:
 -- check if the area is already erased and erase only if it isn't empty.
@@ -871,6 +1405,7 @@ end
 
 function eraseArea(tPlugin, aAttr, ulDeviceOffset, ulSize, fnCallbackMessage, fnCallbackProgress)
 	local fIsErased
+	local fTrusted
 	local ulEndOffset
 	local ulEraseStart,ulEraseEnd
 	
@@ -889,33 +1424,49 @@ function eraseArea(tPlugin, aAttr, ulDeviceOffset, ulSize, fnCallbackMessage, fn
 	
 
 	print(string.format("Area:  [0x%08x, 0x%08x[", ulDeviceOffset, ulEndOffset))
-	print("Checking if the area is already empty")
-	fIsErased = isErased(tPlugin, aAttr, ulDeviceOffset, ulEndOffset, fnCallbackMessage, fnCallbackProgress)
+	print("Checking which erase units are not empty")
+	local ulMapStart, ulMapEnd, ulUnitSize, atDirty, ulDirtyUnits = getEraseMap(tPlugin, aAttr, ulDeviceOffset, ulEndOffset, fnCallbackMessage, fnCallbackProgress)
 
-	if fIsErased==nil then
+	if ulMapStart==nil then
 		return false, "Failed to check if the area is erased!"
-	elseif fIsErased==true then
+	elseif ulDirtyUnits==0 then
 		return true, "The area is empty, no erase necessary."
-	else
-		-- Get the erase area unless we have already gotten it.
-		if not (ulEraseStart and ulEraseEnd) then
-			ulEraseStart,ulEraseEnd = getEraseArea(tPlugin, aAttr, ulDeviceOffset, ulEndOffset, fnCallbackMessage, fnCallbackProgress)
+	end
+	print(string.format("%d of %d erase units are not empty.", ulDirtyUnits, #atDirty))
+
+	-- Erase each run of units which are not empty.
+	local uiUnit = 1
+	while uiUnit<=#atDirty do
+		if atDirty[uiUnit]~=true then
+			uiUnit = uiUnit + 1
+		else
+			local uiRunStart = uiUnit
+			while uiUnit<=#atDirty and atDirty[uiUnit]==true do
+				uiUnit = uiUnit + 1
+			end
+			local ulRunStart = ulMapStart + (uiRunStart-1)*ulUnitSize
+			local ulRunEnd = math.min(ulMapStart + (uiUnit-1)*ulUnitSize, ulMapEnd)
+
+			-- Devices with different erase block sizes need the borders of the blocks.
+			ulEraseStart,ulEraseEnd = getEraseArea(tPlugin, aAttr, ulRunStart, ulRunEnd, fnCallbackMessage, fnCallbackProgress)
 			if not (ulEraseStart and ulEraseEnd) then
 				return false, "getEraseArea failed!"
 			end
-		end
-		
-		print("Erasing flash")
-		print(string.format("Erase: [0x%08x, 0x%08x[", ulEraseStart, ulEraseEnd))
 
-		fIsErased = erase(tPlugin, aAttr, ulEraseStart, ulEraseEnd, fnCallbackMessage, fnCallbackProgress)
-		if fIsErased~=true then
-			return false, "Failed to erase the area! (Failure during erase)"
-		else
-			print("Checking if the area has been erased")
-			fIsErased = isErased(tPlugin, aAttr,  ulDeviceOffset, ulEndOffset, fnCallbackMessage, fnCallbackProgress)
+			print("Erasing flash")
+			print(string.format("Erase: [0x%08x, 0x%08x[", ulEraseStart, ulEraseEnd))
+
+			fIsErased, fTrusted = erase(tPlugin, aAttr, ulEraseStart, ulEraseEnd, fnCallbackMessage, fnCallbackProgress)
 			if fIsErased~=true then
-				return false, "Failed to erase the area! (isErased check failed)"
+				return false, "Failed to erase the area! (Failure during erase)"
+			elseif TRUST_ERASE_STATUS==true and fTrusted==true then
+				print("The device reported no erase errors, skipping the check")
+			else
+				print("Checking if the area has been erased")
+				fIsErased = isErased(tPlugin, aAttr, ulEraseStart, ulEraseEnd, fnCallbackMessage, fnCallbackProgress)
+				if fIsErased~=true then
+					return false, "Failed to erase the area! (isErased check failed)"
+				end
 			end
 		end
 	end
@@ -926,51 +1477,790 @@ end
 
 
 -----------------------------------------------------------------------------
--- flash data in chunks
+-- Compress data in the LZ4 block format.
+-- The flasher unpacks the data on the netX. This pays off if the connection
+-- to the netX is slower than the flash, e.g. for UART or JTAG.
+-- COMPRESS_DATA = nil selects the compression by the plugin type in
+-- COMPRESS_PLUGIN_TYPES. Set it to true or false to force it on or off.
+COMPRESS_DATA = nil
+COMPRESS_PLUGIN_TYPES = { romloader_uart=true, romloader_jtag=true }
+
+local function lz4_length(atOut, ulLength)
+	while ulLength>=255 do
+		table.insert(atOut, string.char(255))
+		ulLength = ulLength - 255
+	end
+	table.insert(atOut, string.char(ulLength))
+end
 
--- Error messages:
--- Failed to flash data!
+local function lz4_sequence(atOut, strLiterals, ulOffset, ulMatchLength)
+	local ulLiterals = strLiterals:len()
+	local ulTokenLiterals = math.min(ulLiterals, 15)
+	local ulTokenMatch = 0
+	if ulMatchLength~=nil then
+		ulTokenMatch = math.min(ulMatchLength-4, 15)
+	end
+	table.insert(atOut, string.char(ulTokenLiterals*16 + ulTokenMatch))
+	if ulTokenLiterals==15 then
+		lz4_length(atOut, ulLiterals-15)
+	end
+	table.insert(atOut, strLiterals)
+	if ulMatchLength~=nil then
+		table.insert(atOut, string.char(ulOffset%256, math.floor(ulOffset/256)))
+		if ulTokenMatch==15 then
+			lz4_length(atOut, ulMatchLength-4-15)
+		end
+	end
+end
 
--- Ok:
--- Image flashed.
+function lz4_compress(strData)
+	local sizData = strData:len()
+	local atOut = {}
+	local atLastPos = {}
+	local uiAnchor = 1
+	local uiPos = 1
+	-- The last match must start 12 bytes before the end and the last 5
+	-- bytes must be literals.
+	local uiLastMatchPos = sizData - 11
+	local uiMisses = 0
+
+	while uiPos<uiLastMatchPos do
+		local strKey = strData:sub(uiPos, uiPos+3)
+		local uiRef = atLastPos[strKey]
+		atLastPos[strKey] = uiPos
+		if uiRef~=nil and (uiPos-uiRef)<=65535 then
+			-- Extend the match.
+			local ulMaxLength = sizData - 5 - uiPos + 1
+			local ulLength = 4
+			while ulLength<ulMaxLength and strData:byte(uiRef+ulLength)==strData:byte(uiPos+ulLength) do
+				ulLength = ulLength + 1
+			end
+			lz4_sequence(atOut, strData:sub(uiAnchor, uiPos-1), uiPos-uiRef, ulLength)
+			uiPos = uiPos + ulLength
+			uiAnchor = uiPos
+			uiMisses = 0
+		else
+			-- Skip faster over data which does not compress.
+			uiMisses = uiMisses + 1
+			uiPos = uiPos + 1 + math.floor(uiMisses/64)
+		end
+	end
+	lz4_sequence(atOut, strData:sub(uiAnchor), nil, nil)
 
-function flashArea(tPlugin, aAttr, ulDeviceOffset, strData, fnCallbackMessage, fnCallbackProgress)
-	local fOk
-	local ulDataByteSize = strData:len()
-	local ulDataOffset = 0
-	local ulBufferAdr = aAttr.ulBufferAdr
-	local ulBufferLen = aAttr.ulBufferLen
-	local ulChunkSize
-	local strChunk
-	
-	while ulDataOffset<ulDataByteSize do
-		-- Extract the next chunk.
-		-- Required for netx 90 Intflash, does not hurt in other cases:
-		-- Align the end of the chunk to a 16 byte boundary, unless this is the last chunk.
-		-- Note: Additionally, ulDeviceOffset must also be a multiple of 16 bytes.
-		local ulEnd = ulDataOffset+ulBufferLen
-		if ulEnd < strData:len() then
-			ulEnd = ulEnd - (ulEnd % 16) 
+	return table.concat(atOut)
+end
+
+local function isCompressionUseful(tPlugin)
+	if COMPRESS_DATA~=nil then
+		return COMPRESS_DATA
+	end
+	return COMPRESS_PLUGIN_TYPES[tPlugin:GetTyp()]==true
+end
+
+-- Unpack an LZ4 block.
+function lz4_decompress(strData)
+	local sizData = strData:len()
+	local aucOut = {}
+	local sizOut = 0
+	local uiPos = 1
+
+	local function readLength(ulLength)
+		local ucValue
+		repeat
+			ucValue = strData:byte(uiPos)
+			if ucValue==nil then
+				error("The compressed data is truncated.")
+			end
+			uiPos = uiPos + 1
+			ulLength = ulLength + ucValue
+		until ucValue~=255
+		return ulLength
+	end
+
+	while uiPos<=sizData do
+		local ucToken = strData:byte(uiPos)
+		uiPos = uiPos + 1
+
+		-- Copy the literals.
+		local ulLength = math.floor(ucToken/16)
+		if ulLength==15 then
+			ulLength = readLength(ulLength)
 		end
-		strChunk = strData:sub(ulDataOffset+1, ulEnd)
-		ulChunkSize = strChunk:len()
+		if uiPos+ulLength-1>sizData then
+			error("The compressed data is truncated.")
+		end
+		for uiCnt=uiPos,uiPos+ulLength-1 do
+			sizOut = sizOut + 1
+			aucOut[sizOut] = strData:byte(uiCnt)
+		end
+		uiPos = uiPos + ulLength
 
-		-- Download the chunk to the buffer.
-		write_image(tPlugin, ulBufferAdr, strChunk, fnCallbackProgress)
+		-- The last sequence ends after the literals.
+		if uiPos>sizData then
+			break
+		end
 
-		-- Flash the chunk.
-		print(string.format("flashing offset 0x%08x-0x%08x.", ulDeviceOffset, ulDeviceOffset+ulChunkSize))
-		fOk = flasher.flash(tPlugin, aAttr, ulDeviceOffset, ulChunkSize, ulBufferAdr, fnCallbackMessage, fnCallbackProgress)
-		if not fOk then
-			return false, "Failed to flash data!"
+		-- Copy the match.
+		local b0, b1 = strData:byte(uiPos, uiPos+1)
+		if b1==nil then
+			error("The compressed data is truncated.")
 		end
+		uiPos = uiPos + 2
+		local ulOffset = b0 + 256*b1
+		if ulOffset==0 or ulOffset>sizOut then
+			error("The compressed data has an invalid offset.")
+		end
+		ulLength = ucToken % 16
+		if ulLength==15 then
+			ulLength = readLength(ulLength)
+		end
+		for uiCnt=1,ulLength+4 do
+			sizOut = sizOut + 1
+			aucOut[sizOut] = aucOut[sizOut-ulOffset]
+		end
+	end
 
-		-- Increase pointers.
-		ulDataOffset = ulDataOffset + ulChunkSize
-		ulDeviceOffset = ulDeviceOffset + ulChunkSize
+	-- Convert the bytes to a string in slices.
+	local astrOut = {}
+	for uiCnt=1,sizOut,4096 do
+		table.insert(astrOut, string.char(unpack(aucOut, uiCnt, math.min(uiCnt+4095, sizOut))))
 	end
+	return table.concat(astrOut)
+end
 
-	return true, "Image flashed."
+-- Reading uses the compression on all slow connections. The packing on the
+-- netX is much faster than the transfer.
+COMPRESS_READ = nil
+COMPRESS_READ_PLUGIN_TYPES = { romloader_uart=true, romloader_usb=true, romloader_jtag=true }
+
+local function isReadCompressionUseful(tPlugin)
+	if COMPRESS_READ~=nil then
+		return COMPRESS_READ
+	end
+	return COMPRESS_READ_PLUGIN_TYPES[tPlugin:GetTyp()]==true
+end
+
+
+
+
+-----------------------------------------------------------------------------
+-- Send only the parts of the data which are not erased.
+-- This is used by flashArea if the complete area is erased before. The
+-- flasher fills the gaps with 0xff, writes only the extents and verifies
+-- the complete area.
+-- Only runs of at least SPARSE_MIN_GAP bytes are skipped.
+SPARSE_DATA = true
+SPARSE_MIN_GAP = 256
+
+local function dword_string(ulValue)
+	return string.char(ulValue%256, math.floor(ulValue/0x100)%256, math.floor(ulValue/0x10000)%256, math.floor(ulValue/0x1000000)%256)
+end
+
+-- Build the list of extents for all data which is not erased. Each extent
+-- is a DWORD with the offset, a DWORD with the length and the data padded
+-- to a multiple of 4 bytes. The extents are aligned to 16 bytes for the
+-- netX 90 internal flash.
+function buildSparseExtents(strData)
+	local sizData = strData:len()
+	local atOut = {}
+	local strGap = string.rep(string.char(0xff), SPARSE_MIN_GAP)
+	local uiPos = 1
+
+	while uiPos<=sizData do
+		-- Find the start of the next extent.
+		local uiStart = strData:find("[^\255]", uiPos)
+		if uiStart==nil then
+			break
+		end
+		uiStart = uiStart - ((uiStart-1) % 16)
+
+		-- The extent ends before the next gap.
+		local uiEnd = sizData
+		local uiGap = strData:find(strGap, uiStart, true)
+		if uiGap~=nil then
+			uiEnd = uiGap - 1
+		end
+		uiEnd = math.min(uiEnd + ((16 - (uiEnd % 16)) % 16), sizData)
+
+		local strExtent = strData:sub(uiStart, uiEnd)
+		local sizExtent = strExtent:len()
+		table.insert(atOut, dword_string(uiStart-1))
+		table.insert(atOut, dword_string(sizExtent))
+		table.insert(atOut, strExtent)
+		table.insert(atOut, string.rep(string.char(0), (4 - (sizExtent % 4)) % 4))
+
+		uiPos = uiEnd + 1
+	end
+
+	return table.concat(atOut)
+end
+
+
+
+
+-----------------------------------------------------------------------------
+-- Flash data with a ring buffer.
+-- The flasher programs one slot of the ring buffer while the host writes
+-- the next slots. For large images this overlaps the download with the
+-- programming.
+-- The host fills the free slots each time the flasher sends a message. This
+-- needs a plugin which can access the netX memory while the flasher is
+-- running. Only the plugin types in FLASH_STREAM_PLUGIN_TYPES can do this,
+-- in practice JTAG. Set FLASH_STREAM to true to use it in flashArea.
+FLASH_STREAM = false
+FLASH_STREAM_PLUGIN_TYPES = { romloader_jtag=true }
+FLASH_STREAM_SLOTS = 4
+FLASH_STREAM_TIMEOUT_MS = 10000
+
+-- Error messages:
+-- The plugin can not access the netX memory while the flasher is running!
+-- The buffer is too small for the ring buffer!
+-- Failed to flash data!
+
+-- Ok:
+-- Image flashed.
+
+function flashAreaStream(tPlugin, aAttr, ulDeviceOffset, strData, fnCallbackMessage, fnCallbackProgress)
+	fnCallbackMessage = fnCallbackMessage or default_callback_message
+	if FLASH_STREAM_PLUGIN_TYPES[tPlugin:GetTyp()]~=true then
+		return false, "The plugin can not access the netX memory while the flasher is running!"
+	end
+	local ulDataByteSize = strData:len()
+	local ulSlots = FLASH_STREAM_SLOTS
+	local ulProducer = 0
+	local ulDataOffset = 0
+
+	-- The control block is at the start of the buffer, the ring follows.
+	-- The slots are aligned to 16 bytes for the netX 90 internal flash.
+	local ulControlAdr = aAttr.ulBufferAdr
+	local ulRingAdr = ulControlAdr + 16
+	local ulSlotSize = math.floor((aAttr.ulBufferLen - 16) / ulSlots)
+	ulSlotSize = ulSlotSize - (ulSlotSize % 16)
+	if ulSlotSize<=0 then
+		return false, "The buffer is too small for the ring buffer!"
+	end
+
+	-- Write data to all free slots.
+	local function fillSlots(ulConsumer)
+		while ulDataOffset<ulDataByteSize and (ulProducer-ulConsumer)<ulSlots do
+			local strChunk = strData:sub(ulDataOffset+1, ulDataOffset+ulSlotSize)
+			write_image(tPlugin, ulRingAdr + (ulProducer % ulSlots) * ulSlotSize, strChunk, fnCallbackProgress)
+			ulDataOffset = ulDataOffset + strChunk:len()
+			ulProducer = ulProducer + 1
+			-- Publish the slot after the complete data is written.
+			tPlugin:write_data32(ulControlAdr, ulProducer)
+		end
+	end
+
+	-- Clear the control block and fill the ring before the start.
+	set_parameterblock(tPlugin, ulControlAdr, { 0, 0, 0 }, fnCallbackProgress)
+	fillSlots(0)
+
+	-- The flasher sends a progress message after each slot.
+	local function fnStreamMessage(a, b)
+		if ulDataOffset<ulDataByteSize then
+			fillSlots(tPlugin:read_data32(ulControlAdr+4))
+		end
+		return fnCallbackMessage(a, b)
+	end
+
+	print(string.format("streaming offset 0x%08x-0x%08x.", ulDeviceOffset, ulDeviceOffset+ulDataByteSize))
+	local aulParameter =
+	{
+		OPERATION_MODE_FlashStream,
+		aAttr.ulDeviceDesc,
+		ulDeviceOffset,
+		ulDataByteSize,
+		ulControlAdr,
+		ulRingAdr,
+		ulSlotSize,
+		ulSlots,
+		FLASH_STREAM_TIMEOUT_MS
+	}
+	local ulValue = callFlasher(tPlugin, aAttr, aulParameter, fnStreamMessage, fnCallbackProgress)
+	if ulValue~=0 then
+		return false, "Failed to flash data!"
+	end
+
+	return true, "Image flashed."
+end
+
+
+
+
+-----------------------------------------------------------------------------
+-- flash data in chunks
+-- Each chunk is written and verified with one call.
+-- If fErase is true, the area for all data is checked and erased if it is
+-- not empty. This is done with the first chunk, so no separate eraseArea
+-- is necessary.
+-- If FLASH_STREAM is true, the data is flashed with flashAreaStream. This
+-- fails if the plugin type is not in FLASH_STREAM_PLUGIN_TYPES.
+-- The data is sent compressed or sparse if possible, see COMPRESS_DATA and
+-- SPARSE_DATA.
+
+-- Error messages:
+-- The plugin can not access the netX memory while the flasher is running!
+-- Failed to erase the area!
+-- Failed to flash data!
+-- Failed to verify data!
+
+-- Ok:
+-- Image flashed.
+
+function flashArea(tPlugin, aAttr, ulDeviceOffset, strData, fnCallbackMessage, fnCallbackProgress, fErase)
+	local fOk
+	local tResult
+	local ulDataByteSize = strData:len()
+	local ulDataOffset = 0
+	local ulBufferAdr = aAttr.ulBufferAdr
+	local ulBufferLen = aAttr.ulBufferLen
+	local ulChunkSize
+	local strChunk
+	local ulEraseStart = 0
+	local ulEraseEnd = 0
+	local fCompress = isCompressionUseful(tPlugin)
+	local ulCompressedAdr
+	local ulCompressedSize
+	local ulExtentsAdr
+	local ulExtentsSize
+	
+	-- Sparse data needs an erased area. It is only useful if the data has
+	-- large erased parts.
+	local fSparse = (SPARSE_DATA==true and fErase==true and strData:find(string.rep(string.char(0xff), SPARSE_MIN_GAP), 1, true)~=nil)
+	
+	-- With compression or sparse data the unpacked chunk uses 2/3 of the
+	-- buffer and the packed data is placed behind it.
+	local ulChunkMax = ulBufferLen
+	if fCompress==true or fSparse==true then
+		ulChunkMax = math.floor(ulBufferLen * 2 / 3)
+		ulChunkMax = ulChunkMax - (ulChunkMax % 16)
+	end
+	
+	if FLASH_STREAM==true then
+		if FLASH_STREAM_PLUGIN_TYPES[tPlugin:GetTyp()]~=true then
+			return false, "The plugin can not access the netX memory while the flasher is running!"
+		end
+		if fErase==true then
+			fOk = eraseArea(tPlugin, aAttr, ulDeviceOffset, ulDataByteSize, fnCallbackMessage, fnCallbackProgress)
+			if not fOk then
+				return false, "Failed to erase the area!"
+			end
+		end
+		return flashAreaStream(tPlugin, aAttr, ulDeviceOffset, strData, fnCallbackMessage, fnCallbackProgress)
+	end
+
+	if fErase==true then
+		ulEraseStart = ulDeviceOffset
+		ulEraseEnd = ulDeviceOffset + ulDataByteSize
+	end
+	
+	while ulDataOffset<ulDataByteSize do
+		-- Extract the next chunk.
+		-- Required for netx 90 Intflash, does not hurt in other cases:
+		-- Align the end of the chunk to a 16 byte boundary, unless this is the last chunk.
+		-- Note: Additionally, ulDeviceOffset must also be a multiple of 16 bytes.
+		local ulEnd = ulDataOffset+ulChunkMax
+		if ulEnd < strData:len() then
+			ulEnd = ulEnd - (ulEnd % 16) 
+		end
+		strChunk = strData:sub(ulDataOffset+1, ulEnd)
+		ulChunkSize = strChunk:len()
+
+		-- Download the chunk to the buffer. Send it compressed or sparse
+		-- if the packed data fits into the rest of the buffer. Compression
+		-- is preferred, it packs the erased parts as well.
+		ulCompressedAdr = 0
+		ulCompressedSize = 0
+		ulExtentsAdr = nil
+		ulExtentsSize = nil
+		if fCompress==true then
+			local strCompressed = lz4_compress(strChunk)
+			if strCompressed:len()<=(ulBufferLen-ulChunkMax) then
+				ulCompressedAdr = ulBufferAdr + ulChunkMax
+				ulCompressedSize = strCompressed:len()
+				write_image(tPlugin, ulCompressedAdr, strCompressed, fnCallbackProgress)
+			end
+		end
+		if ulCompressedSize==0 and fSparse==true then
+			local strExtents = buildSparseExtents(strChunk)
+			if strExtents:len()<=(ulBufferLen-ulChunkMax) then
+				ulExtentsAdr = ulBufferAdr + ulChunkMax
+				ulExtentsSize = strExtents:len()
+				if ulExtentsSize>0 then
+					write_image(tPlugin, ulExtentsAdr, strExtents, fnCallbackProgress)
+				end
+			end
+		end
+		if ulCompressedSize==0 and ulExtentsAdr==nil then
+			write_image(tPlugin, ulBufferAdr, strChunk, fnCallbackProgress)
+		end
+
+		-- Flash the chunk. The erase area is only passed with the first chunk.
+		print(string.format("flashing offset 0x%08x-0x%08x.", ulDeviceOffset, ulDeviceOffset+ulChunkSize))
+		fOk, tResult = eraseFlashVerify(tPlugin, aAttr, ulDeviceOffset, ulChunkSize, ulBufferAdr, ulEraseStart, ulEraseEnd, fnCallbackMessage, fnCallbackProgress, ulCompressedAdr, ulCompressedSize, ulExtentsAdr, ulExtentsSize)
+		if not fOk then
+			if tResult==ERASEFLASHVERIFY_RESULT_EraseFailed then
+				return false, "Failed to erase the area!"
+			elseif tResult==ERASEFLASHVERIFY_RESULT_VerifyFailed then
+				return false, "Failed to verify data!"
+			end
+			return false, "Failed to flash data!"
+		end
+		ulEraseStart = 0
+		ulEraseEnd = 0
+
+		-- Increase pointers.
+		ulDataOffset = ulDataOffset + ulChunkSize
+		ulDeviceOffset = ulDeviceOffset + ulChunkSize
+	end
+
+	return true, "Image flashed."
+end
+
+
+
+-----------------------------------------------------------------------------
+-- Update an area with a delta against its current contents.
+--
+-- strOldData must be the current contents of the flash at ulDeviceOffset.
+-- The delta is built on the PC. It copies the unchanged parts from the
+-- flash and sends only the new bytes. The flasher rebuilds the area one
+-- erase block at a time and rewrites only the blocks which changed.
+--
+-- The erase blocks may have different sizes, e.g. the boot blocks of a CFI
+-- flash. The staging buffer on the netX holds the largest block of the area.
+
+-- Only matches of at least PATCH_MATCH_SIZE bytes are copied from the flash.
+PATCH_MATCH_SIZE = 32
+
+-- Get the borders of the erase blocks which overlap [ulStartAdr, ulEndAdr[.
+-- Returns a list with the start of each block followed by the end of the
+-- last block, or nil on error.
+function getEraseBlocks(tPlugin, aAttr, ulStartAdr, ulEndAdr, fnCallbackMessage, fnCallbackProgress)
+	local aulBorders = {}
+	local ulAdr = ulStartAdr
+	repeat
+		local ulBlockStart, ulBlockEnd = getEraseArea(tPlugin, aAttr, ulAdr, ulAdr+1, fnCallbackMessage, fnCallbackProgress)
+		if not (ulBlockStart and ulBlockEnd) or ulBlockEnd<=ulAdr then
+			return nil
+		end
+		if #aulBorders==0 then
+			table.insert(aulBorders, ulBlockStart)
+		end
+		table.insert(aulBorders, ulBlockEnd)
+		ulAdr = ulBlockEnd
+	until ulAdr>=ulEndAdr
+
+	return aulBorders
+end
+
+
+-- Build the delta to turn strOldData into strNewData. Both are located at
+-- ulDeviceOffset in the flash. aulBorders are the erase blocks of the new
+-- data from getEraseBlocks. A copy never crosses the border of an erase
+-- block in the new data and never reads from a block which the flasher
+-- rewrote before.
+function buildPatchDelta(strOldData, strNewData, ulDeviceOffset, aulBorders)
+	local sizOld = strOldData:len()
+	local sizNew = strNewData:len()
+	local atOut = {}
+
+	-- Find the erase block of an offset. The offsets only grow, so the
+	-- search continues at the last block.
+	local uiBlock = 1
+	local function getBlock(ulAdr)
+		while uiBlock<#aulBorders-1 and aulBorders[uiBlock+1]<=ulAdr do
+			uiBlock = uiBlock + 1
+		end
+		return aulBorders[uiBlock], aulBorders[uiBlock+1]
+	end
+
+	-- Find the first difference. All blocks before it stay unchanged.
+	local ulFirst = 0
+	local sizCompare = math.min(sizOld, sizNew)
+	while ulFirst<sizCompare do
+		local ulEnd = math.min(ulFirst+4096, sizCompare)
+		if strOldData:sub(ulFirst+1, ulEnd)~=strNewData:sub(ulFirst+1, ulEnd) then
+			while strOldData:byte(ulFirst+1)==strNewData:byte(ulFirst+1) do
+				ulFirst = ulFirst + 1
+			end
+			break
+		end
+		ulFirst = ulEnd
+	end
+	local ulFirstChanged = aulBorders[1]
+	for _, ulBorder in ipairs(aulBorders) do
+		if ulBorder<=ulDeviceOffset+ulFirst then
+			ulFirstChanged = ulBorder
+		end
+	end
+
+	-- Index the aligned blocks of the old data.
+	local atIndex = {}
+	for ulPos=0,sizOld-PATCH_MATCH_SIZE,PATCH_MATCH_SIZE do
+		local strKey = strOldData:sub(ulPos+1, ulPos+PATCH_MATCH_SIZE)
+		if atIndex[strKey]==nil then
+			atIndex[strKey] = ulPos
+		end
+	end
+
+	local function addLiteral(ulStart, ulEnd)
+		if ulEnd>ulStart then
+			local ulLength = ulEnd - ulStart
+			table.insert(atOut, dword_string(PATCH_OP_Literal*0x40000000 + ulLength))
+			table.insert(atOut, strNewData:sub(ulStart+1, ulEnd))
+			table.insert(atOut, string.rep(string.char(0), (4 - ulLength%4)%4))
+		end
+	end
+
+	local ulLiteralStart = 0
+	local ulPos = 0
+	while ulPos<sizNew do
+		local ulBlockStart, ulBlockEnd = getBlock(ulDeviceOffset+ulPos)
+		local ulMaxLength = ulBlockEnd - ulDeviceOffset - ulPos
+		local strKey = strNewData:sub(ulPos+1, ulPos+PATCH_MATCH_SIZE)
+		local ulSource = nil
+
+		if strKey:len()==PATCH_MATCH_SIZE then
+			-- Prefer the same position, then any position in the old data.
+			if strOldData:sub(ulPos+1, ulPos+PATCH_MATCH_SIZE)==strKey then
+				ulSource = ulPos
+			else
+				ulSource = atIndex[strKey]
+			end
+		end
+
+		local ulLength = 0
+		if ulSource~=nil then
+			ulMaxLength = math.min(ulMaxLength, sizNew-ulPos, sizOld-ulSource)
+			while ulLength+256<=ulMaxLength and strOldData:sub(ulSource+ulLength+1, ulSource+ulLength+256)==strNewData:sub(ulPos+ulLength+1, ulPos+ulLength+256) do
+				ulLength = ulLength + 256
+			end
+			while ulLength<ulMaxLength and strOldData:byte(ulSource+ulLength+1)==strNewData:byte(ulPos+ulLength+1) do
+				ulLength = ulLength + 1
+			end
+			-- The rewritten blocks do not have the old data anymore.
+			local ulFlashSource = ulDeviceOffset + ulSource
+			if ulFlashSource<ulBlockStart and ulFlashSource+ulLength>ulFirstChanged then
+				ulLength = 0
+			end
+		end
+
+		if ulLength>=PATCH_MATCH_SIZE then
+			addLiteral(ulLiteralStart, ulPos)
+			table.insert(atOut, dword_string(PATCH_OP_Copy*0x40000000 + ulLength))
+			table.insert(atOut, dword_string(ulDeviceOffset + ulSource))
+			ulPos = ulPos + ulLength
+			ulLiteralStart = ulPos
+		else
+			ulPos = ulPos + 1
+		end
+	end
+	addLiteral(ulLiteralStart, sizNew)
+
+	return table.concat(atOut)
+end
+
+
+function patch(tPlugin, aAttr, ulStartAdr, ulDataByteSize, ulPatchAddress, ulPatchSize, ulStagingAddress, ulStagingSize, fnCallbackMessage, fnCallbackProgress)
+	local aulParameter =
+	{
+		OPERATION_MODE_Patch,
+		aAttr.ulDeviceDesc,
+		ulStartAdr,
+		ulDataByteSize,
+		ulPatchAddress,
+		ulPatchSize,
+		ulStagingAddress,
+		ulStagingSize,
+		0                                      -- number of rewritten blocks, set by the flasher
+	}
+	local ulValue = callFlasher(tPlugin, aAttr, aulParameter, fnCallbackMessage, fnCallbackProgress)
+	local ulChangedBlocks = nil
+	if ulValue==0 then
+		ulChangedBlocks = tPlugin:read_data32(aAttr.ulParameter+0x2c)
+	end
+
+	return ulValue==0, ulChangedBlocks
+end
+
+
+-- Error messages:
+-- getEraseArea failed!
+-- Failed to check the old data: <the error of hashArea>
+-- The flash does not contain the old data!
+-- The delta does not fit into the buffer!
+-- Failed to patch the area!
+
+-- Ok:
+-- Area patched.
+
+function patchArea(tPlugin, aAttr, ulDeviceOffset, strOldData, strNewData, fnCallbackMessage, fnCallbackProgress)
+	-- The delta is only valid for the old data.
+	local strFlashHash, strMsg = hashArea(tPlugin, aAttr, ulDeviceOffset, strOldData:len(), fnCallbackMessage, fnCallbackProgress)
+	if strFlashHash==nil then
+		return false, "Failed to check the old data: " .. strMsg
+	elseif strFlashHash~=hashData(strOldData, getHashAlgorithm(aAttr)) then
+		return false, "The flash does not contain the old data!"
+	end
+
+	local aulBorders = getEraseBlocks(tPlugin, aAttr, ulDeviceOffset, ulDeviceOffset+strNewData:len(), fnCallbackMessage, fnCallbackProgress)
+	if aulBorders==nil then
+		return false, "getEraseArea failed!"
+	end
+	-- The staging buffer must hold the largest erase block.
+	local ulBlockSize = 0
+	for uiCnt=1,#aulBorders-1 do
+		ulBlockSize = math.max(ulBlockSize, aulBorders[uiCnt+1] - aulBorders[uiCnt])
+	end
+
+	local strDelta = buildPatchDelta(strOldData, strNewData, ulDeviceOffset, aulBorders)
+	print(string.format("The delta has 0x%08x bytes for 0x%08x bytes of data.", strDelta:len(), strNewData:len()))
+
+	-- The staging buffer follows the delta.
+	local ulStagingAdr = aAttr.ulBufferAdr + strDelta:len()
+	ulStagingAdr = ulStagingAdr + (16 - ulStagingAdr%16)%16
+	if ulStagingAdr+ulBlockSize>aAttr.ulBufferAdr+aAttr.ulBufferLen then
+		return false, "The delta does not fit into the buffer!"
+	end
+
+	if strDelta:len()>0 then
+		write_image(tPlugin, aAttr.ulBufferAdr, strDelta, fnCallbackProgress)
+	end
+	local fOk, ulChangedBlocks = patch(tPlugin, aAttr, ulDeviceOffset, strNewData:len(), aAttr.ulBufferAdr, strDelta:len(), ulStagingAdr, ulBlockSize, fnCallbackMessage, fnCallbackProgress)
+	if fOk~=true then
+		return false, "Failed to patch the area!"
+	end
+	print(string.format("%d erase blocks were rewritten.", ulChangedBlocks))
+
+	return true, "Area patched."
+end
+
+
+
+-----------------------------------------------------------------------------
+-- Fill an area with a repeating pattern.
+-- The pattern has 1 to FILL_PATTERN_MAX bytes. The data is built by the
+-- flasher, nothing but the pattern is sent to the netX.
+
+function fill(tPlugin, aAttr, ulStartAdr, ulDataByteSize, strPattern, fnCallbackMessage, fnCallbackProgress)
+	local aulParameter =
+	{
+		OPERATION_MODE_Fill,
+		aAttr.ulDeviceDesc,
+		ulStartAdr,
+		ulDataByteSize,
+		aAttr.ulBufferAdr,
+		aAttr.ulBufferLen,
+		strPattern:len()
+	}
+	-- The pattern is passed as 4 DWORDs.
+	local strPadded = strPattern .. string.rep(string.char(0), FILL_PATTERN_MAX-strPattern:len())
+	for uiCnt=0,FILL_PATTERN_MAX-4,4 do
+		local a, b, c, d = strPadded:byte(uiCnt+1, uiCnt+4)
+		table.insert(aulParameter, a + b*0x100 + c*0x10000 + d*0x1000000)
+	end
+
+	local ulValue = callFlasher(tPlugin, aAttr, aulParameter, fnCallbackMessage, fnCallbackProgress)
+	return ulValue==0
+end
+
+
+-- Error messages:
+-- Invalid pattern!
+-- Failed to erase the area!
+-- Failed to fill the area!
+
+-- Ok:
+-- Area filled.
+
+function fillArea(tPlugin, aAttr, ulDeviceOffset, ulDataByteSize, strPattern, fnCallbackMessage, fnCallbackProgress, fErase)
+	if strPattern:len()==0 or strPattern:len()>FILL_PATTERN_MAX then
+		return false, "Invalid pattern!"
+	end
+
+	if fErase==true then
+		local fOk = eraseArea(tPlugin, aAttr, ulDeviceOffset, ulDataByteSize, fnCallbackMessage, fnCallbackProgress)
+		if not fOk then
+			return false, "Failed to erase the area!"
+		end
+	end
+
+	print(string.format("filling offset 0x%08x-0x%08x.", ulDeviceOffset, ulDeviceOffset+ulDataByteSize))
+	if fill(tPlugin, aAttr, ulDeviceOffset, ulDataByteSize, strPattern, fnCallbackMessage, fnCallbackProgress)~=true then
+		return false, "Failed to fill the area!"
+	end
+
+	return true, "Area filled."
+end
+
+
+
+-----------------------------------------------------------------------------
+-- Copy data inside a device or from one device to another.
+-- The data is copied by the flasher through its buffer, nothing is sent
+-- to the PC.
+
+-- Keep the description of the current device for a copy to another device.
+-- The description is moved to the end of the buffer and the buffer shrinks.
+-- Returns the address of the description or nil.
+function keepDeviceDescriptor(tPlugin, aAttr, fnCallbackProgress)
+	local strDevDesc = readDeviceDescriptor(tPlugin, aAttr, fnCallbackProgress)
+	if strDevDesc==nil then
+		return nil
+	end
+
+	local ulDescAdr = aAttr.ulBufferEnd - strDevDesc:len()
+	ulDescAdr = ulDescAdr - (ulDescAdr % 16)
+	write_image(tPlugin, ulDescAdr, strDevDesc, fnCallbackProgress)
+	set_buffer_area(aAttr, aAttr.ulBufferAdr, ulDescAdr - aAttr.ulBufferAdr)
+
+	return ulDescAdr
+end
+
+
+-- ulSrcDeviceDesc is the address of the source device description from
+-- keepDeviceDescriptor or nil for a copy inside the current device.
+-- If fErase is true, the destination is erased and written one erase block
+-- at a time. This is necessary if the areas overlap. Otherwise the
+-- destination must be erased.
+function copy(tPlugin, aAttr, ulSrcAdr, ulDstAdr, ulDataByteSize, ulSrcDeviceDesc, fErase, fnCallbackMessage, fnCallbackProgress)
+	local ulFlags = 0
+	if fErase==true then
+		ulFlags = COPY_FLAG_Erase
+	end
+
+	local aulParameter =
+	{
+		OPERATION_MODE_Copy,
+		aAttr.ulDeviceDesc,
+		ulDstAdr,
+		ulDataByteSize,
+		ulSrcDeviceDesc or 0,
+		ulSrcAdr,
+		aAttr.ulBufferAdr,
+		aAttr.ulBufferLen,
+		ulFlags
+	}
+	local ulValue = callFlasher(tPlugin, aAttr, aulParameter, fnCallbackMessage, fnCallbackProgress)
+	return ulValue==0
+end
+
+
+-- Error messages:
+-- Failed to copy the area!
+
+-- Ok:
+-- Area copied.
+
+function copyArea(tPlugin, aAttr, ulSrcOffset, ulDstOffset, ulDataByteSize, fnCallbackMessage, fnCallbackProgress, fErase, ulSrcDeviceDesc)
+	print(string.format("copying offset 0x%08x-0x%08x to 0x%08x.", ulSrcOffset, ulSrcOffset+ulDataByteSize, ulDstOffset))
+	if copy(tPlugin, aAttr, ulSrcOffset, ulDstOffset, ulDataByteSize, ulSrcDeviceDesc, fErase, fnCallbackMessage, fnCallbackProgress)~=true then
+		return false, "Failed to copy the area!"
+	end
+
+	return true, "Area copied."
 end
 
 
@@ -1018,6 +2308,63 @@ end
 
 
 
+-----------------------------------------------------------------------------
+-- Size of the report buffer for verifyAreaRanges. It is placed at the end of
+-- the data buffer.
+VERIFY_REPORT_SIZE = 0x1000
+
+-- Verify an area and return a list of all different areas.
+-- This does not stop at the first difference. The caller can use the list
+-- to repair only the affected erase blocks.
+-- Returns true/false, a message and a list of {ulStart, ulEnd} pairs with
+-- the device offsets of all differences.
+function verifyAreaRanges(tPlugin, aAttr, ulDeviceOffset, strData, fnCallbackMessage, fnCallbackProgress)
+	local fEqual
+	local atChunkRanges
+	local atRanges = {}
+	local ulDataByteSize = strData:len()
+	local ulDataOffset = 0
+	local ulBufferAdr = aAttr.ulBufferAdr
+	local ulBufferLen = aAttr.ulBufferLen - VERIFY_REPORT_SIZE
+	local ulReportAdr
+	local ulChunkSize
+	local strChunk
+	
+	-- Keep the report buffer aligned to 4 bytes.
+	ulBufferLen = ulBufferLen - (ulBufferLen % 4)
+	ulReportAdr = ulBufferAdr + ulBufferLen
+	
+	while ulDataOffset<ulDataByteSize do
+		-- Extract the next chunk.
+		strChunk = strData:sub(ulDataOffset+1, ulDataOffset+ulBufferLen)
+		ulChunkSize = strChunk:len()
+
+		-- Download the chunk to the buffer.
+		write_image(tPlugin, ulBufferAdr, strChunk, fnCallbackProgress)
+
+		-- Verify the chunk.
+		print(string.format("verifying offset 0x%08x-0x%08x.", ulDeviceOffset, ulDeviceOffset+ulChunkSize))
+		fEqual, atChunkRanges = verify_report(tPlugin, aAttr, ulDeviceOffset, ulDeviceOffset + ulChunkSize, ulBufferAdr, ulReportAdr, VERIFY_REPORT_SIZE, fnCallbackMessage, fnCallbackProgress)
+		if atChunkRanges==nil then
+			return false, "Failed to verify the area!", atRanges
+		end
+		for _, tRange in ipairs(atChunkRanges) do
+			table.insert(atRanges, tRange)
+		end
+
+		-- Increase pointers.
+		ulDataOffset = ulDataOffset + ulChunkSize
+		ulDeviceOffset = ulDeviceOffset + ulChunkSize
+	end
+	
+	if #atRanges~=0 then
+		return false, string.format("Differences were found in %d areas.", #atRanges), atRanges
+	end
+	return true, "The data in the flash is equal to the input file.", atRanges
+end
+
+
+
 
 
 
@@ -1041,6 +2388,20 @@ function readArea(tPlugin, aAttr, ulDeviceOffset, ulDataByteSize, fnCallbackMess
 	local strChunk
 	local ulChunkSize
 	local astrChunks = {}
+	local ulCompressedSize
+	local fCompress = isReadCompressionUseful(tPlugin)
+	
+	-- With compression the data uses 2/3 of the buffer and the compressed
+	-- block is placed behind it.
+	local ulChunkMax = ulBufferLen
+	local ulCompressedAdr
+	local ulCompressedMax
+	if fCompress==true then
+		ulChunkMax = math.floor(ulBufferLen * 2 / 3)
+		ulChunkMax = ulChunkMax - (ulChunkMax % 16)
+		ulCompressedAdr = ulBufferAddr + ulChunkMax
+		ulCompressedMax = ulBufferLen - ulChunkMax
+	end
 	
 	if ulSize == 0xffffffff then 
 		ulSize = getFlashSize(tPlugin, aAttr, fnCallbackMessage, fnCallbackProgress)
@@ -1054,17 +2415,27 @@ function readArea(tPlugin, aAttr, ulDeviceOffset, ulDataByteSize, fnCallbackMess
 	
 	while ulSize>0 do
 		-- determine chunk size
-		ulChunkSize = math.min(ulSize, ulBufferLen)
+		ulChunkSize = math.min(ulSize, ulChunkMax)
 		
 		-- Read chunk into buffer
 		print(string.format("reading flash offset 0x%08x-0x%08x.", ulDeviceOffset, ulDeviceOffset+ulChunkSize))
-		fOk = read(tPlugin, aAttr, ulDeviceOffset, ulDeviceOffset + ulChunkSize, ulBufferAddr, fnCallbackMessage, fnCallbackProgress)
+		fOk, ulCompressedSize = read(tPlugin, aAttr, ulDeviceOffset, ulDeviceOffset + ulChunkSize, ulBufferAddr, fnCallbackMessage, fnCallbackProgress, ulCompressedAdr, ulCompressedMax)
 		if not fOk then
 			return nil, "Error while reading from flash!"
 		end
 		
-		-- Read the buffer 
-		strChunk = read_image(tPlugin, ulBufferAddr, ulChunkSize, fnCallbackProgress)
+		-- Read the buffer. Get only the compressed block if the data fit.
+		if ulCompressedSize~=0 then
+			strChunk = read_image(tPlugin, ulCompressedAdr, ulCompressedSize, fnCallbackProgress)
+			if strChunk then
+				fOk, strChunk = pcall(lz4_decompress, strChunk)
+				if not fOk or strChunk:len()~=ulChunkSize then
+					return nil, "Error while unpacking the data!"
+				end
+			end
+		else
+			strChunk = read_image(tPlugin, ulBufferAddr, ulChunkSize, fnCallbackProgress)
+		end
 		if not strChunk then
 			return nil, "Error while reading from RAM buffer!"
 		end
@@ -1084,7 +2455,7 @@ end
 
 
 --------------------------------------------------------------------------
--- Calculate the SHA1 hash of an area of an area in the flash.
+-- Calculate the hash of an area in the flash with getHashAlgorithm(aAttr).
 -- size = 0xffffffff to read from ulDeviceOffset to end of device
 --
 -- Returns the hash as a binary string or nil and an error message.
@@ -1094,7 +2465,7 @@ end
 --
 -- Error messages:
 -- Could not determine the flash size!
--- "Error while calculating SHA1 hash"
+-- "Error while calculating the checksum."
 --
 --------------------------------------------------------------------------
 
@@ -1118,13 +2489,127 @@ function hashArea(tPlugin, aAttr, ulDeviceOffset, ulDataByteSize, fnCallbackMess
 	fOk, strFlashHashBin = hash(tPlugin, aAttr, ulDeviceOffset, ulDeviceEndOffset, fnCallbackMessage, fnCallbackProgress)
 
 	if fOk~=true then
-		return nil, "Error while calculating SHA1 hash."
+		return nil, "Error while calculating the checksum."
 	else
 		return strFlashHashBin, "Checksum calculated."
 	end
 end
 
 
+
+--------------------------------------------------------------------------
+-- Calculate the hash tree of an area in the flash.
+-- The leaf size is at least HASH_TREE_LEAF_SIZE. It grows until all nodes
+-- of the tree fit into the buffer of the flasher.
+-- size = 0xffffffff to hash from ulDeviceOffset to end of device
+--
+-- Returns the binary root, the leaf size and a list with all nodes
+-- starting with the leaves, or nil and an error message.
+--
+-- Error messages:
+-- Could not determine the flash size!
+-- "Error while calculating the checksum."
+--------------------------------------------------------------------------
+
+HASH_TREE_LEAF_SIZE = 0x1000
+
+function hashTreeArea(tPlugin, aAttr, ulDeviceOffset, ulDataByteSize, fnCallbackMessage, fnCallbackProgress)
+	if ulDataByteSize == 0xffffffff then
+		local ulDeviceSize = getFlashSize(tPlugin, aAttr, fnCallbackMessage, fnCallbackProgress)
+		if ulDeviceSize then
+			print(string.format("Flash size: 0x%08x bytes", ulDeviceSize))
+			ulDataByteSize = ulDeviceSize - ulDeviceOffset
+		else
+			return nil, "Could not determine the flash size!"
+		end
+	end
+	
+	local tAttr = atHashAlgorithms[getHashAlgorithm(aAttr)]
+	local ulLeafSize = HASH_TREE_LEAF_SIZE
+	while getTreeNodes(math.ceil(ulDataByteSize / ulLeafSize)) * tAttr.sizHash > aAttr.ulBufferLen do
+		ulLeafSize = ulLeafSize * 2
+	end
+	
+	local fOk, strRootBin, astrNodeBin = hash_tree(tPlugin, aAttr, ulDeviceOffset, ulDeviceOffset + ulDataByteSize, ulLeafSize, aAttr.ulBufferAdr, fnCallbackMessage, fnCallbackProgress)
+	if fOk~=true then
+		return nil, "Error while calculating the checksum."
+	end
+	
+	return strRootBin, ulLeafSize, astrNodeBin
+end
+
+
+-- Compares the leaves of 2 hash trees with the same leaf size.
+-- Returns a list of the different leaves as {ulStart, ulEnd} pairs with
+-- offsets relative to ulDeviceOffset and ulDataByteSize.
+function compareTreeLeaves(astrNodeBinA, astrNodeBinB, ulDeviceOffset, ulDataByteSize, ulLeafSize)
+	local atRanges = {}
+	local ulLeaves = math.ceil(ulDataByteSize / ulLeafSize)
+	for uiCnt=1,ulLeaves do
+		if astrNodeBinA[uiCnt]~=astrNodeBinB[uiCnt] then
+			local ulStart = ulDeviceOffset + (uiCnt-1) * ulLeafSize
+			local ulEnd = ulDeviceOffset + math.min(uiCnt * ulLeafSize, ulDataByteSize)
+			local tLast = atRanges[#atRanges]
+			if tLast~=nil and tLast[2]==ulStart then
+				tLast[2] = ulEnd
+			else
+				table.insert(atRanges, {ulStart, ulEnd})
+			end
+		end
+	end
+	return atRanges
+end
+
+
+--------------------------------------------------------------------------
+-- Find the blocks in the flash which differ from strData.
+-- The flash and strData are split into blocks of ulBlockSize bytes. The
+-- flasher builds the hashes of all blocks in one call for each buffer full
+-- of hashes, so the data is not transferred to the PC.
+--
+-- Returns true if all blocks are equal and a list of the different blocks
+-- as {ulStart, ulEnd} pairs, or nil and an error message.
+--
+-- Error messages:
+-- "Invalid block size."
+-- "Error while calculating the checksums."
+--------------------------------------------------------------------------
+
+function compareAreaBlocks(tPlugin, aAttr, ulDeviceOffset, strData, ulBlockSize, fnCallbackMessage, fnCallbackProgress)
+	local tAttr = atHashAlgorithms[getHashAlgorithm(aAttr)]
+	local ulMaxBlocks = math.floor(aAttr.ulBufferLen / tAttr.sizHash)
+	if ulBlockSize==0 or ulMaxBlocks==0 then
+		return nil, "Invalid block size."
+	end
+	
+	local atRanges = {}
+	local ulDataOffset = 0
+	local ulDataByteSize = strData:len()
+	while ulDataOffset<ulDataByteSize do
+		-- Get as many blocks as fit into the buffer.
+		local ulChunkSize = math.min(ulDataByteSize - ulDataOffset, ulMaxBlocks * ulBlockSize)
+		local ulStart = ulDeviceOffset + ulDataOffset
+		print(string.format("hashing blocks at flash offset 0x%08x-0x%08x.", ulStart, ulStart+ulChunkSize))
+		local fOk, astrFlashHashBin = hash_blocks(tPlugin, aAttr, ulStart, ulStart+ulChunkSize, ulBlockSize, aAttr.ulBufferAdr, fnCallbackMessage, fnCallbackProgress)
+		if fOk~=true then
+			return nil, "Error while calculating the checksums."
+		end
+		
+		for uiCnt, strFlashHashBin in ipairs(astrFlashHashBin) do
+			local ulBlockOffset = ulDataOffset + (uiCnt-1) * ulBlockSize
+			local ulBlockEnd = math.min(ulBlockOffset + ulBlockSize, ulDataByteSize)
+			if hashData(strData:sub(ulBlockOffset+1, ulBlockEnd), getHashAlgorithm(aAttr))~=strFlashHashBin then
+				table.insert(atRanges, {ulDeviceOffset + ulBlockOffset, ulDeviceOffset + ulBlockEnd})
+			end
+		end
+		
+		ulDataOffset = ulDataOffset + ulChunkSize
+	end
+	
+	return #atRanges==0, atRanges
+end
+
+
 --------------------------------------------------------------------------
 -- simple_flasher_string
 -- This is a simple routine to flash the data in a string.
@@ -1159,11 +2644,7 @@ function simple_flasher_string(tPlugin, strData, tBus, ulUnit, ulChipSelect, str
 		error("Failed to detect the device!")
 	end
 	
-	fOk, strMsg = eraseArea(tPlugin, aAttr, ulDeviceOffset, strData:len(), fnCallbackMessage, fnCallbackProgress)
-	print(strMsg)
-	assert(fOk, strMsg or "Error while erasing area")
-	
-	fOk, strMsg = flashArea(tPlugin, aAttr, ulDeviceOffset, strData, fnCallbackMessage, fnCallbackProgress)
+	fOk, strMsg = flashArea(tPlugin, aAttr, ulDeviceOffset, strData, fnCallbackMessage, fnCallbackProgress, true)
 	print(strMsg)
 	assert(fOk, strMsg or "Error while programming area")
 	
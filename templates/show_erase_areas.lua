@@ -39,13 +39,20 @@ end
 tPlugin:Disconnect()
 
 
-local ulSectors = get_dword(strDevDesc, ${OFFSETOF_tagFLASH_DEVICE_ulSectorCnt}+1)
-print(string.format("Found %d sectors.", ulSectors))
-
--- Iterate over the erase areas.
-for ulCnt=0,ulSectors-1 do
-	local ulOffset = get_dword(strDevDesc, 1+${OFFSETOF_DEVICE_DESCRIPTION_STRUCT_uInfo}+${OFFSETOF_tagFLASH_DEVICE_atSectors}+(${SIZEOF_SECTOR_INFO_STRUCT}*ulCnt)+${OFFSETOF_SECTOR_INFO_STRUCT_ulOffset})
-	local ulSize   = get_dword(strDevDesc, 1+${OFFSETOF_DEVICE_DESCRIPTION_STRUCT_uInfo}+${OFFSETOF_tagFLASH_DEVICE_atSectors}+(${SIZEOF_SECTOR_INFO_STRUCT}*ulCnt)+${OFFSETOF_SECTOR_INFO_STRUCT_ulSize})
-	print(string.format("  %03d: 0x%08x 0x%08x", ulCnt, ulOffset, ulSize))
+local ulDevInfo = 1+${OFFSETOF_DEVICE_DESCRIPTION_STRUCT_uInfo}
+local ulSectors = get_dword(strDevDesc, ulDevInfo+${OFFSETOF_tagFLASH_DEVICE_ulSectorCnt})
+local ulRegions = get_dword(strDevDesc, ulDevInfo+${OFFSETOF_tagFLASH_DEVICE_ulRegionCnt})
+print(string.format("Found %d sectors in %d regions.", ulSectors, ulRegions))
+
+-- Iterate over the erase regions. All sectors in a region have the same size.
+for ulRegion=0,ulRegions-1 do
+	local ulRegionInfo = ulDevInfo+${OFFSETOF_tagFLASH_DEVICE_atRegions}+(${SIZEOF_ERASE_REGION_STRUCT}*ulRegion)
+	local ulOffset      = get_dword(strDevDesc, ulRegionInfo+${OFFSETOF_ERASE_REGION_STRUCT_ulOffset})
+	local ulFirstSector = get_dword(strDevDesc, ulRegionInfo+${OFFSETOF_ERASE_REGION_STRUCT_ulFirstSector})
+	local ulSectorCnt   = get_dword(strDevDesc, ulRegionInfo+${OFFSETOF_ERASE_REGION_STRUCT_ulSectorCnt})
+	local ulSize        = get_dword(strDevDesc, ulRegionInfo+${OFFSETOF_ERASE_REGION_STRUCT_ulSectorSize})
+	for ulCnt=0,ulSectorCnt-1 do
+		print(string.format("  %03d: 0x%08x 0x%08x", ulFirstSector+ulCnt, ulOffset+ulCnt*ulSize, ulSize))
+	end
 end
 